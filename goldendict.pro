@@ -285,11 +285,14 @@ HEADERS += \
     src/ankiconnector.hh \
     src/article_maker.hh \
     src/article_netmgr.hh \
+    src/articleprefetch.hh \
     src/audiolink.hh \
     src/audioplayerfactory.hh \
     src/audioplayerinterface.hh \
     src/btreeidx.hh \
+    src/bulkexporter.hh \
     src/chunkedstorage.hh \
+    src/common/asynclog.hh \
     src/common/base_type.hh \
     src/common/ex.hh \
     src/common/file.hh \
@@ -300,9 +303,13 @@ HEADERS += \
     src/common/globalregex.hh \
     src/common/help.hh \
     src/common/htmlescape.hh \
+    src/common/htmlrewriter.hh \
     src/common/iconv.hh \
+    src/common/indexpack.hh \
     src/common/inc_case_folding.hh \
+    src/common/memorybudget.hh \
     src/common/sptr.hh \
+    src/common/storagedevice.hh \
     src/common/ufile.hh \
     src/common/utf8.hh \
     src/common/utils.hh \
@@ -312,6 +319,7 @@ HEADERS += \
     src/decompress.hh \
     src/delegate.hh \
     src/dict/aard.hh \
+    src/dict/articleassembler.hh \
     src/dict/belarusiantranslit.hh \
     src/dict/bgl.hh \
     src/dict/bgl_babylon.hh \
@@ -326,6 +334,7 @@ HEADERS += \
     src/dict/gls.hh \
     src/dict/greektranslit.hh \
     src/dict/hunspell.hh \
+    src/dict/iconcache.hh \
     src/dict/lingualibre.hh \
     src/dict/loaddictionaries.hh \
     src/dict/lsa.hh \
@@ -361,6 +370,7 @@ HEADERS += \
     src/hotkeywrapper.hh \
     src/iframeschemehandler.hh \
     src/indexedzip.hh \
+    src/indexwarmup.hh \
     src/initializing.hh \
     src/instances.hh \
     src/keyboardstate.hh \
@@ -372,6 +382,7 @@ HEADERS += \
     src/pronounceengine.hh \
     src/resourceschemehandler.hh \
     src/splitfile.hh \
+    src/startupprofile.hh \
     src/termination.hh \
     src/tiff.hh \
     src/ui/about.hh \
@@ -399,6 +410,7 @@ HEADERS += \
     src/ui/scanpopup.hh \
     src/ui/searchpanel.hh \
     src/ui/searchpanewidget.hh \
+    src/ui/startupprofiledialog.hh \
     src/ui/stylescombobox.hh \
     src/ui/translatebox.hh \
     src/version.hh \
@@ -414,10 +426,13 @@ SOURCES += \
     src/ankiconnector.cc \
     src/article_maker.cc \
     src/article_netmgr.cc \
+    src/articleprefetch.cc \
     src/audiolink.cc \
     src/audioplayerfactory.cc \
     src/btreeidx.cc \
+    src/bulkexporter.cc \
     src/chunkedstorage.cc \
+    src/common/asynclog.cc \
     src/common/file.cc \
     src/common/filetype.cc \
     src/common/folding.cc \
@@ -426,7 +441,11 @@ SOURCES += \
     src/common/globalregex.cc \
     src/common/help.cc \
     src/common/htmlescape.cc \
+    src/common/htmlrewriter.cc \
     src/common/iconv.cc \
+    src/common/indexpack.cc \
+    src/common/memorybudget.cc \
+    src/common/storagedevice.cc \
     src/common/ufile.cc \
     src/common/utf8.cc \
     src/common/utils.cc \
@@ -449,6 +468,7 @@ SOURCES += \
     src/dict/gls.cc \
     src/dict/greektranslit.cc \
     src/dict/hunspell.cc \
+    src/dict/iconcache.cc \
     src/dict/lingualibre.cc \
     src/dict/loaddictionaries.cc \
     src/dict/lsa.cc \
@@ -483,6 +503,7 @@ SOURCES += \
     src/hotkeywrapper.cc \
     src/iframeschemehandler.cc \
     src/indexedzip.cc \
+    src/indexwarmup.cc \
     src/initializing.cc \
     src/instances.cc \
     src/keyboardstate.cc \
@@ -495,6 +516,7 @@ SOURCES += \
     src/pronounceengine.cc \
     src/resourceschemehandler.cc \
     src/splitfile.cc \
+    src/startupprofile.cc \
     src/termination.cc \
     src/tiff.cc \
     src/ui/about.cc \
@@ -520,6 +542,7 @@ SOURCES += \
     src/ui/preferences.cc \
     src/ui/scanpopup.cc \
     src/ui/searchpanel.cc \
+    src/ui/startupprofiledialog.cc \
     src/ui/stylescombobox.cc \
     src/ui/translatebox.cc \
     src/version.cc \
@@ -1,6 +1,5 @@
 #include "ankiconnector.hh"
 #include <QJsonDocument>
-#include <QJsonObject>
 #include <QJsonValue>
 #include "utils.hh"
 
@@ -19,32 +18,11 @@ AnkiConnector::AnkiConnector( QObject * parent, Config::Class const & _cfg ):
   connect( mgr, &QNetworkAccessManager::finished, this, &AnkiConnector::finishedSlot );
 }
 
-void AnkiConnector::sendToAnki( QString const & word, QString text, QString const & sentence )
+QJsonObject AnkiConnector::makeNote( QString const & word, QString text, QString const & sentence ) const
 {
-  if ( word.isEmpty() ) {
-    emit this->errorText( tr( "anki: can't create a card without a word" ) );
-    return;
-  }
-
   // Anki doesn't understand the newline character, so it should be escaped.
   text = text.replace( "\n", "<br>" );
 
-  QString const postTemplate = R"anki({
-      "action": "addNote",
-      "version": 6,
-      "params": {
-          "note": {
-              "deckName": "%1",
-              "modelName": "%2",
-              "fields": %3,
-              "options": {
-                  "allowDuplicate": true
-              },
-              "tags": []
-          }
-      }
-  })anki";
-
   QJsonObject fields;
   fields.insert( cfg.preferences.ankiConnectServer.word, word );
   fields.insert( cfg.preferences.ankiConnectServer.text, text );
@@ -53,12 +31,138 @@ void AnkiConnector::sendToAnki( QString const & word, QString text, QString cons
     fields.insert( cfg.preferences.ankiConnectServer.sentence, sentence_changed );
   }
 
-  QString postData = postTemplate.arg( cfg.preferences.ankiConnectServer.deck,
-                                       cfg.preferences.ankiConnectServer.model,
-                                       Utils::json2String( fields ) );
+  QJsonObject note;
+  note.insert( "deckName", cfg.preferences.ankiConnectServer.deck );
+  note.insert( "modelName", cfg.preferences.ankiConnectServer.model );
+  note.insert( "fields", fields );
+  note.insert( "options", QJsonObject{ { "allowDuplicate", true } } );
+  note.insert( "tags", QJsonArray() );
+  return note;
+}
+
+void AnkiConnector::sendToAnki( QString const & word, QString text, QString const & sentence )
+{
+  if ( word.isEmpty() ) {
+    emit this->errorText( tr( "anki: can't create a card without a word" ) );
+    return;
+  }
+
+  QJsonObject post;
+  post.insert( "action", "addNote" );
+  post.insert( "version", 6 );
+  post.insert( "params", QJsonObject{ { "note", makeNote( word, text, sentence ) } } );
+
+  //  qDebug().noquote() << Utils::json2String( post );
+  postToAnki( Utils::json2String( post ) );
+}
 
-  //  qDebug().noquote() << postData;
-  postToAnki( postData );
+void AnkiConnector::startQueue()
+{
+  // The last batch of the previous export might still be in flight, which
+  // batchReplyFinished() tells by the export it was sent for
+  ++currentExport;
+  pendingNotes   = QJsonArray();
+  queueFinished  = false;
+  notesTotal     = 0;
+  notesProcessed = 0;
+  notesAdded     = 0;
+}
+
+void AnkiConnector::queueNote( QString const & word, QString text, QString const & sentence )
+{
+  if ( word.isEmpty() )
+    return;
+
+  pendingNotes.append( makeNote( word, text, sentence ) );
+  ++notesTotal;
+
+  if ( pendingNotes.size() >= batch_size )
+    sendNextBatch();
+}
+
+void AnkiConnector::finishQueue()
+{
+  queueFinished = true;
+
+  if ( batchInFlight )
+    return; // The rest gets sent once the current batch is done
+
+  if ( pendingNotes.isEmpty() )
+    emit batchFinished( notesAdded, notesProcessed - notesAdded );
+  else
+    sendNextBatch();
+}
+
+void AnkiConnector::cancelQueue()
+{
+  notesTotal -= pendingNotes.size();
+  pendingNotes = QJsonArray();
+
+  finishQueue();
+}
+
+void AnkiConnector::sendNextBatch()
+{
+  if ( batchInFlight || pendingNotes.isEmpty() )
+    return;
+
+  // Only full batches are sent until the queue is finished, so a slow
+  // producer doesn't end up issuing lots of tiny requests.
+  if ( pendingNotes.size() < batch_size && !queueFinished )
+    return;
+
+  QJsonArray batch;
+  while ( batch.size() < batch_size && !pendingNotes.isEmpty() )
+    batch.append( pendingNotes.takeAt( 0 ) );
+
+  QJsonObject post;
+  post.insert( "action", "addNotes" );
+  post.insert( "version", 6 );
+  post.insert( "params", QJsonObject{ { "notes", batch } } );
+
+  batchInFlight = true;
+
+  auto reply = postToAnki( Utils::json2String( post ), batch_transfer_timeout );
+  reply->setProperty( "ankiBatch", true );
+  int const notesInBatch = batch.size();
+  int const batchExport  = currentExport;
+  connect( reply, &QNetworkReply::finished, this, [ this, reply, notesInBatch, batchExport ]() {
+    batchReplyFinished( reply, notesInBatch, batchExport );
+  } );
+}
+
+void AnkiConnector::batchReplyFinished( QNetworkReply * reply, int notesInBatch, int batchExport )
+{
+  batchInFlight = false;
+
+  // The batch of an export which is over by now isn't counted into the
+  // current one, which just goes on
+  if ( batchExport == currentExport ) {
+    // "addNotes" returns an array with the ids of the created notes, having
+    // nulls in place of the ones which could not be added.
+    if ( reply->error() == QNetworkReply::NoError ) {
+      auto const obj = QJsonDocument::fromJson( reply->readAll() ).object();
+      for ( auto const & id : obj[ "result" ].toArray() ) {
+        if ( !id.isNull() )
+          ++notesAdded;
+      }
+
+      if ( !obj[ "error" ].isNull() )
+        qDebug().noquote() << "anki batch error:" << obj[ "error" ].toString();
+    }
+    else
+      qDebug() << "anki connect error" << reply->errorString();
+
+    notesProcessed += notesInBatch;
+    emit batchProgress( notesProcessed, notesTotal );
+  }
+
+  reply->deleteLater();
+
+  if ( !pendingNotes.isEmpty() )
+    sendNextBatch();
+  else if ( queueFinished )
+    emit batchFinished( notesAdded, notesProcessed - notesAdded );
 }
 
 void AnkiConnector::ankiSearch( QString const & word )
@@ -78,14 +182,14 @@ void AnkiConnector::ankiSearch( QString const & word )
   postToAnki( postTemplate.arg( word ) );
 }
 
-void AnkiConnector::postToAnki( QString const & postData )
+QNetworkReply * AnkiConnector::postToAnki( QString const & postData, int timeout )
 {
   QUrl url;
   url.setScheme( "http" );
   url.setHost( cfg.preferences.ankiConnectServer.host );
   url.setPort( cfg.preferences.ankiConnectServer.port );
   QNetworkRequest request( url );
-  request.setTransferTimeout( transfer_timeout );
+  request.setTransferTimeout( timeout );
   //  request.setAttribute( QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy );
   request.setHeader( QNetworkRequest::ContentTypeHeader, "application/json" );
   auto reply = mgr->post( request, postData.toUtf8() );
@@ -93,10 +197,14 @@ void AnkiConnector::postToAnki( QString const & postData )
     qWarning() << e;
     emit this->errorText( tr( "anki: post to anki failed" ) );
   } );
+  return reply;
 }
 
 void AnkiConnector::finishedSlot( QNetworkReply * reply )
 {
+  if ( reply->property( "ankiBatch" ).toBool() )
+    return; // Handled by batchReplyFinished()
+
   if ( reply->error() == QNetworkReply::NoError ) {
     QByteArray const bytes   = reply->readAll();
     QJsonDocument const json = QJsonDocument::fromJson( bytes );
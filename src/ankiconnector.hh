@@ -6,6 +6,8 @@
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QObject>
+#include <QJsonArray>
+#include <QJsonObject>
 
 class AnkiConnector: public QObject
 {
@@ -17,15 +19,64 @@ public:
   void sendToAnki( QString const & word, QString text, QString const & sentence );
   void ankiSearch( QString const & word );
 
+  /// Starts a batched export, see queueNote(). The counts of the previous
+  /// one, and its batch which might still be in flight, are left out.
+  void startQueue();
+
+  /// Queues a note for the batched export. The queued notes are sent to
+  /// AnkiConnect with a single "addNotes" call per batch_size notes, and only
+  /// one such call is in flight at a time. Progress is reported with
+  /// batchProgress() and the end of the export with batchFinished().
+  void queueNote( QString const & word, QString text, QString const & sentence );
+
+  /// Tells that no more notes are going to be queued, so the last, incomplete
+  /// batch gets sent as well.
+  void finishQueue();
+
+  /// Drops all the notes which were not sent yet and ends the export, the way
+  /// finishQueue() does. batchFinished() comes once the batch in flight, if
+  /// any, is done.
+  void cancelQueue();
+
+  /// The number of the queued notes which were not sent yet. Producers are
+  /// expected to hold off while it stays above max_queued_notes.
+  int queuedNotes() const
+  {
+    return pendingNotes.size();
+  }
+
+  static constexpr int batch_size       = 50;
+  static constexpr int max_queued_notes = 4 * batch_size;
+
 private:
   QNetworkAccessManager * mgr;
   Config::Class const & cfg;
-  void postToAnki( QString const & postData );
+  QNetworkReply * postToAnki( QString const & postData, int timeout = transfer_timeout );
   static constexpr auto transfer_timeout = 3000;
+  // A batch of notes takes Anki considerably longer to process
+  static constexpr auto batch_transfer_timeout = 30000;
+
+  QJsonObject makeNote( QString const & word, QString text, QString const & sentence ) const;
+
+  // Sends the next batch, if there's no batch in flight already
+  void sendNextBatch();
+  void batchReplyFinished( QNetworkReply * reply, int notesInBatch, int batchExport );
+
+  QJsonArray pendingNotes;
+  bool batchInFlight = false;
+  bool queueFinished = false;
+  // Counts the exports, so the batch of an export which is over isn't taken
+  // for one of the current export
+  int currentExport  = 0;
+  int notesTotal     = 0;
+  int notesProcessed = 0;
+  int notesAdded     = 0;
 
 public:
 signals:
   void errorText( QString const & );
+  void batchProgress( int processed, int total );
+  void batchFinished( int added, int failed );
 private slots:
   void finishedSlot( QNetworkReply * reply );
 };
@@ -2,6 +2,7 @@
  * Part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
 
 #include "article_maker.hh"
+#include "articleprefetch.hh"
 #include "config.hh"
 #include "folding.hh"
 #include "gddebug.hh"
@@ -30,6 +31,32 @@ inline bool ankiConnectEnabled()
   return GlobalBroadcaster::instance()->getPreference()->ankiConnectServer.enabled;
 }
 
+namespace {
+
+/// The device the dictionary's files are on. Looked up once per dictionary.
+StorageDevice::Device dictionaryDevice( Dictionary::Class & dict )
+{
+  static QHash< QString, StorageDevice::Device > devices;
+
+  QString const id = QString::fromStdString( dict.getId() );
+
+  auto i = devices.constFind( id );
+  if ( i != devices.constEnd() )
+    return *i;
+
+  // The online ones have no files and are never limited
+  StorageDevice::Device device;
+  auto const & files = dict.getDictionaryFilenames();
+  if ( !files.empty() )
+    device = StorageDevice::find( QString::fromStdString( files.front() ) );
+
+  devices.insert( id, device );
+
+  return device;
+}
+
+} // namespace
+
 ArticleMaker::ArticleMaker( vector< sptr< Dictionary::Class > > const & dictionaries_,
                             vector< Instances::Group > const & groups_,
                             const Config::Preferences & cfg_ ):
@@ -491,34 +518,100 @@ void ArticleRequest::altSearchFinished()
 
     altsDone = true; // So any pending signals in queued mode won't mess us up
 
-    vector< wstring > altsVector( alts.begin(), alts.end() );
-
-    wstring wordStd = gd::toWString( word );
-
     if ( activeDicts.size() <= 1 )
       articleSizeLimit = -1; // Don't collapse article if only one dictionary presented
 
-    for ( const auto & activeDict : activeDicts ) {
-      try {
-        sptr< Dictionary::DataRequest > r = activeDict->getArticle(
-          wordStd,
-          altsVector,
-          gd::removeTrailingZero( contexts.value( QString::fromStdString( activeDict->getId() ) ) ),
-          ignoreDiacritics );
+    bodyRequests.assign( activeDicts.size(), sptr< Dictionary::DataRequest >() );
+    bodyDevices.resize( activeDicts.size() );
+    bodyRunning.assign( activeDicts.size(), false );
 
-        connect( r.get(), &Dictionary::Request::finished, this, &ArticleRequest::bodyFinished, Qt::QueuedConnection );
+    for ( size_t x = 0; x < activeDicts.size(); ++x ) {
+      bodyDevices[ x ] = dictionaryDevice( *activeDicts[ x ] );
+      pendingBodies.push_back( x );
+    }
 
-        bodyRequests.push_back( r );
-      }
-      catch ( std::exception & e ) {
-        gdWarning( "getArticle request error (%s) in \"%s\"\n", e.what(), activeDict->getName().c_str() );
+    issueBodyRequests();
+
+    bodyFinished(); // Handle any ones which have already finished
+  }
+}
+
+void ArticleRequest::issueBodyRequests()
+{
+  wstring const wordStd = gd::toWString( word );
+  vector< wstring > altsVector;
+
+  for ( auto i = pendingBodies.begin(); i != pendingBodies.end(); ) {
+    size_t const index                   = *i;
+    StorageDevice::Device const & device = bodyDevices[ index ];
+
+    if ( device.concurrency && runningPerDevice.value( device.id ) >= device.concurrency ) {
+      ++i; // The device is busy with the articles above this one
+      continue;
+    }
+
+    i = pendingBodies.erase( i );
+
+    if ( altsVector.empty() && !alts.empty() )
+      altsVector.assign( alts.begin(), alts.end() );
+
+    sptr< Dictionary::Class > const & activeDict = activeDicts[ index ];
+    sptr< Dictionary::DataRequest > r;
+
+    try {
+      wstring const context =
+        gd::removeTrailingZero( contexts.value( QString::fromStdString( activeDict->getId() ) ) );
+
+      r = ArticlePrefetch::take( activeDict.get(), wordStd, altsVector, context, ignoreDiacritics );
+      if ( !r )
+        r = activeDict->getArticle( wordStd, altsVector, context, ignoreDiacritics );
+    }
+    catch ( std::exception & e ) {
+      gdWarning( "getArticle request error (%s) in \"%s\"\n", e.what(), activeDict->getName().c_str() );
+
+      // Keeps the place of the dictionary on the page
+      r = std::make_shared< Dictionary::DataRequestInstant >( false );
+    }
+
+    connect( r.get(), &Dictionary::Request::finished, this, &ArticleRequest::bodyFinished, Qt::QueuedConnection );
+
+    if ( device.concurrency ) {
+      connect(
+        r.get(),
+        &Dictionary::Request::finished,
+        this,
+        [ this, index ]() {
+          bodyRequestFinished( index );
+        },
+        Qt::QueuedConnection );
+
+      // The ones finished right away, before the connection, are not counted
+      if ( !r->isFinished() ) {
+        bodyRunning[ index ] = true;
+        ++runningPerDevice[ device.id ];
       }
     }
 
-    bodyFinished(); // Handle any ones which have already finished
+    bodyRequests[ index - ( activeDicts.size() - bodyRequests.size() ) ] = r;
   }
 }
 
+void ArticleRequest::bodyRequestFinished( size_t index )
+{
+  if ( !bodyRunning[ index ] )
+    return;
+
+  bodyRunning[ index ] = false;
+  --runningPerDevice[ bodyDevices[ index ].id ];
+
+  issueBodyRequests();
+
+  // Some of the ones just issued might have been finished right away, such as
+  // the instant ones, or before their finished() got connected, so no signal
+  // would come for them
+  bodyFinished();
+}
+
 int ArticleRequest::findEndOfCloseDiv( const QString & str, int pos )
 {
   for ( ;; ) {
@@ -587,7 +680,7 @@ void ArticleRequest::bodyFinished()
   QStringList dictIds;
   while ( bodyRequests.size() ) {
     // Since requests should go in order, check the first one first
-    if ( bodyRequests.front()->isFinished() ) {
+    if ( bodyRequests.front() && bodyRequests.front()->isFinished() ) {
       // Good
 
       GD_DPRINTF( "one finished." );
@@ -676,10 +769,9 @@ void ArticleRequest::bodyFinished()
         appendString( head );
 
         try {
-          if ( req.dataSize() > 0 ) {
-            auto d = bodyRequests.front()->getFullData();
-            appendDataSlice( &d.front(), d.size() );
-          }
+          // The body is shared rather than copied
+          if ( req.dataSize() > 0 )
+            appendSegments( req.getSegments() );
         }
         catch ( std::exception & e ) {
           gdWarning( "getDataSlice error: %s\n", e.what() );
@@ -1063,10 +1155,10 @@ void ArticleRequest::cancel()
       ( *i )->cancel();
     }
   }
-  if ( !bodyRequests.empty() ) {
-    for ( list< sptr< Dictionary::DataRequest > >::iterator i = bodyRequests.begin(); i != bodyRequests.end(); ++i ) {
-      ( *i )->cancel();
-    }
+  pendingBodies.clear();
+  for ( auto const & r : bodyRequests ) {
+    if ( r )
+      r->cancel();
   }
   if ( stemmedWordFinder.get() )
     stemmedWordFinder->cancel();
@@ -4,13 +4,16 @@
 #ifndef __ARTICLE_MAKER_HH_INCLUDED__
 #define __ARTICLE_MAKER_HH_INCLUDED__
 
+#include <QHash>
 #include <QObject>
 #include <QMap>
+#include <deque>
 #include <set>
 #include <list>
 #include "config.hh"
 #include "dict/dictionary.hh"
 #include "instances.hh"
+#include "storagedevice.hh"
 #include "wordfinder.hh"
 
 /// This class generates the article's body for the given lookup request
@@ -91,7 +94,16 @@ class ArticleRequest: public Dictionary::DataRequest
 
   std::set< gd::wstring, std::less<> > alts; // Accumulated main forms
   std::list< sptr< Dictionary::WordSearchRequest > > altSearches;
-  std::list< sptr< Dictionary::DataRequest > > bodyRequests;
+  /// The article requests, in the order of activeDicts, less the ones
+  /// already added to the page. Null until the request is issued.
+  std::deque< sptr< Dictionary::DataRequest > > bodyRequests;
+  /// The dictionaries whose articles are yet to be requested, in the order
+  /// of the group, so the articles on the top of the page come first
+  std::list< size_t > pendingBodies;
+  /// The devices of activeDicts, and how many requests each is running
+  std::vector< StorageDevice::Device > bodyDevices;
+  std::vector< bool > bodyRunning;
+  QHash< QByteArray, int > runningPerDevice;
   bool altsDone{ false };
   bool bodyDone{ false };
   bool foundAnyDefinitions{ false };
@@ -141,6 +153,12 @@ private slots:
 private:
   int htmlTextSize( QString html );
 
+  /// Requests the pending articles, as long as their devices take more.
+  void issueBodyRequests();
+
+  /// Frees the slot the request took on its device.
+  void bodyRequestFinished( size_t index );
+
   /// Uses stemmedWordFinder to perform the next step of looking up word
   /// combinations.
   void compoundSearchNextStep( bool lastSearchSucceeded );
@@ -0,0 +1,246 @@
+/* This file is part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
+
+#include "articleprefetch.hh"
+#include "gddebug.hh"
+#include "memorybudget.hh"
+#include "wstring_qt.hh"
+
+#include <QCoreApplication>
+#include <algorithm>
+#include <list>
+#include <memory>
+
+namespace ArticlePrefetch {
+
+namespace {
+
+// How many articles are requested at once, and how many finished ones are
+// kept at most
+int const maxRunning = 4;
+int const maxKept    = 16;
+
+struct Entry
+{
+  Dictionary::Class * dictionary;
+  gd::wstring word;
+  bool ignoreDiacritics;
+  sptr< Dictionary::DataRequest > request;
+  qint64 bytes  = 0; // Counted once finished
+  bool finished = false;
+};
+
+struct Pending
+{
+  Item item;
+  bool ignoreDiacritics;
+};
+
+// The most recent ones first
+std::list< Entry > entries;
+std::list< Pending > pending;
+
+qint64 keptBytes = 0;
+int budgetId     = -1;
+
+bool matches( Entry const & entry, Dictionary::Class * dictionary, gd::wstring const & word, bool ignoreDiacritics )
+{
+  return entry.dictionary == dictionary && entry.ignoreDiacritics == ignoreDiacritics && entry.word == word;
+}
+
+void updateUsage()
+{
+  if ( budgetId >= 0 )
+    MemoryBudget::setUsage( budgetId, keptBytes );
+}
+
+/// Drops the oldest finished entries until there's no more than maxKept of
+/// them and at least bytesToFree are freed. Returns how much was freed.
+qint64 evict( qint64 bytesToFree )
+{
+  qint64 freed = 0;
+  int kept     = 0;
+
+  for ( auto const & entry : entries )
+    kept += entry.finished;
+
+  for ( auto i = entries.end(); i != entries.begin(); ) {
+    --i;
+
+    if ( kept <= maxKept && freed >= bytesToFree )
+      break;
+
+    if ( !i->finished )
+      continue;
+
+    freed += i->bytes;
+    --kept;
+    i = entries.erase( i );
+  }
+
+  keptBytes -= freed;
+  updateUsage();
+
+  return freed;
+}
+
+void finished( Dictionary::DataRequest * request );
+
+void startPending()
+{
+  auto running = std::count_if( entries.begin(), entries.end(), []( Entry const & entry ) {
+    return !entry.finished;
+  } );
+
+  while ( running < maxRunning && !pending.empty() ) {
+    Pending next = pending.front();
+    pending.pop_front();
+
+    Entry entry;
+    entry.dictionary       = next.item.dictionary;
+    entry.word             = gd::toWString( next.item.word );
+    entry.ignoreDiacritics = next.ignoreDiacritics;
+
+    try {
+      entry.request = entry.dictionary->getArticle( entry.word, {}, {}, entry.ignoreDiacritics );
+    }
+    catch ( std::exception & e ) {
+      gdWarning( "Prefetching an article failed: %s\n", e.what() );
+      continue;
+    }
+
+    // The request might be gone by the time the notification comes, once
+    // taken
+    std::weak_ptr< Dictionary::DataRequest > request = entry.request;
+
+    auto const notify = [ request ]() {
+      if ( auto r = request.lock() )
+        finished( r.get() );
+    };
+
+    QObject::connect( entry.request.get(), &Dictionary::Request::finished, qApp, notify, Qt::QueuedConnection );
+
+    // In case it has finished before the connection was made
+    if ( entry.request->isFinished() )
+      QMetaObject::invokeMethod( qApp, notify, Qt::QueuedConnection );
+
+    entries.push_front( std::move( entry ) );
+    ++running;
+  }
+}
+
+void finished( Dictionary::DataRequest * request )
+{
+  auto i = std::find_if( entries.begin(), entries.end(), [ request ]( Entry const & entry ) {
+    return entry.request.get() == request;
+  } );
+
+  if ( i == entries.end() || i->finished )
+    return; // Taken or dropped by now, or counted already
+
+  i->finished = true;
+  i->bytes    = std::max( request->dataSize(), 0L );
+  keptBytes += i->bytes;
+
+  evict( 0 );
+
+  startPending();
+}
+
+} // namespace
+
+void prefetch( QList< Item > const & items, bool ignoreDiacritics )
+{
+  if ( budgetId < 0 )
+    budgetId = MemoryBudget::registerCache( "Prefetched articles", 1, evict );
+
+  pending.clear();
+
+  std::vector< gd::wstring > words;
+  words.reserve( items.size() );
+  for ( auto const & item : items )
+    words.push_back( gd::toWString( item.word ) );
+
+  auto const wanted = [ & ]( Entry const & entry ) {
+    for ( int x = 0; x < items.size(); ++x )
+      if ( matches( entry, items[ x ].dictionary, words[ x ], ignoreDiacritics ) )
+        return true;
+
+    return false;
+  };
+
+  // The requests still going for the previous call and wanted again are kept
+  for ( auto i = entries.begin(); i != entries.end(); ) {
+    if ( i->finished || wanted( *i ) ) {
+      ++i;
+      continue;
+    }
+
+    i->request->cancel();
+    i = entries.erase( i );
+  }
+
+  for ( int x = 0; x < items.size(); ++x ) {
+    bool const done = std::any_of( entries.begin(), entries.end(), [ & ]( Entry const & entry ) {
+      return matches( entry, items[ x ].dictionary, words[ x ], ignoreDiacritics );
+    } );
+
+    if ( !done )
+      pending.push_back( Pending{ items[ x ], ignoreDiacritics } );
+  }
+
+  startPending();
+}
+
+void cancel()
+{
+  pending.clear();
+
+  for ( auto i = entries.begin(); i != entries.end(); ) {
+    if ( i->finished ) {
+      ++i;
+      continue;
+    }
+
+    i->request->cancel();
+    i = entries.erase( i );
+  }
+}
+
+sptr< Dictionary::DataRequest > take( Dictionary::Class * dictionary,
+                                      gd::wstring const & word,
+                                      std::vector< gd::wstring > const & alts,
+                                      gd::wstring const & context,
+                                      bool ignoreDiacritics )
+{
+  if ( !alts.empty() || !context.empty() )
+    return {};
+
+  auto i = std::find_if( entries.begin(), entries.end(), [ & ]( Entry const & entry ) {
+    return matches( entry, dictionary, word, ignoreDiacritics );
+  } );
+
+  if ( i == entries.end() )
+    return {};
+
+  sptr< Dictionary::DataRequest > request = std::move( i->request );
+
+  keptBytes -= i->bytes;
+  entries.erase( i );
+  updateUsage();
+
+  // Might have made room for one more
+  startPending();
+
+  return request;
+}
+
+void clear()
+{
+  cancel();
+
+  entries.clear();
+  keptBytes = 0;
+  updateUsage();
+}
+
+} // namespace ArticlePrefetch
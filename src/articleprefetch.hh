@@ -0,0 +1,52 @@
+/* This file is part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
+
+#ifndef __ARTICLEPREFETCH_HH_INCLUDED__
+#define __ARTICLEPREFETCH_HH_INCLUDED__
+
+#include <QList>
+#include <QString>
+#include <vector>
+
+#include "dict/dictionary.hh"
+
+/// Requests the articles the user is likely to look at next, such as the
+/// following headwords of the list being browsed, before they are asked for.
+/// An article request which then asks for the same article of the same
+/// dictionary gets the prefetched one, finished or still going. The finished
+/// ones which haven't been taken are kept within the memory budget.
+///
+/// Only the articles looked up without alternate forms or a context are
+/// prefetched, as that is how the lists' headwords are looked up in most
+/// cases. Only their bodies are: the images, styles and sounds they refer to
+/// are requested by the article view once it shows them, through the
+/// resource handlers, which have no cache a prefetched resource could be
+/// handed to. All the functions are to be called from the main thread.
+namespace ArticlePrefetch {
+
+struct Item
+{
+  Dictionary::Class * dictionary;
+  QString word;
+};
+
+/// Starts prefetching the articles, the first ones first. The ones still
+/// being prefetched for the previous call and not among these are cancelled.
+void prefetch( QList< Item > const & items, bool ignoreDiacritics );
+
+/// Cancels everything still being prefetched, keeping what's done.
+void cancel();
+
+/// Returns the prefetched request for the article, if any, which is no longer
+/// held by the prefetcher then.
+sptr< Dictionary::DataRequest > take( Dictionary::Class * dictionary,
+                                      gd::wstring const & word,
+                                      std::vector< gd::wstring > const & alts,
+                                      gd::wstring const & context,
+                                      bool ignoreDiacritics );
+
+/// Drops everything. Must be called before the dictionaries are unloaded.
+void clear();
+
+} // namespace ArticlePrefetch
+
+#endif
@@ -50,6 +50,22 @@ string const & BtreeDictionary::ensureInitDone()
   return empty;
 }
 
+void BtreeDictionary::warmUp( qint64 & ioBudget, QAtomicInt & isCancelled )
+{
+  // Forcing the deferred init from here would make cancelling the warm-up,
+  // which is waited for on the GUI thread, wait for the init as well. The
+  // dictionaries still being initialized are left for the lookups to warm.
+  if ( !isInitDone() || ensureInitDone().size() )
+    return;
+
+  try {
+    warmUpIndex( ioBudget, isCancelled );
+  }
+  catch ( std::exception & e ) {
+    gdWarning( "Index warm-up failed: \"%s\", error: %s\n", getName().c_str(), e.what() );
+  }
+}
+
 void BtreeIndex::openIndex( IndexInfo const & indexInfo, File::Index & file, QMutex & mutex )
 {
   indexNodeSize = indexInfo.btreeMaxElements;
@@ -101,6 +117,53 @@ BtreeIndex::findArticles( wstring const & search_word, bool ignoreDiacritics, ui
   return result;
 }
 
+vector< vector< WordArticleLink > > BtreeIndex::findArticles( vector< wstring > const & words, bool ignoreDiacritics )
+{
+  vector< vector< WordArticleLink > > result( words.size() );
+
+  // The chains read so far, by their folded words
+  map< wstring, vector< WordArticleLink > > chains;
+
+  for ( size_t x = 0; x < words.size(); ++x ) {
+    wstring word = gd::removeTrailingZero( words[ x ] );
+
+    try {
+      wstring folded = Folding::apply( word );
+      if ( folded.empty() )
+        folded = Folding::applyWhitespaceOnly( word );
+
+      auto i = chains.find( folded );
+
+      if ( i == chains.end() ) {
+        vector< WordArticleLink > chain;
+
+        bool exactMatch;
+
+        vector< char > leaf;
+        uint32_t nextLeaf;
+
+        char const * leafEnd;
+
+        char const * chainOffset = findChainOffsetExactOrPrefix( folded, exactMatch, leaf, nextLeaf, leafEnd );
+
+        if ( chainOffset && exactMatch )
+          chain = readChain( chainOffset );
+
+        i = chains.emplace( folded, std::move( chain ) ).first;
+      }
+
+      result[ x ] = i->second;
+
+      antialias( word, result[ x ], ignoreDiacritics );
+    }
+    catch ( std::exception & e ) {
+      gdWarning( "Articles searching failed, error: %s\n", e.what() );
+      result[ x ].clear();
+    }
+  }
+
+  return result;
+}
 
 BtreeWordSearchRequest::BtreeWordSearchRequest( BtreeDictionary & dict_,
                                                 wstring const & str_,
@@ -417,6 +480,48 @@ void BtreeIndex::readNode( uint32_t offset, vector< char > & out )
     throw exFailedToDecompressNode();
 }
 
+void BtreeIndex::warmUpIndex( qint64 & budget, QAtomicInt & isCancelled )
+{
+  if ( !idxFile || budget <= 0 )
+    return;
+
+  QMutexLocker _( idxFileMutex );
+
+  if ( !rootNodeLoaded ) {
+    readNode( rootOffset, rootNode );
+    rootNodeLoaded = true;
+  }
+
+  budget -= rootNode.size();
+
+  if ( rootNode.size() < sizeof( uint32_t ) || *(uint32_t const *)&rootNode.front() != 0xffffFFFF )
+    return; // The root is the only leaf, there's nothing below it
+
+  // Children are written out in order before their parent, so the range
+  // between two consecutive child offsets holds the first child entirely.
+  // For a two-level tree, which is the usual case, these are all the leaves.
+  // We go in file order to keep the readahead sequential.
+
+  uint32_t const * offsets = (uint32_t const *)&rootNode.front() + 1;
+
+  for ( uint32_t x = 0; x <= indexNodeSize && budget > 0; ++x ) {
+    if ( Utils::AtomicInt::loadAcquire( isCancelled ) )
+      return;
+
+    uint32_t begin = offsets[ x ];
+    uint32_t end   = x < indexNodeSize ? offsets[ x + 1 ] : rootOffset;
+
+    if ( end <= begin )
+      break; // Not the layout we expect, don't guess
+
+    qint64 size = qMin( (qint64)( end - begin ), budget );
+
+    idxFile->adviseWillNeed( begin, size );
+
+    budget -= size;
+  }
+}
+
 char const * BtreeIndex::findChainOffsetExactOrPrefix(
   wstring const & target, bool & exactMatch, vector< char > & extLeaf, uint32_t & nextLeaf, char const *& leafEnd )
 {
@@ -1038,7 +1143,8 @@ void BtreeIndex::findAllArticleLinks( QVector< WordArticleLink > & articleLinks
 void BtreeIndex::findArticleLinks( QVector< WordArticleLink > * articleLinks,
                                    QSet< uint32_t > * offsets,
                                    QSet< QString > * headwords,
-                                   QAtomicInt * isCancelled )
+                                   QAtomicInt * isCancelled,
+                                   QDeadlineTimer const deadline )
 {
   uint32_t currentNodeOffset = rootOffset;
   uint32_t nextLeaf          = 0;
@@ -1092,6 +1198,9 @@ void BtreeIndex::findArticleLinks( QVector< WordArticleLink > * articleLinks,
   // Read all chains
 
   for ( ;; ) {
+    if ( deadline.hasExpired() )
+      return;
+
     vector< WordArticleLink > result = readChain( chainPtr );
 
     if ( headwords
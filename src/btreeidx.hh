@@ -13,6 +13,7 @@
 #include <string>
 #include <vector>
 
+#include <QDeadlineTimer>
 #include <QFuture>
 #include <QList>
 #include <QSet>
@@ -88,17 +89,24 @@ public:
   /// is performed.
   vector< WordArticleLink > findArticles( wstring const &, bool ignoreDiacritics = false, uint32_t maxMatchCount = -1 );
 
+  /// Finds articles for several words at once, giving a chain for each of
+  /// them. The words which fold to the same index key, as the alternate forms
+  /// of a word often do, share a single lookup.
+  vector< vector< WordArticleLink > > findArticles( vector< wstring > const &, bool ignoreDiacritics = false );
+
   /// Find all unique article links in the index
   void findAllArticleLinks( QVector< WordArticleLink > & articleLinks );
 
   /// Retrieve all unique headwords from index
   void getAllHeadwords( QSet< QString > & headwords );
 
-  /// Find all article links and/or headwords in the index
+  /// Find all article links and/or headwords in the index. Stops early, with
+  /// what was found so far, once cancelled or past the deadline.
   void findArticleLinks( QVector< WordArticleLink > * articleLinks,
                          QSet< uint32_t > * offsets,
                          QSet< QString > * headwords,
-                         QAtomicInt * isCancelled = 0 );
+                         QAtomicInt * isCancelled      = 0,
+                         QDeadlineTimer const deadline = QDeadlineTimer( QDeadlineTimer::Forever ) );
 
   void findHeadWords( QSet< uint32_t > offsets, int & index, QSet< QString > * headwords, uint32_t length );
   void findSingleNodeHeadwords( uint32_t offsets, QSet< QString > * headwords );
@@ -108,6 +116,11 @@ public:
   void
   getHeadwordsFromOffsets( QList< uint32_t > & offsets, QVector< QString > & headwords, QAtomicInt * isCancelled = 0 );
 
+  /// Loads the root node and asks the OS to read ahead the nodes right below
+  /// it, so the first lookups wouldn't stall on cold index reads. Not more
+  /// than 'budget' bytes are requested, the budget is decreased accordingly.
+  void warmUpIndex( qint64 & budget, QAtomicInt & isCancelled );
+
 protected:
 
   /// Finds the offset in the btree leaf for the given word, either matching
@@ -180,6 +193,8 @@ public:
   virtual bool getHeadwords( QStringList & headwords );
   virtual void findHeadWordsWithLenth( int &, QSet< QString > * headwords, uint32_t length );
 
+  virtual void warmUp( qint64 & ioBudget, QAtomicInt & isCancelled );
+
   virtual void getArticleText( uint32_t articleAddress, QString & headword, QString & text );
 
   string const & ftsIndexName() const
@@ -213,6 +228,13 @@ public:
   /// successful, or a human-readable error string otherwise.
   virtual string const & ensureInitDone();
 
+  /// Tells whether the deferred init, if any, is over, without waiting for
+  /// it or starting it. The default implementation has none to wait for.
+  virtual bool isInitDone()
+  {
+    return true;
+  }
+
 protected:
   QMutex ftsIdxMutex;
   string ftsIdxName;
@@ -0,0 +1,234 @@
+/* This file is part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
+
+#include "bulkexporter.hh"
+#include "ankiconnector.hh"
+#include "htmlescape.hh"
+
+#include <QRegularExpression>
+#include <QThread>
+
+namespace {
+
+std::string_view const bodyStart = "<body>";
+std::string_view const bodyEnd   = "</body>";
+
+/// Returns the part of the page between its <body> and </body> tags.
+std::string_view pageBody( std::string_view page )
+{
+  auto begin = page.find( bodyStart );
+  begin      = begin == std::string_view::npos ? 0 : begin + bodyStart.size();
+
+  auto end = page.rfind( bodyEnd );
+  if ( end == std::string_view::npos || end < begin )
+    end = page.size();
+
+  return page.substr( begin, end - begin );
+}
+
+/// Drops the scripts, which are of no use outside of the article view.
+QString withoutScripts( std::string_view body )
+{
+  static QRegularExpression const scripts( R"(<script\b[^>]*>.*?</script>)",
+                                           QRegularExpression::CaseInsensitiveOption
+                                             | QRegularExpression::DotMatchesEverythingOption );
+
+  return QString::fromUtf8( body.data(), body.size() ).remove( scripts );
+}
+
+} // namespace
+
+BulkExporter::BulkExporter( ArticleMaker const & articleMaker_, Config::Class const & cfg_, QObject * parent ):
+  QObject( parent ),
+  articleMaker( articleMaker_ ),
+  ankiConnector( nullptr ),
+  cfg( cfg_ )
+{
+}
+
+BulkExporter::~BulkExporter()
+{
+  cancel();
+}
+
+bool BulkExporter::start( QStringList const & words_, unsigned groupId_, Format format_, QString const & fileName )
+{
+  if ( running ) {
+    error = tr( "Another export is in progress" );
+    return false;
+  }
+
+  error.clear();
+
+  if ( format_ == Format::Anki ) {
+    if ( !cfg.preferences.ankiConnectServer.enabled ) {
+      error = tr( "AnkiConnect is not enabled" );
+      return false;
+    }
+
+    if ( !ankiConnector ) {
+      ankiConnector = new AnkiConnector( this, cfg );
+      connect( ankiConnector, &AnkiConnector::batchProgress, this, &BulkExporter::pump );
+      connect( ankiConnector, &AnkiConnector::batchFinished, this, &BulkExporter::ankiBatchFinished );
+    }
+
+    ankiConnector->startQueue();
+  }
+  else {
+    file.setFileName( fileName );
+    if ( !file.open( QFile::WriteOnly | QFile::Truncate ) ) {
+      error = file.errorString();
+      return false;
+    }
+  }
+
+  words      = words_;
+  groupId    = groupId_;
+  format     = format_;
+  nextWord   = 0;
+  wordsDone  = 0;
+  headerDone = false;
+  running    = true;
+
+  // The dictionaries do their own work in the background, so this only limits
+  // how many articles are being assembled, and held in memory, at once.
+  maxWindowSize = qBound( 2, QThread::idealThreadCount(), 16 );
+
+  pump();
+
+  return true;
+}
+
+void BulkExporter::cancel()
+{
+  if ( running )
+    abort( tr( "Export cancelled" ) );
+}
+
+void BulkExporter::abort( QString const & errorString )
+{
+  for ( auto & article : window )
+    article.request->cancel();
+
+  finish( errorString );
+
+  // Its batchFinished() is ignored now that the export is not running
+  if ( format == Format::Anki )
+    ankiConnector->cancelQueue();
+}
+
+void BulkExporter::fillWindow()
+{
+  while ( nextWord < words.size() && (int)window.size() < maxWindowSize ) {
+    // Don't render faster than Anki is able to take the notes
+    if ( format == Format::Anki && ankiConnector->queuedNotes() >= AnkiConnector::max_queued_notes )
+      break;
+
+    Article article;
+    article.word    = words[ nextWord++ ];
+    article.request = articleMaker.makeDefinitionFor( article.word, groupId, QMap< QString, QString >() );
+
+    connect( article.request.get(),
+             &Dictionary::Request::finished,
+             this,
+             &BulkExporter::pump,
+             Qt::QueuedConnection );
+
+    window.push_back( std::move( article ) );
+  }
+}
+
+void BulkExporter::pump()
+{
+  if ( !running )
+    return;
+
+  fillWindow();
+
+  while ( !window.empty() && window.front().request->isFinished() ) {
+    Article article = std::move( window.front() );
+    window.pop_front();
+
+    auto & request = *article.request;
+    if ( request.dataSize() > 0 ) {
+      auto const & data = request.getFullData();
+      if ( !writeArticle( article.word, std::string_view( data.data(), data.size() ) ) ) {
+        abort( file.errorString() );
+        return;
+      }
+    }
+
+    emit progress( ++wordsDone, words.size() );
+
+    fillWindow();
+  }
+
+  if ( !window.empty() || nextWord < words.size() )
+    return;
+
+  // All the articles are written
+  if ( format == Format::Anki ) {
+    ankiConnector->finishQueue(); // ankiBatchFinished() follows
+    return;
+  }
+
+  if ( format == Format::Html && headerDone )
+    file.write( "</body></html>" );
+
+  finish( file.error() == QFile::NoError ? QString() : file.errorString() );
+}
+
+bool BulkExporter::writeArticle( QString const & word, std::string_view page )
+{
+  std::string_view const body = pageBody( page );
+
+  if ( format == Format::Html ) {
+    // All the pages share the same header, so the first one is used for all
+    if ( !headerDone ) {
+      auto headerSize = body.data() - page.data();
+      if ( file.write( page.data(), headerSize ) != headerSize )
+        return false;
+      headerDone = true;
+    }
+
+    return file.write( body.data(), body.size() ) == (qint64)body.size();
+  }
+
+  // Only the words which were found make sense as notes or table rows
+  if ( body.find( R"(<div class="gdnotfound">)" ) != std::string_view::npos )
+    return true;
+
+  QString const article = withoutScripts( body );
+
+  if ( format == Format::Anki ) {
+    ankiConnector->queueNote( word, article, QString() );
+    return true;
+  }
+
+  QString text = Html::unescape( article ).simplified();
+  QString line = QString( word ).replace( '\t', ' ' ).simplified() + '\t' + text + '\n';
+
+  QByteArray const bytes = line.toUtf8();
+  return file.write( bytes ) == bytes.size();
+}
+
+void BulkExporter::ankiBatchFinished( int added, int failed )
+{
+  if ( !running )
+    return;
+
+  finish( failed ? tr( "%1 of %2 notes could not be added to Anki" ).arg( failed ).arg( added + failed ) : QString() );
+}
+
+void BulkExporter::finish( QString const & errorString )
+{
+  window.clear();
+  words.clear();
+
+  if ( file.isOpen() )
+    file.close();
+
+  running = false;
+  error   = errorString;
+
+  emit finished( errorString );
+}
@@ -0,0 +1,103 @@
+#ifndef __BULKEXPORTER_HH_INCLUDED__
+#define __BULKEXPORTER_HH_INCLUDED__
+
+#include <QFile>
+#include <QObject>
+#include <QStringList>
+#include <deque>
+
+#include "article_maker.hh"
+
+class AnkiConnector;
+
+/// Renders the definitions for a list of words (e.g. a favorites folder or
+/// the history) without going through the GUI, and writes them out as a single
+/// html page, as tab-separated values or as Anki notes.
+/// Several words are looked up at once, but only a bounded number of articles
+/// is kept in memory, and they are written out in the order of the list.
+class BulkExporter: public QObject
+{
+  Q_OBJECT
+
+public:
+
+  enum class Format {
+    Html,
+    Tsv,
+    Anki
+  };
+
+  BulkExporter( ArticleMaker const & articleMaker, Config::Class const & cfg, QObject * parent = nullptr );
+
+  ~BulkExporter();
+
+  /// Starts exporting the given words, looking them up in the given group.
+  /// The fileName is not used for Format::Anki. Returns false if the export
+  /// could not be started, with errorString() telling why.
+  bool start( QStringList const & words, unsigned groupId, Format format, QString const & fileName = QString() );
+
+  /// Stops the export in progress. finished() is still emitted.
+  void cancel();
+
+  bool isRunning() const
+  {
+    return running;
+  }
+
+  QString const & errorString() const
+  {
+    return error;
+  }
+
+signals:
+
+  void progress( int done, int total );
+
+  /// Emitted when the export is over, with an empty string on success.
+  void finished( QString const & errorString );
+
+private slots:
+
+  /// Writes out the finished articles from the front of the window and
+  /// issues more lookups as long as the window and the Anki queue allow it.
+  void pump();
+
+  void ankiBatchFinished( int added, int failed );
+
+private:
+
+  struct Article
+  {
+    QString word;
+    sptr< Dictionary::DataRequest > request;
+  };
+
+  void fillWindow();
+
+  /// Returns false on a write error.
+  bool writeArticle( QString const & word, std::string_view page );
+
+  /// Cancels the lookups in flight and finishes with the given error.
+  void abort( QString const & errorString );
+
+  void finish( QString const & errorString );
+
+  ArticleMaker const & articleMaker;
+  AnkiConnector * ankiConnector; // Created with the first export to Anki
+  Config::Class const & cfg;
+
+  QStringList words;
+  unsigned groupId = 0;
+  Format format    = Format::Html;
+  QFile file;
+
+  std::deque< Article > window;
+  int maxWindowSize = 0;
+  int nextWord      = 0;
+  int wordsDone     = 0;
+  bool running      = false;
+  bool headerDone   = false;
+  QString error;
+};
+
+#endif
@@ -10,12 +10,16 @@
 
 namespace ChunkedStorage {
 
-enum {
-  ChunkMaxSize = 65536 // Can't be more since it would overflow the address
-};
+namespace {
 
-Writer::Writer( File::Index & f ):
+/// Starts the header of the second layout, in place of the chunk count
+uint32_t const WideTableSignature = 0xFFFFFFFF;
+
+} // namespace
+
+Writer::Writer( File::Index & f, unsigned chunkSizeBits_ ):
   file( f ),
+  chunkSizeBits( qBound( 10u, chunkSizeBits_, DefaultChunkSizeBits ) ),
   chunkStarted( false ),
   bufferUsed( 0 )
 {
@@ -34,7 +38,7 @@ Writer::Writer( File::Index & f ):
 
 uint32_t Writer::startNewBlock()
 {
-  if ( bufferUsed >= ChunkMaxSize ) {
+  if ( bufferUsed >= ( size_t( 1 ) << chunkSizeBits ) ) {
     // Need to flush first.
     saveCurrentChunk();
   }
@@ -42,9 +46,12 @@ uint32_t Writer::startNewBlock()
   chunkStarted = true;
 
   // The address is comprised of the offset within the chunk (in lower
-  // 16 bits, always fits there since ChunkMaxSize-1 does) and the
-  // number of the chunk, which is therefore limited to be 65535 max.
-  return bufferUsed | ( (uint32_t)offsets.size() << 16 );
+  // chunkSizeBits bits, always fits there since a new chunk is started once
+  // that much is stored) and the number of the chunk in the rest.
+  if ( offsets.size() >> ( 32 - chunkSizeBits ) )
+    throw exTooManyChunks();
+
+  return bufferUsed | ( (uint32_t)offsets.size() << chunkSizeBits );
 }
 
 void Writer::addToBlock( void const * data, size_t size )
@@ -90,24 +97,66 @@ uint32_t Writer::finish()
   if ( bufferUsed || chunkStarted )
     saveCurrentChunk();
 
-  bool useScratchPad   = false;
-  uint32_t savedOffset = 0;
+  // The original layout is kept whenever possible, so the indexes stay
+  // readable by the older versions. It needs the table to be within the
+  // first 4 GB as well, which it is when it fits into the scratch pad.
+  size_t const narrowTableSize = sizeof( uint32_t ) * ( offsets.size() + 1 );
+  qint64 const endOffset       = file.tell();
 
-  if ( scratchPadSize >= offsets.size() * sizeof( uint32_t ) + sizeof( uint32_t ) ) {
-    useScratchPad = true;
-    savedOffset   = file.tell();
-    file.seek( scratchPadOffset );
-  }
+  bool const wide = chunkSizeBits != DefaultChunkSizeBits || ( !offsets.empty() && offsets.back() > 0xFFFFFFFF )
+    || ( narrowTableSize > scratchPadSize && (quint64)endOffset > 0xFFFFFFFF );
+
+  qint64 offset;
+
+  if ( wide ) {
+    // The header always goes into the scratch pad, so it can be addressed
+    // however large the file is. The table follows it if it fits there too,
+    // and is appended to the file otherwise.
+    size_t const headerSize = sizeof( uint32_t ) * 2 + sizeof( uint64_t ) * 2;
+    size_t const tableSize  = sizeof( uint64_t ) * offsets.size();
+    bool const tableInPad   = headerSize + tableSize <= scratchPadSize;
 
-  uint32_t offset = file.tell();
+    uint64_t const tableOffset = tableInPad ? scratchPadOffset + headerSize : endOffset;
 
-  file.write( (uint32_t)offsets.size() );
+    if ( !tableInPad && tableSize )
+      file.write( &offsets.front(), tableSize );
 
-  if ( offsets.size() )
-    file.write( &offsets.front(), offsets.size() * sizeof( uint32_t ) );
+    qint64 const savedOffset = file.tell();
+
+    offset = scratchPadOffset;
+    file.seek( offset );
+
+    file.write( WideTableSignature );
+    file.write( (uint32_t)chunkSizeBits );
+    file.write( (uint64_t)offsets.size() );
+    file.write( tableOffset );
+
+    if ( tableInPad && tableSize )
+      file.write( &offsets.front(), tableSize );
 
-  if ( useScratchPad )
     file.seek( savedOffset );
+  }
+  else {
+    bool const useScratchPad = scratchPadSize >= narrowTableSize;
+
+    offset = useScratchPad ? (qint64)scratchPadOffset : endOffset;
+    file.seek( offset );
+
+    vector< uint32_t > narrowOffsets( offsets.begin(), offsets.end() );
+
+    file.write( (uint32_t)narrowOffsets.size() );
+
+    if ( narrowOffsets.size() )
+      file.write( &narrowOffsets.front(), narrowOffsets.size() * sizeof( uint32_t ) );
+
+    if ( useScratchPad )
+      file.seek( endOffset );
+  }
+
+  // The offset has to fit into the indexes' headers, so a scratch pad
+  // beyond the first 4 GB can't be made use of
+  if ( (quint64)offset > 0xFFFFFFFF )
+    throw exTableOutOfReach();
 
   offsets.clear();
   chunkStarted = false;
@@ -116,29 +165,92 @@ uint32_t Writer::finish()
 }
 
 Reader::Reader( File::Index & f, uint32_t offset ):
-  file( f )
+  file( f ),
+  chunkSizeBits( DefaultChunkSizeBits )
 {
+  QMutexLocker _( &file.lock );
+
   file.seek( offset );
 
   uint32_t size = file.read< uint32_t >();
-  if ( size == 0 )
+
+  qint64 tableOffset;
+
+  if ( size == WideTableSignature ) {
+    chunkSizeBits = file.read< uint32_t >();
+    chunkCount    = file.read< uint64_t >();
+    tableOffset   = file.read< uint64_t >();
+    wideOffsets   = true;
+
+    if ( chunkSizeBits == 0 || chunkSizeBits > DefaultChunkSizeBits )
+      throw exAddressOutOfRange();
+  }
+  else {
+    chunkCount  = size;
+    tableOffset = file.tell();
+  }
+
+  if ( chunkCount == 0 )
     return;
-  offsets.resize( size );
-  file.read( &offsets.front(), offsets.size() * sizeof( uint32_t ) );
+
+  // The count comes from the file, so it's checked against the file's size
+  // before anything gets allocated or mapped for it
+  size_t const entrySize = wideOffsets ? sizeof( uint64_t ) : sizeof( uint32_t );
+  qint64 const fileSize  = file.size();
+
+  if ( tableOffset < 0 || tableOffset > fileSize || chunkCount > uint64_t( fileSize - tableOffset ) / entrySize )
+    throw exCorruptedChunkTable();
+
+  qint64 const tableSize = chunkCount * entrySize;
+
+  mappedTable = file.map( tableOffset, tableSize );
+
+  if ( mappedTable )
+    table = mappedTable;
+  else {
+    tableCopy.resize( tableSize );
+    file.seek( tableOffset );
+    file.read( &tableCopy.front(), tableSize );
+    table = &tableCopy.front();
+  }
+}
+
+Reader::~Reader()
+{
+  if ( mappedTable ) {
+    QMutexLocker _( &file.lock );
+    file.unmap( mappedTable );
+  }
+}
+
+uint64_t Reader::chunkOffset( size_t chunkIdx ) const
+{
+  // The table isn't necessarily aligned in the file
+  if ( wideOffsets ) {
+    uint64_t value;
+    memcpy( &value, table + chunkIdx * sizeof( value ), sizeof( value ) );
+    return value;
+  }
+
+  uint32_t value;
+  memcpy( &value, table + chunkIdx * sizeof( value ), sizeof( value ) );
+  return value;
 }
 
 char * Reader::getBlock( uint32_t address, vector< char > & chunk )
 {
-  size_t chunkIdx = address >> 16;
+  size_t chunkIdx = address >> chunkSizeBits;
 
-  if ( chunkIdx >= offsets.size() )
+  if ( chunkIdx >= chunkCount )
     throw exAddressOutOfRange();
 
+  uint64_t const offset = chunkOffset( chunkIdx );
+
   // Read and decompress the chunk
   {
     // file.seek( offsets[ chunkIdx ] );
     QMutexLocker _( &file.lock );
-    auto bytes = file.map( offsets[ chunkIdx ], 8 );
+    auto bytes = file.map( offset, 8 );
     if ( bytes == nullptr )
       throw mapFailed();
     auto qBytes = QByteArray::fromRawData( reinterpret_cast< char * >( bytes ), 8 );
@@ -154,7 +266,7 @@ char * Reader::getBlock( uint32_t address, vector< char > & chunk )
     chunk.resize( uncompressedSize );
 
     // vector< unsigned char > compressedData( compressedSize );
-    auto chunkDataBytes = file.map( offsets[ chunkIdx ] + 8, compressedSize );
+    auto chunkDataBytes = file.map( offset + 8, compressedSize );
     if ( chunkDataBytes == nullptr )
       throw mapFailed();
     // file.read( &compressedData.front(), compressedData.size() );
@@ -171,7 +283,7 @@ char * Reader::getBlock( uint32_t address, vector< char > & chunk )
     }
   }
 
-  size_t offsetInChunk = address & 0xffFF;
+  size_t offsetInChunk = address & ( ( 1u << chunkSizeBits ) - 1 );
 
   if ( offsetInChunk > chunk.size() ) // It can be equal to for 0-sized blocks
     throw exAddressOutOfRange();
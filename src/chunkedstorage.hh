@@ -17,6 +17,14 @@
 /// even if its size does exceed its maximum allowed size. This is very
 /// handy since we're retrieving the data by the same blocks we used to save
 /// it as, that' the only kind of seek we support, really.
+///
+/// The chunk table comes in two layouts. The original one has 32-bit chunk
+/// offsets and 64 KB chunks. The second one, which is only written when the
+/// first can't express the data, has 64-bit chunk offsets and a chunk size
+/// chosen by the writer. Smaller chunks make retrieving a block cheaper, since
+/// less has to be decompressed, at the expense of worse compression. Its
+/// header is kept at the beginning of the file, pointing to the table, so
+/// the 32-bit table offset the indexes store is enough for files over 4 GB.
 namespace ChunkedStorage {
 
 using std::vector;
@@ -26,25 +34,39 @@ DEF_EX( exFailedToCompressChunk, "Failed to compress a chunk", Ex )
 DEF_EX( exAddressOutOfRange, "The given chunked address is out of range", Ex )
 DEF_EX( exFailedToDecompressChunk, "Failed to decompress a chunk", Ex )
 DEF_EX( mapFailed, "Failed to map/unmap the file", Ex )
+DEF_EX( exTooManyChunks, "Too many chunks for the chunk size used", Ex )
+DEF_EX( exTableOutOfReach, "The chunk table is too far into the file", Ex )
+DEF_EX( exCorruptedChunkTable, "The chunk table is corrupted", Ex )
+
+/// The chunks are 2^DefaultChunkSizeBits bytes, unless told otherwise.
+/// This is also the largest size possible, as the offset within the chunk
+/// has to fit into the lower bits of a block address.
+unsigned const DefaultChunkSizeBits = 16;
 
 /// This class writes data blocks in chunks.
 class Writer
 {
-  vector< uint32_t > offsets;
+  vector< uint64_t > offsets;
   File::Index & file;
   size_t scratchPadOffset, scratchPadSize;
+  unsigned chunkSizeBits;
 
 public:
-  explicit Writer( File::Index & );
+  /// The chunks would hold about 2^chunkSizeBits bytes of data each, with
+  /// chunkSizeBits being from 10 to DefaultChunkSizeBits. The blocks are
+  /// never split across the chunks, so the bigger ones make bigger chunks.
+  explicit Writer( File::Index &, unsigned chunkSizeBits = DefaultChunkSizeBits );
 
-  /// Starts new block. Returns its address.
+  /// Starts new block. Returns its address. The lower chunkSizeBits bits of
+  /// it are the offset within the chunk, the rest is the number of the chunk.
   uint32_t startNewBlock();
 
   /// Add data to the previously started block.
   void addToBlock( void const * data, size_t size );
 
   /// Finishes writing chunks and returns the offset to the chunk table which
-  /// gets written at the moment of finishing.
+  /// gets written at the moment of finishing. That is within the first 4 GB
+  /// in any case, unless the writer was created past them, which throws.
   uint32_t finish();
 
 private:
@@ -71,14 +93,29 @@ private:
 /// This class reads data blocks previously written by Writer.
 class Reader
 {
-  vector< uint32_t > offsets;
   File::Index & file;
 
+  // The chunk table is used right from the file's mapping, which is kept for
+  // the reader's lifetime. Should the mapping fail, a copy of it is read.
+  uchar * mappedTable = nullptr;
+  vector< uchar > tableCopy;
+  uchar const * table = nullptr;
+  size_t chunkCount   = 0;
+  bool wideOffsets    = false;
+  unsigned chunkSizeBits;
+
+  uint64_t chunkOffset( size_t chunkIdx ) const;
+
 public:
   /// Creates reader by giving it a file to read from and the offset returned
   /// by Writer::finish().
   Reader( File::Index &, uint32_t );
 
+  ~Reader();
+
+  Reader( Reader const & )             = delete;
+  Reader & operator=( Reader const & ) = delete;
+
   /// Reads the block previously written by Writer, identified by its address.
   /// Uses the user-provided storage to load the entire chunk, and then to
   /// return a pointer to the requested block inside it.
@@ -0,0 +1,266 @@
+/* This file is part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
+
+#include "asynclog.hh"
+
+#include <QDateTime>
+#include <QLoggingCategory>
+#include <QMutex>
+#include <QStringList>
+#include <QThread>
+#include <QWaitCondition>
+#include <atomic>
+
+namespace AsyncLog {
+
+namespace {
+
+/// A bounded multi-producer queue (after D. Vyukov) with a single consumer,
+/// the writer thread. Each slot's sequence tells whether it's free for the
+/// producer at the given position or filled for the consumer.
+class RingBuffer
+{
+public:
+
+  static constexpr size_t Capacity = 8192; // Must be a power of two
+
+  RingBuffer()
+  {
+    for ( size_t x = 0; x < Capacity; ++x )
+      slots[ x ].sequence.store( x, std::memory_order_relaxed );
+  }
+
+  bool push( qint64 time, QtMsgType type, QString const & text )
+  {
+    size_t pos = enqueuePos.load( std::memory_order_relaxed );
+    Slot * slot;
+
+    for ( ;; ) {
+      slot            = &slots[ pos & ( Capacity - 1 ) ];
+      size_t sequence = slot->sequence.load( std::memory_order_acquire );
+      auto diff       = (qint64)sequence - (qint64)pos;
+
+      if ( diff == 0 ) {
+        if ( enqueuePos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+          break;
+      }
+      else if ( diff < 0 )
+        return false; // Full
+      else
+        pos = enqueuePos.load( std::memory_order_relaxed );
+    }
+
+    slot->time = time;
+    slot->type = type;
+    slot->text = text;
+    slot->sequence.store( pos + 1, std::memory_order_release );
+
+    return true;
+  }
+
+  /// Consumer only
+  bool pop( qint64 & time, QtMsgType & type, QString & text )
+  {
+    size_t pos  = dequeuePos.load( std::memory_order_relaxed );
+    Slot & slot = slots[ pos & ( Capacity - 1 ) ];
+
+    if ( slot.sequence.load( std::memory_order_acquire ) != pos + 1 )
+      return false; // Empty, or the producer is not done with it yet
+
+    time = slot.time;
+    type = slot.type;
+    text.swap( slot.text );
+    slot.text.clear();
+
+    slot.sequence.store( pos + Capacity, std::memory_order_release );
+    dequeuePos.store( pos + 1, std::memory_order_relaxed );
+
+    return true;
+  }
+
+  /// An estimate, good enough to decide when to wake the writer up
+  size_t size() const
+  {
+    return enqueuePos.load( std::memory_order_relaxed ) - dequeuePos.load( std::memory_order_relaxed );
+  }
+
+private:
+
+  struct Slot
+  {
+    std::atomic< size_t > sequence;
+    qint64 time;
+    QtMsgType type;
+    QString text;
+  };
+
+  Slot slots[ Capacity ];
+  alignas( 64 ) std::atomic< size_t > enqueuePos{ 0 };
+  alignas( 64 ) std::atomic< size_t > dequeuePos{ 0 };
+};
+
+class Writer: public QThread
+{
+public:
+
+  RingBuffer buffer;
+  std::atomic< quint64 > dropped{ 0 };
+
+  QMutex mutex;
+  QWaitCondition wakeUp;
+  std::atomic< bool > stopping{ false };
+
+  QFile * file = nullptr;
+
+protected:
+
+  void run() override;
+
+private:
+
+  /// Writes out everything which is in the buffer by now, with a single flush.
+  void drain();
+
+  quint64 droppedReported = 0;
+};
+
+// How often the writer looks into the buffer when nobody wakes it up
+int const writeInterval = 200; // ms
+
+char const * levelName( QtMsgType type )
+{
+  switch ( type ) {
+    case QtDebugMsg:
+      return "Debug: ";
+    case QtWarningMsg:
+      return "Warning: ";
+    case QtCriticalMsg:
+      return "Critical: ";
+    case QtFatalMsg:
+      return "Fatal: ";
+    case QtInfoMsg:
+      return "Info: ";
+  }
+  return "";
+}
+
+void Writer::run()
+{
+  while ( !stopping.load( std::memory_order_acquire ) ) {
+    drain();
+
+    QMutexLocker _( &mutex );
+    if ( !stopping.load( std::memory_order_acquire ) )
+      wakeUp.wait( &mutex, writeInterval );
+  }
+
+  drain();
+}
+
+void Writer::drain()
+{
+  QByteArray out;
+  qint64 time;
+  QtMsgType type;
+  QString text;
+
+  while ( buffer.pop( time, type, text ) ) {
+    out += levelName( type );
+    out += QDateTime::fromMSecsSinceEpoch( time ).toString( "MM-dd hh:mm:ss" ).toLatin1();
+    out += ' ';
+    out += text.toUtf8();
+    out += "\r\n";
+  }
+
+  quint64 droppedNow = dropped.load( std::memory_order_relaxed );
+  if ( droppedNow != droppedReported ) {
+    out += QString( "Warning: %1 log messages were dropped\r\n" ).arg( droppedNow - droppedReported ).toLatin1();
+    droppedReported = droppedNow;
+  }
+
+  if ( out.isEmpty() )
+    return;
+
+  file->write( out );
+  file->flush();
+}
+
+Writer * writer = nullptr;
+
+} // namespace
+
+void start( QFile * file )
+{
+  if ( writer )
+    return;
+
+  writer       = new Writer;
+  writer->file = file;
+  writer->start( QThread::LowPriority );
+}
+
+void stop()
+{
+  if ( !writer )
+    return;
+
+  {
+    QMutexLocker _( &writer->mutex );
+    writer->stopping.store( true, std::memory_order_release );
+    writer->wakeUp.wakeOne();
+  }
+
+  writer->wait();
+
+  // Not deleted, since other threads might still be posting. Anything they
+  // post from now on is just never written.
+}
+
+bool isRunning()
+{
+  return writer && !writer->stopping.load( std::memory_order_acquire );
+}
+
+bool post( QtMsgType type, QString const & message )
+{
+  if ( !writer )
+    return false;
+
+  if ( !writer->buffer.push( QDateTime::currentMSecsSinceEpoch(), type, message ) ) {
+    writer->dropped.fetch_add( 1, std::memory_order_relaxed );
+    return false;
+  }
+
+  // Normally the writer catches up on its own; only hurry it up when the
+  // buffer is getting full. Waking it up doesn't need the mutex.
+  if ( writer->buffer.size() >= RingBuffer::Capacity / 2 )
+    writer->wakeUp.wakeOne();
+
+  return true;
+}
+
+quint64 droppedCount()
+{
+  return writer ? writer->dropped.load( std::memory_order_relaxed ) : 0;
+}
+
+void setLevels( QString const & spec )
+{
+  static QStringList const levels = { "debug", "info", "warning", "critical" };
+
+  QStringList rules;
+
+  for ( auto const & item : spec.split( ';', Qt::SkipEmptyParts ) ) {
+    auto const category = item.section( '=', 0, 0 ).trimmed();
+    auto const minLevel = levels.indexOf( item.section( '=', 1 ).trimmed().toLower() );
+
+    if ( category.isEmpty() || minLevel < 0 )
+      continue;
+
+    for ( int x = 0; x < levels.size(); ++x )
+      rules.append( QString( "%1.%2=%3" ).arg( category, levels[ x ], x >= minLevel ? "true" : "false" ) );
+  }
+
+  QLoggingCategory::setFilterRules( rules.join( '\n' ) );
+}
+
+} // namespace AsyncLog
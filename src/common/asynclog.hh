@@ -0,0 +1,41 @@
+/* This file is part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
+
+#ifndef __ASYNCLOG_HH_INCLUDED__
+#define __ASYNCLOG_HH_INCLUDED__
+
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+
+/// Writes the log messages to a file from a background thread, so the threads
+/// producing them never wait for the disk or for each other. The messages are
+/// passed through a lock-free ring buffer; when it is full, they are dropped
+/// and counted instead of blocking the caller.
+namespace AsyncLog {
+
+/// Starts the writer thread, appending to the given already opened file.
+void start( QFile * file );
+
+/// Writes out all the pending messages and stops the writer thread. Safe to
+/// call when it isn't running.
+void stop();
+
+bool isRunning();
+
+/// Queues the message. Returns false if it was dropped since the buffer is
+/// full. Can be called from any thread.
+bool post( QtMsgType type, QString const & message );
+
+/// The number of messages dropped so far.
+quint64 droppedCount();
+
+/// Sets the minimum level of the messages logged, per logging category.
+/// The spec is a list like "default=warning;qt.network=critical", with
+/// levels being debug, info, warning and critical. The filtering is done by
+/// QLoggingCategory, so the disabled messages aren't even formatted. Can be
+/// called at any time.
+void setLevels( QString const & spec );
+
+} // namespace AsyncLog
+
+#endif
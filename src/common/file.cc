@@ -4,12 +4,19 @@
 #include "file.hh"
 
 #include "zipfile.hh"
+#include "indexpack.hh"
 
 #include <string>
 #include <QFileInfo>
 #ifdef __WIN32
   #include <windows.h>
 #endif
+#if defined( Q_OS_UNIX ) && !defined( Q_OS_MACOS )
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <unistd.h>
+#endif
+#include <cstring>
 
 namespace File {
 
@@ -77,11 +84,51 @@ void Index::open( char const * mode )
 Index::Index( std::string_view filename, char const * mode )
 {
   f.setFileName( QString::fromUtf8( filename.data(), filename.size() ) );
-  open( mode );
+
+  // A standalone file is always newer than its segment in the pack, since
+  // those get moved into the pack on startup.
+  bool const readOnly = !strchr( mode, 'w' ) && !strchr( mode, '+' ) && !strchr( mode, 'a' );
+
+  IndexPack::Segment segment;
+  if ( readOnly && IndexPack::findSegment( filename, segment ) && !f.exists() ) {
+    packed     = segment.data;
+    packedSize = segment.size;
+    return;
+  }
+
+  try {
+    open( mode );
+  }
+  catch ( exCantOpen & ) {
+    // The file might have just been moved into the pack in the background
+    if ( !readOnly || !IndexPack::findSegment( filename, segment ) )
+      throw;
+
+    packed     = segment.data;
+    packedSize = segment.size;
+  }
+}
+
+qint64 Index::readPacked( char * buf, qint64 size )
+{
+  qint64 available = qMax( packedSize - packedPos, (qint64)0 );
+  if ( size > available )
+    size = available;
+
+  memcpy( buf, packed + packedPos, size );
+  packedPos += size;
+
+  return size;
 }
 
 void Index::read( void * buf, qint64 size )
 {
+  if ( packed ) {
+    if ( readPacked( static_cast< char * >( buf ), size ) != size )
+      throw exReadError();
+    return;
+  }
+
   if ( f.read( static_cast< char * >( buf ), size ) != size ) {
     throw exReadError();
   }
@@ -89,7 +136,8 @@ void Index::read( void * buf, qint64 size )
 
 size_t Index::readRecords( void * buf, qint64 size, qint64 count )
 {
-  qint64 result = f.read( static_cast< char * >( buf ), size * count );
+  char * data   = static_cast< char * >( buf );
+  qint64 result = packed ? readPacked( data, size * count ) : f.read( data, size * count );
   return result < 0 ? result : result / size;
 }
 
@@ -99,7 +147,7 @@ void Index::write( void const * buf, qint64 size )
     return;
   }
 
-  if ( size < 0 ) {
+  if ( size < 0 || packed ) {
     throw exWriteError();
   }
 
@@ -108,13 +156,32 @@ void Index::write( void const * buf, qint64 size )
 
 size_t Index::writeRecords( void const * buf, qint64 size, qint64 count )
 {
+  if ( packed )
+    return 0;
+
   qint64 result = f.write( static_cast< const char * >( buf ), size * count );
   return result < 0 ? result : result / size;
 }
 
 char * Index::gets( char * s, int size, bool stripNl )
 {
-  qint64 len    = f.readLine( s, size );
+  qint64 len;
+
+  if ( packed ) {
+    // Same as QFile::readLine(): stop after a newline, always terminate
+    len = 0;
+    while ( len < size - 1 && packedPos < packedSize ) {
+      char c      = packed[ packedPos++ ];
+      s[ len++ ] = c;
+      if ( c == '\n' )
+        break;
+    }
+    if ( size > 0 )
+      s[ len ] = 0;
+  }
+  else
+    len = f.readLine( s, size );
+
   char * result = len > 0 ? s : nullptr;
 
   if ( result && stripNl ) {
@@ -146,29 +213,84 @@ std::string Index::gets( bool stripNl )
 
 QByteArray Index::readall()
 {
+  if ( packed ) {
+    QByteArray result( reinterpret_cast< char const * >( packed ) + packedPos, packedSize - packedPos );
+    packedPos = packedSize;
+    return result;
+  }
+
   return f.readAll();
 };
 
 
 void Index::seek( qint64 offset )
 {
+  if ( packed ) {
+    if ( offset < 0 || offset > packedSize )
+      throw exSeekError();
+    packedPos = offset;
+    return;
+  }
+
   if ( !f.seek( offset ) )
     throw exSeekError();
 }
 
 uchar * Index::map( qint64 offset, qint64 size )
 {
+  if ( packed ) {
+    // The pack is mapped read-only, callers never write through the result
+    if ( offset < 0 || size < 0 || offset + size > packedSize )
+      return nullptr;
+    return const_cast< uchar * >( packed + offset );
+  }
+
   return f.map( offset, size );
 }
 
 bool Index::unmap( uchar * address )
 {
+  if ( packed )
+    return true; // The pack stays mapped
+
   return f.unmap( address );
 }
 
+void Index::adviseWillNeed( qint64 offset, qint64 size )
+{
+#if defined( Q_OS_UNIX ) && !defined( Q_OS_MACOS )
+  if ( size <= 0 )
+    return;
+
+  if ( packed ) {
+    // madvise() wants a page-aligned start
+    if ( offset < 0 || offset >= packedSize )
+      return;
+    size = qMin( size, packedSize - offset );
+
+    quintptr const pageMask = ~( (quintptr)sysconf( _SC_PAGESIZE ) - 1 );
+    quintptr start          = (quintptr)( packed + offset );
+    quintptr alignedStart   = start & pageMask;
+
+    madvise( (void *)alignedStart, size + ( start - alignedStart ), MADV_WILLNEED );
+    return;
+  }
+
+  posix_fadvise( f.handle(), offset, size, POSIX_FADV_WILLNEED );
+#else
+  Q_UNUSED( offset )
+  Q_UNUSED( size )
+#endif
+}
+
 
 void Index::seekEnd()
 {
+  if ( packed ) {
+    packedPos = packedSize;
+    return;
+  }
+
   if ( !f.seek( f.size() ) )
     throw exSeekError();
 }
@@ -180,12 +302,17 @@ void Index::rewind()
 
 qint64 Index::tell()
 {
-  return f.pos();
+  return packed ? packedPos : f.pos();
+}
+
+qint64 Index::size() const
+{
+  return packed ? packedSize : f.size();
 }
 
 bool Index::eof() const
 {
-  return f.atEnd();
+  return packed ? packedPos >= packedSize : f.atEnd();
 }
 
 QFile & Index::file()
@@ -195,6 +322,7 @@ QFile & Index::file()
 
 void Index::close()
 {
+  packed = nullptr;
   f.close();
 }
 
@@ -40,10 +40,17 @@ class Index
 {
   QFile f;
 
+  // When opened for reading from the packed index store (see indexpack.hh),
+  // the data is served from the pack's mapping and 'f' is left closed.
+  uchar const * packed = nullptr;
+  qint64 packedSize    = 0;
+  qint64 packedPos     = 0;
+
 public:
   QMutex lock;
 
-  // Create QFile Object and open() it.
+  // Create QFile Object and open() it. Read-only opens of index files which
+  // only exist in the packed index store are served from there.
   Index( std::string_view filename, char const * mode );
 
   /// QFile::read  & QFile::write , but with exception throwing
@@ -97,15 +104,23 @@ public:
   /// Tells the current position within the file, relative to its beginning.
   qint64 tell();
 
+  /// The size of the file.
+  qint64 size() const;
+
   /// QFile::atEnd() const
   bool eof() const;
 
   uchar * map( qint64 offset, qint64 size );
   bool unmap( uchar * address );
 
+  /// Hints the OS that the given range will be read soon, so it could be
+  /// brought into the page cache in background. Does nothing where no such
+  /// facility is available.
+  void adviseWillNeed( qint64 offset, qint64 size );
+
 
   /// Returns the underlying QFile* , so other operations can be
-  /// performed on it.
+  /// performed on it. Not usable for the indexes served from the pack.
   QFile & file();
 
   /// Closes the file. No further operations are valid.
@@ -117,6 +132,9 @@ private:
   // QFile::open but with fopen-like mode settings.
   void open( char const * mode );
 
+  // Copies up to 'size' bytes from the pack, returns the amount copied.
+  qint64 readPacked( char * buf, qint64 size );
+
   template< typename T >
   void readType( T & value )
   {
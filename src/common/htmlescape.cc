@@ -6,128 +6,227 @@
 
 #include <QRegularExpression>
 
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+
 #include "htmlescape.hh"
 
 namespace Html {
 
-string escape( string const & str )
+namespace {
+
+/// Returns the first of the given chars found in [ begin, end ), or end.
+/// The text is checked eight bytes at a time, which for a word holding none
+/// of the chars, the usual case by far, takes a few arithmetic operations
+/// rather than a comparison per byte and char.
+template< char... Chars >
+char const * findFirstOf( char const * begin, char const * end )
+{
+  uint64_t const ones  = 0x0101010101010101ULL;
+  uint64_t const highs = 0x8080808080808080ULL;
+
+  // Has the high bit set in some byte if the word has a zero byte
+  auto const hasZero = [ & ]( uint64_t v ) {
+    return ( v - ones ) & ~v & highs;
+  };
+
+  for ( uint64_t word; end - begin >= 8; begin += 8 ) {
+    memcpy( &word, begin, sizeof( word ) );
+
+    if ( ( hasZero( word ^ ( (unsigned char)Chars * ones ) ) | ... ) )
+      break; // Some of the chars is in there
+  }
+
+  for ( ; begin != end; ++begin )
+    if ( ( ( *begin == Chars ) || ... ) )
+      return begin;
+
+  return end;
+}
+
+template< char... Chars >
+size_t countOf( char const * begin, char const * end )
 {
-  string result( str );
+  size_t count = 0;
+
+  for ( ; ( begin = findFirstOf< Chars... >( begin, end ) ) != end; ++begin )
+    ++count;
+
+  return count;
+}
+
+/// Appends the text with &, <, > and " replaced by the entities. The \r chars
+/// are dropped if dropCr is set.
+template< bool dropCr >
+void appendEscaped( string & result, char const * begin, char const * end )
+{
+  for ( ;; ) {
+    char const * next = dropCr ? findFirstOf< '&', '<', '>', '"', '\r' >( begin, end ) :
+                                 findFirstOf< '&', '<', '>', '"' >( begin, end );
+
+    result.append( begin, next );
 
-  for ( size_t x = result.size(); x--; )
-    switch ( result[ x ] ) {
+    if ( next == end )
+      return;
+
+    switch ( *next ) {
       case '&':
-        result.erase( x, 1 );
-        result.insert( x, "&amp;" );
+        result += "&amp;";
         break;
-
       case '<':
-        result.erase( x, 1 );
-        result.insert( x, "&lt;" );
+        result += "&lt;";
         break;
-
       case '>':
-        result.erase( x, 1 );
-        result.insert( x, "&gt;" );
+        result += "&gt;";
         break;
-
       case '"':
-        result.erase( x, 1 );
-        result.insert( x, "&quot;" );
+        result += "&quot;";
         break;
-
-      default:
+      default: // \r
         break;
     }
 
-  return result;
+    begin = next + 1;
+  }
 }
 
-static void storeLineInDiv( string & result, string const & line, bool baseRightToLeft )
+bool isAscii( char const * begin, char const * end )
 {
-  result += "<div";
-  if ( unescape( QString::fromUtf8( line.c_str(), line.size() ) ).isRightToLeft() != baseRightToLeft ) {
-    result += " dir=\"";
-    result += baseRightToLeft ? "ltr\"" : "rtl\"";
+  uint64_t const highs = 0x8080808080808080ULL;
+
+  for ( uint64_t word; end - begin >= 8; begin += 8 ) {
+    memcpy( &word, begin, sizeof( word ) );
+    if ( word & highs )
+      return false;
   }
-  result += ">";
-  result += line + "</div>";
+
+  for ( ; begin != end; ++begin )
+    if ( *begin & 0x80 )
+      return false;
+
+  return true;
+}
+
+/// Whether the text of the line is right-to-left. The line is checked as it
+/// is, since neither the escaping nor the leading &nbsp;s change its first
+/// strongly directional char.
+bool isRightToLeft( char const * begin, char const * end )
+{
+  return !isAscii( begin, end ) && QString::fromUtf8( begin, end - begin ).isRightToLeft();
+}
+
+} // namespace
+
+string escape( string const & str )
+{
+  char const * begin = str.data();
+  char const * end   = begin + str.size();
+
+  size_t const specials = countOf< '&', '<', '>', '"' >( begin, end );
+
+  if ( !specials )
+    return str;
+
+  string result;
+  result.reserve( str.size() + specials * ( sizeof( "&quot;" ) - 2 ) );
+
+  appendEscaped< false >( result, begin, end );
+
+  return result;
 }
 
 string preformat( string const & str, bool baseRightToLeft )
 {
-  string escaped = escape( str ), result, line;
+  string result;
+  result.reserve( str.size() + str.size() / 4 + 64 );
 
-  line.reserve( escaped.size() );
-  result.reserve( escaped.size() );
+  // The text ends at the first zero byte, should there be one
+  char const * ptr = str.c_str();
+  char const * end = ptr + strlen( ptr );
 
-  bool leading = true;
+  while ( ptr != end ) {
+    char const * lineEnd = std::find( ptr, end, '\n' );
+    bool const lastLine  = lineEnd == end;
 
-  for ( char const * nextChar = escaped.c_str(); *nextChar; ++nextChar ) {
-    if ( leading ) {
-      if ( *nextChar == ' ' ) {
-        line += "&nbsp;";
-        continue;
-      }
-      else if ( *nextChar == '\t' ) {
-        line += "&nbsp;&nbsp;&nbsp;&nbsp;";
-        continue;
-      }
+    size_t const divStart = result.size();
+
+    result += "<div";
+    if ( isRightToLeft( ptr, lineEnd ) != baseRightToLeft ) {
+      result += " dir=\"";
+      result += baseRightToLeft ? "ltr\"" : "rtl\"";
     }
+    result += ">";
+
+    size_t const lineStart = result.size();
 
-    if ( *nextChar == '\n' ) {
-      storeLineInDiv( result, line, baseRightToLeft );
-      line.clear();
-      leading = true;
-      continue;
+    // Leading spaces and tabs are kept. All \r chars are just skipped.
+    for ( ; ptr != lineEnd; ++ptr ) {
+      if ( *ptr == ' ' )
+        result += "&nbsp;";
+      else if ( *ptr == '\t' )
+        result += "&nbsp;&nbsp;&nbsp;&nbsp;";
+      else if ( *ptr != '\r' )
+        break;
     }
 
-    if ( *nextChar == '\r' )
-      continue; // Just skip all \r
+    appendEscaped< true >( result, ptr, lineEnd );
 
-    line.push_back( *nextChar );
+    // The last line is only added if there's something in it
+    if ( lastLine && result.size() == lineStart ) {
+      result.resize( divStart );
+      break;
+    }
 
-    leading = false;
-  }
+    result += "</div>";
 
-  if ( !line.empty() )
-    storeLineInDiv( result, line, baseRightToLeft );
+    ptr = lastLine ? end : lineEnd + 1;
+  }
 
   return result;
 }
 
 string escapeForJavaScript( string const & str )
 {
-  string result( str );
+  char const * begin = str.data();
+  char const * end   = begin + str.size();
 
-  for ( size_t x = result.size(); x--; )
-    switch ( result[ x ] ) {
-      case '\\':
-      case '"':
-      case '\'':
-        result.insert( x, 1, '\\' );
-        break;
+  // Each of them takes a backslash more
+  size_t const specials = countOf< '\\', '"', '\'', '\n', '\r', '\t' >( begin, end );
+
+  if ( !specials )
+    return str;
 
+  string result;
+  result.reserve( str.size() + specials );
+
+  for ( ;; ) {
+    char const * next = findFirstOf< '\\', '"', '\'', '\n', '\r', '\t' >( begin, end );
+
+    result.append( begin, next );
+
+    if ( next == end )
+      return result;
+
+    result += '\\';
+
+    switch ( *next ) {
       case '\n':
-        result.erase( x, 1 );
-        result.insert( x, "\\n" );
+        result += 'n';
         break;
-
       case '\r':
-        result.erase( x, 1 );
-        result.insert( x, "\\r" );
+        result += 'r';
         break;
-
       case '\t':
-        result.erase( x, 1 );
-        result.insert( x, "\\t" );
+        result += 't';
         break;
-
       default:
+        result += *next;
         break;
     }
 
-  return result;
+    begin = next + 1;
+  }
 }
 
 QString stripHtml( QString & tmp )
@@ -156,28 +255,43 @@ QString unescape( QString const & str, HtmlOption option )
 
 QString fromHtmlEscaped( QString const & str )
 {
-  QString retVal = str;
-  QRegularExpression regExp( R"((?<lt>\&lt\;)|(?<gt>\&gt\;)|(?<amp>\&amp\;)|(?<quot>\&quot\;))",
-                             QRegularExpression::PatternOption::CaseInsensitiveOption );
-  auto match = regExp.match( str, 0 );
-
-  while ( match.hasMatch() ) {
-    if ( !match.captured( "lt" ).isEmpty() ) {
-      retVal.replace( match.capturedStart( "lt" ), match.capturedLength( "lt" ), "<" );
-    }
-    else if ( !match.captured( "gt" ).isEmpty() ) {
-      retVal.replace( match.capturedStart( "gt" ), match.capturedLength( "gt" ), ">" );
-    }
-    else if ( !match.captured( "amp" ).isEmpty() ) {
-      retVal.replace( match.capturedStart( "amp" ), match.capturedLength( "amp" ), "&" );
-    }
-    else if ( !match.captured( "quot" ).isEmpty() ) {
-      retVal.replace( match.capturedStart( "quot" ), match.capturedLength( "quot" ), "\"" );
+  static struct
+  {
+    QLatin1String entity;
+    QChar ch;
+  } const entities[] = {
+    { QLatin1String( "&lt;" ), '<' },
+    { QLatin1String( "&gt;" ), '>' },
+    { QLatin1String( "&amp;" ), '&' },
+    { QLatin1String( "&quot;" ), '"' },
+  };
+
+  qsizetype amp = str.indexOf( '&' );
+
+  if ( amp < 0 )
+    return str;
+
+  QString result;
+  result.reserve( str.size() );
+
+  QStringView const view( str );
+  qsizetype copied = 0;
+
+  // Single pass, so an & which was just unescaped is never unescaped again
+  for ( ; amp >= 0; amp = str.indexOf( '&', amp + 1 ) ) {
+    for ( auto const & e : entities ) {
+      if ( view.mid( amp ).startsWith( e.entity, Qt::CaseInsensitive ) ) {
+        result += view.mid( copied, amp - copied );
+        result += e.ch;
+        copied = amp + e.entity.size();
+        break;
+      }
     }
-    match = regExp.match( retVal, match.capturedStart() + 1 );
   }
 
-  return retVal;
+  result += view.mid( copied );
+
+  return result;
 }
 
 string unescapeUtf8( const string & str, HtmlOption option )
@@ -0,0 +1,230 @@
+/* This file is part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
+
+#include "htmlrewriter.hh"
+
+namespace Html {
+
+namespace {
+
+inline bool isSpace( char c )
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+inline char toLower( char c )
+{
+  return c >= 'A' && c <= 'Z' ? c + ( 'a' - 'A' ) : c;
+}
+
+inline bool isLetter( char c )
+{
+  return ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' );
+}
+
+bool equalsLowercase( std::string_view str, std::string_view lowercase )
+{
+  if ( str.size() != lowercase.size() )
+    return false;
+
+  for ( size_t x = 0; x < str.size(); ++x )
+    if ( toLower( str[ x ] ) != lowercase[ x ] )
+      return false;
+
+  return true;
+}
+
+/// Finds the given lowercase string in html, case-insensitively, starting
+/// from pos. Returns npos if there's none.
+size_t findLowercase( std::string_view html, std::string_view lowercase, size_t pos )
+{
+  while ( pos < html.size() ) {
+    pos = html.find( '<', pos );
+
+    if ( pos == std::string_view::npos )
+      break;
+
+    if ( equalsLowercase( html.substr( pos, lowercase.size() ), lowercase ) )
+      return pos;
+
+    ++pos;
+  }
+
+  return std::string_view::npos;
+}
+
+void appendQuoted( std::string & out, std::string const & value )
+{
+  out += '"';
+
+  for ( char c : value ) {
+    if ( c == '"' )
+      out += "&quot;";
+    else
+      out += c;
+  }
+
+  out += '"';
+}
+
+} // namespace
+
+bool Tag::is( std::string_view name_ ) const
+{
+  return equalsLowercase( name, name_ );
+}
+
+Tag::Attribute * Tag::find( std::string_view name_ )
+{
+  for ( auto & attribute : attributes )
+    if ( equalsLowercase( attribute.name, name_ ) )
+      return &attribute;
+
+  return nullptr;
+}
+
+std::optional< std::string_view > Tag::attribute( std::string_view name_ ) const
+{
+  for ( auto const & attribute : attributes )
+    if ( equalsLowercase( attribute.name, name_ ) )
+      return attribute.value;
+
+  return {};
+}
+
+void Tag::setAttribute( std::string_view name_, std::string value )
+{
+  if ( Attribute * attribute = find( name_ ) )
+    attribute->replacement = std::move( value );
+}
+
+std::string rewriteTags( std::string_view html, std::function< void( Tag & ) > const & callback )
+{
+  std::string out;
+  out.reserve( html.size() + html.size() / 8 );
+
+  Tag tag;
+
+  size_t copied = 0; // Everything before this position is already in 'out'
+  size_t pos    = 0;
+
+  while ( ( pos = html.find( '<', pos ) ) != std::string_view::npos ) {
+    ++pos;
+
+    if ( pos >= html.size() )
+      break;
+
+    if ( html.compare( pos, 3, "!--" ) == 0 ) {
+      // A comment, skip it entirely
+      size_t end = html.find( "-->", pos + 3 );
+      pos        = end == std::string_view::npos ? html.size() : end + 3;
+      continue;
+    }
+
+    if ( !isLetter( html[ pos ] ) )
+      continue; // An end tag, a doctype or just a stray '<'
+
+    // The tag name
+
+    size_t nameBegin = pos;
+    while ( pos < html.size() && !isSpace( html[ pos ] ) && html[ pos ] != '>' && html[ pos ] != '/' )
+      ++pos;
+
+    tag.name = html.substr( nameBegin, pos - nameBegin );
+    tag.attributes.clear();
+
+    // The attributes
+
+    bool closed = false;
+
+    while ( pos < html.size() ) {
+      char c = html[ pos ];
+
+      if ( isSpace( c ) || c == '/' ) {
+        ++pos;
+        continue;
+      }
+
+      if ( c == '>' ) {
+        closed = true;
+        ++pos;
+        break;
+      }
+
+      size_t attrNameBegin = pos;
+      while ( pos < html.size() && !isSpace( html[ pos ] ) && html[ pos ] != '=' && html[ pos ] != '>'
+              && html[ pos ] != '/' )
+        ++pos;
+
+      if ( pos == attrNameBegin ) {
+        // A lone '=', just skip it
+        ++pos;
+        continue;
+      }
+
+      Tag::Attribute attribute;
+      attribute.name  = html.substr( attrNameBegin, pos - attrNameBegin );
+      attribute.begin = attribute.end = pos;
+
+      size_t afterName = pos;
+
+      while ( pos < html.size() && isSpace( html[ pos ] ) )
+        ++pos;
+
+      if ( pos < html.size() && html[ pos ] == '=' ) {
+        ++pos;
+
+        while ( pos < html.size() && isSpace( html[ pos ] ) )
+          ++pos;
+
+        if ( pos < html.size() && ( html[ pos ] == '"' || html[ pos ] == '\'' ) ) {
+          char quote      = html[ pos ];
+          size_t valueEnd = html.find( quote, pos + 1 );
+          if ( valueEnd == std::string_view::npos )
+            valueEnd = html.size();
+          attribute.value = html.substr( pos + 1, valueEnd - pos - 1 );
+          pos             = valueEnd < html.size() ? valueEnd + 1 : valueEnd;
+        }
+        else {
+          size_t valueBegin = pos;
+          while ( pos < html.size() && !isSpace( html[ pos ] ) && html[ pos ] != '>' )
+            ++pos;
+          attribute.value = html.substr( valueBegin, pos - valueBegin );
+        }
+
+        attribute.end = pos;
+      }
+      else
+        pos = afterName; // An attribute without a value
+
+      tag.attributes.push_back( attribute );
+    }
+
+    if ( !closed )
+      break; // Truncated tag, leave the rest as it is
+
+    callback( tag );
+
+    for ( auto const & attribute : tag.attributes ) {
+      if ( !attribute.replacement )
+        continue;
+
+      out.append( html.data() + copied, attribute.begin - copied );
+      out += '=';
+      appendQuoted( out, *attribute.replacement );
+      copied = attribute.end;
+    }
+
+    // Don't look for tags inside scripts and styles
+
+    if ( tag.is( "script" ) || tag.is( "style" ) ) {
+      size_t end = findLowercase( html, tag.is( "script" ) ? "</script" : "</style", pos );
+      pos        = end == std::string_view::npos ? html.size() : end;
+    }
+  }
+
+  out.append( html.data() + copied, html.size() - copied );
+
+  return out;
+}
+
+} // namespace Html
@@ -0,0 +1,61 @@
+/* This file is part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
+
+#ifndef GOLDENDICT_HTMLREWRITER_HH
+#define GOLDENDICT_HTMLREWRITER_HH
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Html {
+
+/// A start tag as seen by rewriteTags(). Its attributes can be inspected
+/// and their values replaced.
+class Tag
+{
+public:
+
+  /// Checks the tag name, case-insensitively. The name must be lowercase.
+  bool is( std::string_view name ) const;
+
+  /// Returns the value of the given attribute as it is in the source, that
+  /// is, without the quotes, but with any html entities left intact. The
+  /// name is matched case-insensitively and must be lowercase. An empty
+  /// optional is returned if there's no such attribute.
+  std::optional< std::string_view > attribute( std::string_view name ) const;
+
+  /// Replaces the value of an existing attribute. The value is written out
+  /// double-quoted, with any double quotes in it escaped.
+  void setAttribute( std::string_view name, std::string value );
+
+private:
+
+  friend std::string rewriteTags( std::string_view, std::function< void( Tag & ) > const & );
+
+  struct Attribute
+  {
+    std::string_view name, value;
+    // The span of the value in the source, including quotes and the '='
+    // sign, if there's any value at all
+    size_t begin, end;
+    std::optional< std::string > replacement;
+  };
+
+  Attribute * find( std::string_view name );
+
+  std::string_view name;
+  std::vector< Attribute > attributes;
+};
+
+/// Rewrites the attributes of the start tags of an utf8 html text in a
+/// single pass. The callback is called for every start tag and may replace
+/// attribute values; everything else is copied verbatim. Comments and the
+/// contents of script and style elements are copied as is, without looking
+/// for tags inside them.
+std::string rewriteTags( std::string_view html, std::function< void( Tag & ) > const & );
+
+} // namespace Html
+
+#endif
@@ -0,0 +1,645 @@
+/* This file is part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
+
+#include "indexpack.hh"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThread>
+#include <QDebug>
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace IndexPack {
+
+namespace {
+
+enum {
+  Signature            = 0x4b504447, // GDPK on little-endian machines
+  CurrentFormatVersion = 2,
+  SegmentAlignment     = 4096, // Keeps the segments page-aligned
+  IdSize               = 32    // Dictionary ids are md5 hashes in hex
+};
+
+// The pack is compacted once at least this much of it, and at least a third
+// of it, is taken by the segments no longer used
+qint64 const minDeadBytes = 16 * 1024 * 1024;
+
+/// The directory of the segments is at the end of the file, so the new
+/// segments can be appended along with a new directory, and the header then
+/// switched over to it. Format version 1 had the directory right after the
+/// header, with its entry count in place of the offset.
+struct PackHeader
+{
+  uint32_t signature;
+  uint32_t formatVersion;
+  quint64 directoryOffset;
+}
+#ifndef _MSC_VER
+__attribute__( ( packed ) )
+#endif
+;
+
+struct DirectoryHeader
+{
+  uint32_t entryCount;
+  uint32_t reserved;
+}
+#ifndef _MSC_VER
+__attribute__( ( packed ) )
+#endif
+;
+
+struct PackEntry
+{
+  char id[ IdSize ];
+  quint64 offset;
+  quint64 size;
+  qint64 lastModified;
+}
+#ifndef _MSC_VER
+__attribute__( ( packed ) )
+#endif
+;
+
+struct PackedSegment: Segment
+{
+  quint64 offset = 0; // In the pack
+};
+
+using SegmentMap = std::map< std::string, PackedSegment, std::less<> >;
+
+QMutex packMutex; // Guards the mappings and maps below
+bool initialized = false;
+std::string packDir;
+QFile packFile;
+SegmentMap segments;
+uint32_t packVersion = 0; // Of the pack mapped, 0 if there's none
+
+// The shared read-only index directory, see init()
+std::string sharedDir;
+QFile sharedPackFile;
+SegmentMap sharedSegments;
+
+// The standalone files of the shared directory get mapped on first use. The
+// ones not found there are remembered too, with null data.
+std::map< std::string, Segment, std::less<> > sharedFiles;
+std::vector< std::unique_ptr< QFile > > sharedMappedFiles;
+
+// Serializes the writes to the pack, done by the packer thread and by
+// dropSegments()
+QMutex writeMutex;
+QThread * packer = nullptr;
+std::atomic< bool > stopping{ false };
+
+QString packFileName( QString const & indexDir )
+{
+  return indexDir + "indexes.pack";
+}
+
+/// Where a compacted pack is written, to replace the pack on the next start,
+/// before anything is mapped from it
+QString compactedPackFileName( QString const & indexDir )
+{
+  return packFileName( indexDir ) + ".new";
+}
+
+bool isIndexId( QString const & name )
+{
+  if ( name.size() != IdSize )
+    return false;
+
+  for ( QChar c : name )
+    if ( !( ( c >= '0' && c <= '9' ) || ( c >= 'a' && c <= 'f' ) ) )
+      return false;
+
+  return true;
+}
+
+/// Parses the directory of the pack mapped at 'data'. Returns false if
+/// it isn't a pack we can use.
+bool readDirectory( uchar const * data, qint64 size, SegmentMap & out, uint32_t * version = nullptr )
+{
+  if ( size < (qint64)sizeof( PackHeader ) )
+    return false;
+
+  PackHeader header;
+  memcpy( &header, data, sizeof( header ) );
+
+  if ( header.signature != Signature )
+    return false;
+
+  quint64 entriesOffset;
+  uint32_t entryCount;
+
+  if ( header.formatVersion == 1 ) {
+    memcpy( &entryCount, data + 2 * sizeof( uint32_t ), sizeof( entryCount ) );
+    entriesOffset = sizeof( PackHeader );
+  }
+  else if ( header.formatVersion == CurrentFormatVersion ) {
+    if ( header.directoryOffset > (quint64)size - sizeof( DirectoryHeader ) )
+      return false;
+
+    DirectoryHeader directory;
+    memcpy( &directory, data + header.directoryOffset, sizeof( directory ) );
+
+    entryCount    = directory.entryCount;
+    entriesOffset = header.directoryOffset + sizeof( DirectoryHeader );
+  }
+  else
+    return false;
+
+  if ( entriesOffset + (quint64)entryCount * sizeof( PackEntry ) > (quint64)size )
+    return false;
+
+  for ( uint32_t x = 0; x < entryCount; ++x ) {
+    PackEntry entry;
+    memcpy( &entry, data + entriesOffset + x * sizeof( PackEntry ), sizeof( entry ) );
+
+    if ( entry.offset > (quint64)size || entry.size > (quint64)size - entry.offset )
+      return false;
+
+    PackedSegment & segment = out[ std::string( entry.id, IdSize ) ];
+    segment.data            = data + entry.offset;
+    segment.size            = entry.size;
+    segment.lastModified    = entry.lastModified;
+    segment.offset          = entry.offset;
+  }
+
+  if ( version )
+    *version = header.formatVersion;
+
+  return true;
+}
+
+/// Pads the output up to the next segment boundary.
+bool align( QIODevice & out, qint64 & pos )
+{
+  qint64 padding = ( SegmentAlignment - pos % SegmentAlignment ) % SegmentAlignment;
+  if ( !padding )
+    return true;
+
+  pos += padding;
+  return out.write( QByteArray( padding, 0 ) ) == padding;
+}
+
+/// Writes the segments, then the standalone files, at pos, adding their
+/// entries. Returns false on failure or if stop() was called.
+bool writeSegments( QIODevice & out,
+                    qint64 & pos,
+                    SegmentMap const & kept,
+                    QFileInfoList const & standalone,
+                    std::vector< PackEntry > & entries )
+{
+  for ( auto const & [ id, segment ] : kept ) {
+    if ( stopping || !align( out, pos ) )
+      return false;
+
+    PackEntry entry;
+    memcpy( entry.id, id.data(), IdSize );
+    entry.offset       = pos;
+    entry.size         = segment.size;
+    entry.lastModified = segment.lastModified;
+    entries.push_back( entry );
+
+    if ( out.write( reinterpret_cast< char const * >( segment.data ), segment.size ) != segment.size )
+      return false;
+    pos += segment.size;
+  }
+
+  for ( auto const & file : standalone ) {
+    QFile in( file.absoluteFilePath() );
+    if ( stopping || !in.open( QFile::ReadOnly ) || !align( out, pos ) )
+      return false;
+
+    PackEntry entry;
+    memcpy( entry.id, file.fileName().toLatin1().constData(), IdSize );
+    entry.offset       = pos;
+    entry.size         = in.size();
+    entry.lastModified = file.lastModified().toSecsSinceEpoch();
+    entries.push_back( entry );
+
+    for ( qint64 left = entry.size; left > 0; ) {
+      QByteArray block = in.read( qMin( left, (qint64)1024 * 1024 ) );
+      if ( block.isEmpty() || out.write( block ) != block.size() )
+        return false;
+      pos += block.size();
+      left -= block.size();
+    }
+  }
+
+  return true;
+}
+
+/// Maps the pack found in the given directory, if any, into 'out'.
+bool mapPack( QFile & file, QString const & dir, SegmentMap & out, uint32_t * version = nullptr )
+{
+  file.setFileName( packFileName( dir ) );
+
+  if ( !file.open( QFile::ReadOnly ) )
+    return false;
+
+  uchar * data = file.size() ? file.map( 0, file.size() ) : nullptr;
+
+  if ( !data || !readDirectory( data, file.size(), out, version ) ) {
+    qWarning() << "The index pack" << file.fileName() << "is unusable, ignoring it";
+    out.clear();
+    file.close(); // So it can be replaced
+    return false;
+  }
+
+  return true;
+}
+
+/// Writes the directory of the entries at pos. Returns its offset, or -1.
+qint64 writeDirectory( QIODevice & out, qint64 & pos, std::vector< PackEntry > const & entries )
+{
+  qint64 const offset = pos;
+
+  DirectoryHeader directory{ (uint32_t)entries.size(), 0 };
+  qint64 const size = entries.size() * sizeof( PackEntry );
+
+  if ( out.write( reinterpret_cast< char const * >( &directory ), sizeof( directory ) ) != sizeof( directory )
+       || out.write( reinterpret_cast< char const * >( entries.data() ), size ) != size )
+    return -1;
+
+  pos += sizeof( directory ) + size;
+
+  return offset;
+}
+
+/// Writes a whole new pack of the segments kept and the standalone files.
+bool writePack( QString const & fileName, SegmentMap const & kept, QFileInfoList const & standalone )
+{
+  QSaveFile out( fileName );
+
+  if ( !out.open( QFile::WriteOnly ) ) {
+    qWarning() << "Can't write the index pack:" << out.errorString();
+    return false;
+  }
+
+  // The header is filled in once the directory's offset is known
+  qint64 pos = sizeof( PackHeader );
+  out.write( QByteArray( pos, 0 ) );
+
+  std::vector< PackEntry > entries;
+
+  qint64 const directoryOffset =
+    writeSegments( out, pos, kept, standalone, entries ) ? writeDirectory( out, pos, entries ) : -1;
+
+  if ( directoryOffset < 0 ) {
+    out.cancelWriting();
+    return false;
+  }
+
+  PackHeader header{ Signature, CurrentFormatVersion, (quint64)directoryOffset };
+
+  out.seek( 0 );
+  out.write( reinterpret_cast< char const * >( &header ), sizeof( header ) );
+
+  if ( !out.commit() ) {
+    qWarning() << "Can't write the index pack:" << out.errorString();
+    return false;
+  }
+
+  return true;
+}
+
+/// Points the header of the pack being written in place to the new directory.
+bool switchDirectory( QFile & out, qint64 directoryOffset )
+{
+  quint64 const offset = directoryOffset;
+
+  return out.flush() && out.seek( offsetof( PackHeader, directoryOffset ) )
+    && out.write( reinterpret_cast< char const * >( &offset ), sizeof( offset ) ) == sizeof( offset ) && out.flush();
+}
+
+/// The entries of the segments, as they are in the pack.
+std::vector< PackEntry > entriesOf( SegmentMap const & map )
+{
+  std::vector< PackEntry > result;
+  result.reserve( map.size() );
+
+  for ( auto const & [ id, segment ] : map ) {
+    PackEntry entry;
+    memcpy( entry.id, id.data(), IdSize );
+    entry.offset       = segment.offset;
+    entry.size         = segment.size;
+    entry.lastModified = segment.lastModified;
+    result.push_back( entry );
+  }
+
+  return result;
+}
+
+/// Appends the standalone files to the pack in place, along with a new
+/// directory, and maps the new segments. The files mapped are removed.
+/// Must be called with the write mutex held.
+void appendStandaloneFiles( QString const & indexDir, SegmentMap kept, QFileInfoList const & standalone )
+{
+  QFile out( packFileName( indexDir ) );
+  if ( !out.open( QFile::ReadWrite ) ) {
+    qWarning() << "Can't write the index pack:" << out.errorString();
+    return;
+  }
+
+  qint64 const end = out.size();
+  qint64 pos       = end;
+  out.seek( pos );
+
+  std::vector< PackEntry > entries = entriesOf( kept );
+  size_t const firstNew            = entries.size();
+
+  qint64 const directoryOffset =
+    writeSegments( out, pos, {}, standalone, entries ) ? writeDirectory( out, pos, entries ) : -1;
+
+  if ( directoryOffset < 0 || !switchDirectory( out, directoryOffset ) ) {
+    // The old directory is still the one in use, the rest is just ignored
+    out.resize( end );
+    return;
+  }
+
+  out.close();
+
+  QStringList mapped;
+
+  {
+    QMutexLocker _( &packMutex );
+
+    for ( size_t x = firstNew; x < entries.size(); ++x ) {
+      PackEntry const & entry = entries[ x ];
+
+      uchar * data = packFile.map( entry.offset, entry.size );
+      if ( !data )
+        continue;
+
+      PackedSegment & segment = segments[ std::string( entry.id, IdSize ) ];
+      segment.data            = data;
+      segment.size            = entry.size;
+      segment.lastModified    = entry.lastModified;
+      segment.offset          = entry.offset;
+
+      mapped.append( QString::fromLatin1( entry.id, IdSize ) );
+    }
+  }
+
+  // A file can't be removed while open on some systems. It stays then, taking
+  // precedence over its segment, and is removed on one of the next starts.
+  for ( auto const & id : mapped )
+    QFile::remove( indexDir + id );
+
+  qDebug() << "Appended" << mapped.size() << "index files to the pack," << entries.size() << "segments total";
+}
+
+/// Moves the standalone index files into the pack, compacting it first if
+/// too much of it is unused. Runs in the packer thread.
+void packStandaloneFiles( QString const & indexDir, QDateTime const & startedAt )
+{
+  QMutexLocker _( &writeMutex );
+
+  SegmentMap current;
+  uint32_t version;
+
+  {
+    QMutexLocker _( &packMutex );
+    current = segments;
+    version = packVersion;
+  }
+
+  // The files already in the pack only couldn't be removed last time. The
+  // ones written since the start are left alone, as they might be still
+  // being written by the indexing.
+  QFileInfoList standalone;
+
+  for ( auto const & entry : QDir( indexDir ).entryInfoList( QDir::Files | QDir::NoDotAndDotDot ) ) {
+    if ( !isIndexId( entry.fileName() ) || entry.lastModified() >= startedAt )
+      continue;
+
+    auto i = current.find( entry.fileName().toStdString() );
+
+    if ( i != current.end() && i->second.size == entry.size()
+         && i->second.lastModified == entry.lastModified().toSecsSinceEpoch() )
+      QFile::remove( entry.absoluteFilePath() );
+    else
+      standalone.append( entry );
+  }
+
+  for ( auto const & entry : standalone )
+    current.erase( entry.fileName().toStdString() );
+
+  if ( !version ) {
+    // No pack yet, nothing of it is mapped, so it's just written
+    if ( standalone.isEmpty() || !writePack( packFileName( indexDir ), {}, standalone ) )
+      return;
+
+    bool mapped;
+    {
+      QMutexLocker _( &packMutex );
+      mapped = mapPack( packFile, indexDir, segments, &packVersion );
+    }
+
+    if ( mapped )
+      for ( auto const & file : standalone )
+        QFile::remove( file.absoluteFilePath() );
+
+    qDebug() << "Packed" << standalone.size() << "index files";
+    return;
+  }
+
+  qint64 liveBytes = 0;
+  for ( auto const & [ id, segment ] : current )
+    liveBytes += segment.size;
+
+  qint64 const packSize  = QFileInfo( packFileName( indexDir ) ).size();
+  qint64 const deadBytes = packSize - liveBytes;
+
+  if ( version != CurrentFormatVersion || ( deadBytes >= minDeadBytes && deadBytes * 3 >= packSize ) ) {
+    // The pack is mapped, so it can't be replaced now. The standalone files
+    // stay until the compacted one has replaced it.
+    if ( writePack( compactedPackFileName( indexDir ), current, standalone ) )
+      qDebug() << "Compacted the index pack," << deadBytes << "bytes dropped";
+    return;
+  }
+
+  if ( !standalone.isEmpty() )
+    appendStandaloneFiles( indexDir, current, standalone );
+}
+
+/// Finds the segment for the given id in the shared directory, either in its
+/// pack or as a standalone file. Must be called with the mutex held.
+bool findShared( std::string_view id, Segment & segment )
+{
+  if ( sharedDir.empty() )
+    return false;
+
+  if ( auto i = sharedSegments.find( id ); i != sharedSegments.end() ) {
+    segment = i->second;
+    return true;
+  }
+
+  auto i = sharedFiles.find( id );
+
+  if ( i == sharedFiles.end() ) {
+    Segment found;
+
+    auto file = std::make_unique< QFile >( QString::fromStdString( sharedDir + std::string( id ) ) );
+    if ( file->open( QFile::ReadOnly ) && file->size() > 0 ) {
+      found.data         = file->map( 0, file->size() );
+      found.size         = file->size();
+      found.lastModified = QFileInfo( *file ).lastModified().toSecsSinceEpoch();
+    }
+
+    // The file has to stay open for the mapping to stay valid
+    if ( found.data )
+      sharedMappedFiles.push_back( std::move( file ) );
+
+    i = sharedFiles.emplace( std::string( id ), found ).first;
+  }
+
+  if ( !i->second.data )
+    return false;
+
+  segment = i->second;
+
+  return true;
+}
+
+} // namespace
+
+void init( QString const & indexDir, bool packStandalone, QString const & sharedIndexDir )
+{
+  QMutexLocker _( &packMutex );
+
+  if ( initialized )
+    return;
+
+  initialized = true;
+
+  // A pack compacted last time replaces the old one while nothing is mapped
+  if ( QFile::exists( compactedPackFileName( indexDir ) ) ) {
+    QFile::remove( packFileName( indexDir ) );
+    if ( !QFile::rename( compactedPackFileName( indexDir ), packFileName( indexDir ) ) )
+      qWarning() << "Can't replace the index pack with the compacted one";
+  }
+
+  packDir = indexDir.toStdString();
+
+  mapPack( packFile, indexDir, segments, &packVersion );
+
+  if ( !sharedIndexDir.isEmpty() && QFileInfo( sharedIndexDir ).isDir()
+       && QFileInfo( sharedIndexDir ).canonicalFilePath() != QFileInfo( indexDir ).canonicalFilePath() ) {
+    sharedDir = QDir( sharedIndexDir ).absolutePath().toStdString() + '/';
+
+    mapPack( sharedPackFile, QString::fromStdString( sharedDir ), sharedSegments );
+
+    qDebug() << "Using the shared index directory" << sharedIndexDir;
+  }
+
+  // The standalone files are used as they are in the meantime
+  if ( packStandalone ) {
+    packer = QThread::create( [ indexDir, startedAt = QDateTime::currentDateTime() ] {
+      packStandaloneFiles( indexDir, startedAt );
+    } );
+    packer->start( QThread::LowPriority );
+  }
+}
+
+void stop()
+{
+  if ( !packer )
+    return;
+
+  stopping = true;
+  packer->wait();
+
+  delete packer;
+  packer = nullptr;
+}
+
+void dropSegments( std::function< bool( std::string const & id ) > const & isUsed )
+{
+  // Not worth waiting for the packer, it's done on some other exit then
+  std::unique_lock< QMutex > lock( writeMutex, std::try_to_lock );
+  if ( !lock.owns_lock() )
+    return;
+
+  SegmentMap kept;
+  size_t dropped = 0;
+
+  {
+    QMutexLocker _( &packMutex );
+
+    // The older packs are compacted before anything is written into them
+    if ( packVersion != CurrentFormatVersion )
+      return;
+
+    for ( auto i = segments.begin(); i != segments.end(); ) {
+      if ( isUsed( i->first ) ) {
+        kept.insert( *i );
+        ++i;
+      }
+      else {
+        i = segments.erase( i ); // Stays mapped, but nothing opens it anymore
+        ++dropped;
+      }
+    }
+  }
+
+  if ( !dropped )
+    return;
+
+  QFile out( packFileName( QString::fromStdString( packDir ) ) );
+  if ( !out.open( QFile::ReadWrite ) )
+    return;
+
+  qint64 const end = out.size();
+  qint64 pos       = end;
+  out.seek( pos );
+
+  qint64 const directoryOffset = writeDirectory( out, pos, entriesOf( kept ) );
+
+  if ( directoryOffset < 0 || !switchDirectory( out, directoryOffset ) ) {
+    out.resize( end );
+    return;
+  }
+
+  qDebug() << "Dropped" << dropped << "unused segments from the index pack";
+}
+
+bool findSegment( std::string_view indexFile, Segment & segment )
+{
+  QMutexLocker _( &packMutex );
+
+  if ( packDir.empty() || indexFile.size() != packDir.size() + IdSize
+       || indexFile.compare( 0, packDir.size(), packDir ) != 0 )
+    return false;
+
+  std::string_view const id = indexFile.substr( packDir.size() );
+
+  auto i = segments.find( id );
+
+  Segment shared;
+  if ( findShared( id, shared ) && ( i == segments.end() || shared.lastModified > i->second.lastModified ) ) {
+    segment = shared;
+    return true;
+  }
+
+  if ( i == segments.end() )
+    return false;
+
+  segment = i->second;
+
+  return true;
+}
+
+} // namespace IndexPack
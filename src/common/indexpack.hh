@@ -0,0 +1,60 @@
+/* This file is part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
+
+#ifndef GOLDENDICT_INDEXPACK_HH
+#define GOLDENDICT_INDEXPACK_HH
+
+#include <QString>
+#include <QtGlobal>
+#include <functional>
+#include <string>
+#include <string_view>
+
+/// An optional packed store for the dictionaries' index files. Instead of
+/// one file per dictionary, the indexes are kept as segments of a single
+/// file in the index directory, which is mapped once. File::Index serves
+/// the segments straight from that mapping, so opening an index costs
+/// neither a file descriptor nor a buffer.
+///
+/// Freshly built indexes are still written as standalone files, and take
+/// precedence over their older segments. On the next start, a background
+/// thread appends them to the pack in place. Once too much of the pack is
+/// taken by the segments superseded or dropped, it is compacted into a new
+/// file instead, which replaces it on the start after that.
+namespace IndexPack {
+
+struct Segment
+{
+  uchar const * data = nullptr;
+  qint64 size        = 0;
+
+  /// Modification time of the original index file, in seconds since epoch
+  qint64 lastModified = 0;
+};
+
+/// Maps the pack found in the given index directory. If packStandalone is
+/// true, any standalone index files found there are then moved into the pack
+/// in the background. Only the first call does anything: the mapping must
+/// stay valid for the lifetime of the process, since open indexes point into
+/// it.
+///
+/// The sharedIndexDir, if given, is a read-only directory of indexes shared
+/// by several users, e.g. on a terminal server: a copy of someone's index
+/// directory, standalone files and/or a pack. Its indexes are used when the
+/// user has no index of their own, or an older one, and are mapped read-only
+/// so all the processes share the same pages of memory.
+void init( QString const & indexDir, bool packStandalone, QString const & sharedIndexDir = QString() );
+
+/// Looks up the segment for the given index file name, in the pack or in the
+/// shared directory. Returns false if neither holds that index.
+bool findSegment( std::string_view indexFile, Segment & );
+
+/// Drops the segments of the indexes not used anymore from the pack's
+/// directory. Does nothing if the pack is being written in the background.
+void dropSegments( std::function< bool( std::string const & id ) > const & isUsed );
+
+/// Stops the packing going on in the background, if any, and waits for it.
+void stop();
+
+} // namespace IndexPack
+
+#endif
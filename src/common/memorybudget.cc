@@ -0,0 +1,322 @@
+/* This file is part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
+
+#include "memorybudget.hh"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QMutex>
+#include <QSet>
+#include <QTimer>
+#include <map>
+
+namespace MemoryBudget {
+
+namespace {
+
+struct Cache
+{
+  QString name;
+  int weight;
+  EvictFunction evict;
+  qint64 bytes        = 0;
+  qint64 evictedBytes = 0;
+};
+
+QMutex budgetMutex;
+std::map< int, Cache > caches;
+int nextId              = 1;
+qint64 totalBytes       = 0;
+qint64 configuredBudget = 0;
+qint64 effectiveBudget  = 0;
+bool trimScheduled      = false;
+
+qint64 const MiB = 1024 * 1024;
+
+// How often the memory pressure is checked
+int const monitorInterval = 5000; // ms
+
+// The most checks skipped after a trim while the pressure lasts
+int const maxPressureBackOff = 12;
+
+/// Reads a single number from a file like the ones in /proc and /sys.
+/// Returns -1 if there's no number there, e.g. "max".
+qint64 readNumber( QString const & fileName )
+{
+  QFile file( fileName );
+  if ( !file.open( QFile::ReadOnly ) )
+    return -1;
+
+  bool ok;
+  qint64 value = file.readLine().trimmed().toLongLong( &ok );
+
+  return ok ? value : -1;
+}
+
+/// Returns the value of the given field of /proc/meminfo, in bytes, or -1.
+qint64 memInfo( QByteArray const & field )
+{
+  QFile file( "/proc/meminfo" );
+  if ( !file.open( QFile::ReadOnly ) )
+    return -1;
+
+  for ( QByteArray line; !( line = file.readLine() ).isEmpty(); ) {
+    if ( line.startsWith( field + ':' ) ) {
+      QByteArray value = line.mid( field.size() + 1 ).trimmed();
+      value.chop( 2 ); // "kB"
+      return value.trimmed().toLongLong() * 1024;
+    }
+  }
+
+  return -1;
+}
+
+/// The memory limit of our cgroup, or -1 if there's none.
+qint64 cgroupLimit()
+{
+  qint64 limit = readNumber( "/sys/fs/cgroup/memory.max" );
+
+  if ( limit < 0 )
+    limit = readNumber( "/sys/fs/cgroup/memory/memory.limit_in_bytes" );
+
+  // cgroup v1 reports no limit as a huge number
+  return limit > 0 && limit < ( qint64( 1 ) << 50 ) ? limit : -1;
+}
+
+qint64 automaticBudget()
+{
+  if ( qint64 limit = cgroupLimit(); limit > 0 )
+    return qBound( 32 * MiB, limit / 8, 1024 * MiB );
+
+  if ( qint64 physical = memInfo( "MemTotal" ); physical > 0 )
+    return qBound( 32 * MiB, physical / 16, 1024 * MiB );
+
+  return 256 * MiB;
+}
+
+/// Tells whether the system or our cgroup is about to run out of memory.
+bool underPressure()
+{
+  if ( qint64 limit = cgroupLimit(); limit > 0 ) {
+    qint64 current = readNumber( "/sys/fs/cgroup/memory.current" );
+    if ( current < 0 )
+      current = readNumber( "/sys/fs/cgroup/memory/memory.usage_in_bytes" );
+
+    if ( current > limit / 10 * 9 )
+      return true;
+  }
+
+  qint64 const available = memInfo( "MemAvailable" );
+  qint64 const physical  = memInfo( "MemTotal" );
+
+  return available >= 0 && physical > 0 && available < physical / 20;
+}
+
+/// Must be called with the mutex held.
+void scheduleTrim()
+{
+  if ( trimScheduled || totalBytes <= effectiveBudget || !QCoreApplication::instance() )
+    return;
+
+  trimScheduled = true;
+
+  QMetaObject::invokeMethod(
+    QCoreApplication::instance(),
+    [] {
+      qint64 target;
+      {
+        QMutexLocker _( &budgetMutex );
+        trimScheduled = false;
+        target        = effectiveBudget;
+      }
+      trim( target );
+    },
+    Qt::QueuedConnection );
+}
+
+} // namespace
+
+int registerCache( QString const & name, int weight, EvictFunction evict )
+{
+  QMutexLocker _( &budgetMutex );
+
+  if ( !effectiveBudget )
+    effectiveBudget = automaticBudget();
+
+  int const id = nextId++;
+
+  Cache & cache = caches[ id ];
+  cache.name    = name;
+  cache.weight  = qMax( 1, weight );
+  cache.evict   = std::move( evict );
+
+  return id;
+}
+
+void unregisterCache( int id )
+{
+  QMutexLocker _( &budgetMutex );
+
+  auto i = caches.find( id );
+  if ( i == caches.end() )
+    return;
+
+  totalBytes -= i->second.bytes;
+  caches.erase( i );
+}
+
+void setUsage( int id, qint64 bytes )
+{
+  QMutexLocker _( &budgetMutex );
+
+  auto i = caches.find( id );
+  if ( i == caches.end() )
+    return;
+
+  totalBytes += bytes - i->second.bytes;
+  i->second.bytes = bytes;
+
+  scheduleTrim();
+}
+
+void setBudget( qint64 bytes )
+{
+  QMutexLocker _( &budgetMutex );
+
+  configuredBudget = bytes;
+  effectiveBudget  = bytes > 0 ? bytes : automaticBudget();
+
+  scheduleTrim();
+}
+
+qint64 budget()
+{
+  QMutexLocker _( &budgetMutex );
+
+  if ( !effectiveBudget )
+    effectiveBudget = configuredBudget > 0 ? configuredBudget : automaticBudget();
+
+  return effectiveBudget;
+}
+
+void trim( qint64 targetBytes )
+{
+  QSet< int > exhausted; // The caches which couldn't free anything
+
+  for ( ;; ) {
+    int id = 0;
+    qint64 toFree;
+    EvictFunction evict;
+
+    {
+      QMutexLocker _( &budgetMutex );
+
+      if ( totalBytes <= targetBytes )
+        return;
+
+      int totalWeight = 0;
+      for ( auto const & [ cacheId, cache ] : caches )
+        totalWeight += cache.weight;
+
+      // The cache most over its share goes first
+      qint64 maxExcess = 0;
+      for ( auto const & [ cacheId, cache ] : caches ) {
+        if ( !cache.bytes || exhausted.contains( cacheId ) )
+          continue;
+
+        qint64 const excess = cache.bytes - targetBytes * cache.weight / totalWeight;
+        if ( !id || excess > maxExcess ) {
+          id        = cacheId;
+          maxExcess = excess;
+        }
+      }
+
+      if ( !id )
+        return; // Nothing left to evict
+
+      Cache const & cache = caches[ id ];
+
+      toFree = qMin( totalBytes - targetBytes, maxExcess > 0 ? maxExcess : cache.bytes );
+      evict  = cache.evict;
+    }
+
+    qint64 const freed = evict ? evict( toFree ) : 0;
+
+    QMutexLocker _( &budgetMutex );
+
+    if ( freed <= 0 )
+      exhausted.insert( id );
+    else if ( auto i = caches.find( id ); i != caches.end() )
+      i->second.evictedBytes += freed;
+  }
+}
+
+void startMonitoring()
+{
+  static QTimer * timer = nullptr;
+
+  if ( timer )
+    return;
+
+  timer = new QTimer( QCoreApplication::instance() );
+
+  // While the pressure lasts, the trims get further and further apart. The
+  // caches which refill right away, like the icon atlas, would otherwise be
+  // dropped and read back every few seconds, freeing nothing for long.
+  QObject::connect( timer, &QTimer::timeout, [] {
+    static int backOff = 0; // The checks to skip after the next trim
+    static int skipped = 0; // The ones still to skip
+
+    if ( !underPressure() ) {
+      backOff = 0;
+      skipped = 0;
+      return;
+    }
+
+    if ( skipped > 0 ) {
+      --skipped;
+      return;
+    }
+
+    qint64 const target = budget() / 2;
+    {
+      QMutexLocker _( &budgetMutex );
+      if ( totalBytes <= target )
+        return;
+    }
+
+    trim( target );
+
+    backOff = qBound( 1, backOff * 2, maxPressureBackOff );
+    skipped = backOff;
+  } );
+
+  timer->start( monitorInterval );
+}
+
+QList< CacheUsage > usage()
+{
+  QMutexLocker _( &budgetMutex );
+
+  QList< CacheUsage > result;
+
+  for ( auto const & [ id, cache ] : caches )
+    result.append( { cache.name, cache.weight, cache.bytes, cache.evictedBytes } );
+
+  return result;
+}
+
+QString report()
+{
+  QString result = QString( "Cache memory budget: %1 KiB\n" ).arg( budget() / 1024 );
+
+  for ( auto const & cache : usage() )
+    result += QString( "%1: %2 KiB, weight %3, %4 KiB evicted\n" )
+                .arg( cache.name )
+                .arg( cache.bytes / 1024 )
+                .arg( cache.weight )
+                .arg( cache.evictedBytes / 1024 );
+
+  return result;
+}
+
+} // namespace MemoryBudget
@@ -0,0 +1,61 @@
+/* This file is part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
+
+#ifndef __MEMORYBUDGET_HH_INCLUDED__
+#define __MEMORYBUDGET_HH_INCLUDED__
+
+#include <QList>
+#include <QString>
+#include <functional>
+
+/// Keeps all the in-memory caches within a single total budget. Each cache
+/// registers with a weight and a function which evicts from it, and reports
+/// its size whenever it changes. When the total exceeds the budget, or the
+/// system runs low on memory, the caches holding more than their weighted
+/// share of the budget are asked to shrink, the largest excess first.
+///
+/// Eviction happens later in the main thread, never inside setUsage(), so a
+/// cache may report its size while holding its own locks. The evict function
+/// is called without any lock of the budget held, and may call setUsage().
+namespace MemoryBudget {
+
+/// Asked to free at least the given number of bytes, returns how much it freed.
+using EvictFunction = std::function< qint64( qint64 bytesToFree ) >;
+
+/// Registers a cache, returning its id for the other calls. Can be called
+/// from any thread.
+int registerCache( QString const & name, int weight, EvictFunction evict );
+
+void unregisterCache( int id );
+
+/// Reports the current size of the cache. Can be called from any thread.
+void setUsage( int id, qint64 bytes );
+
+/// Sets the total budget. 0 derives it from the cgroup memory limit, if any,
+/// or else from the physical memory.
+void setBudget( qint64 bytes );
+
+qint64 budget();
+
+/// Shrinks the caches until they take no more than the given number of bytes.
+void trim( qint64 targetBytes );
+
+/// Starts watching the system's memory pressure. Must be called from the
+/// main thread.
+void startMonitoring();
+
+struct CacheUsage
+{
+  QString name;
+  int weight;
+  qint64 bytes;
+  qint64 evictedBytes; // Total so far
+};
+
+QList< CacheUsage > usage();
+
+/// The usage of all the caches as human-readable text, for diagnostics.
+QString report();
+
+} // namespace MemoryBudget
+
+#endif
@@ -0,0 +1,92 @@
+/* This file is part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
+
+#include "storagedevice.hh"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QStorageInfo>
+
+namespace StorageDevice {
+
+namespace {
+
+// The limits for the devices which don't like parallel reads
+int const rotationalConcurrency = 2;
+int const networkConcurrency    = 4;
+
+bool isNetworkFileSystem( QByteArray const & type )
+{
+  static QList< QByteArray > const networkTypes = { "nfs", "nfs4", "cifs", "smb", "smbfs", "smb3", "afs", "9p",
+                                                     "fuse.sshfs", "sshfs", "davfs", "fuse.davfs2" };
+
+  return networkTypes.contains( type.toLower() );
+}
+
+/// Whether the block device is a spinning disk. Only known on Linux, where
+/// the kernel tells it in sysfs; assumed not to be elsewhere.
+bool isRotational( QByteArray const & device )
+{
+#ifdef Q_OS_LINUX
+  // Resolves the /dev/mapper and /dev/disk/by-* links to the actual node
+  QString node = QFileInfo( QString::fromLocal8Bit( device ) ).canonicalFilePath();
+  if ( node.isEmpty() )
+    return false;
+
+  QString const sysPath = QFileInfo( "/sys/class/block/" + QFileInfo( node ).fileName() ).canonicalFilePath();
+  if ( sysPath.isEmpty() )
+    return false;
+
+  // A partition has no queue of its own, it's the disk's one
+  for ( auto const & path : { sysPath + "/queue/rotational", sysPath + "/../queue/rotational" } ) {
+    QFile file( path );
+    if ( file.open( QFile::ReadOnly ) )
+      return file.read( 1 ) == "1";
+  }
+#else
+  Q_UNUSED( device )
+#endif
+
+  return false;
+}
+
+QMutex cacheMutex;
+QHash< QString, Device > cache; // By the filesystem's root path
+
+} // namespace
+
+Device find( QString const & fileName )
+{
+  QStorageInfo const storage( fileName );
+
+  if ( !storage.isValid() )
+    return {};
+
+  QString const root = storage.rootPath();
+
+  {
+    QMutexLocker _( &cacheMutex );
+    auto i = cache.constFind( root );
+    if ( i != cache.constEnd() )
+      return *i;
+  }
+
+  Device device;
+  device.id = storage.device();
+
+  if ( device.id.isEmpty() )
+    device.id = root.toUtf8();
+
+  if ( isNetworkFileSystem( storage.fileSystemType() ) )
+    device.concurrency = networkConcurrency;
+  else if ( isRotational( storage.device() ) )
+    device.concurrency = rotationalConcurrency;
+
+  QMutexLocker _( &cacheMutex );
+  cache.insert( root, device );
+
+  return device;
+}
+
+} // namespace StorageDevice
@@ -0,0 +1,31 @@
+/* This file is part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
+
+#ifndef __STORAGEDEVICE_HH_INCLUDED__
+#define __STORAGEDEVICE_HH_INCLUDED__
+
+#include <QByteArray>
+#include <QString>
+
+/// Tells which device the files are on, and how well the device copes with
+/// many reads at once, so the work reading from it could be scheduled
+/// accordingly.
+namespace StorageDevice {
+
+struct Device
+{
+  /// Tells the devices apart. Empty when not known.
+  QByteArray id;
+
+  /// How many reads are worth issuing to the device at once, 0 meaning no
+  /// limit. Spinning disks and network shares only get slower when many
+  /// reads compete for them.
+  int concurrency = 0;
+};
+
+/// Finds the device the given file is on. The results are cached per
+/// filesystem. Can be called from any thread.
+Device find( QString const & fileName );
+
+} // namespace StorageDevice
+
+#endif
@@ -4,7 +4,11 @@
 #include "config.hh"
 #include "folding.hh"
 #include <QSaveFile>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QFileInfo>
 #include <QtXml>
 #include <QApplication>
 #include <QStyle>
@@ -523,67 +527,12 @@ bool fromConfig2Preference( const QDomNode & node, const QString & expectedValue
   return defaultValue;
 }
 
-Class load()
-{
-  QString configName = getConfigFileName();
-
-  bool loadFromTemplate = false;
-
-  if ( !QFile::exists( configName ) ) {
-    // Make the default config, save it and return it
-    Class c;
-
-#ifdef Q_OS_LINUX
-    if ( QDir( "/usr/share/stardict/dic" ).exists() )
-      c.paths.push_back( Path( "/usr/share/stardict/dic", true ) );
-
-    if ( QDir( "/usr/share/dictd" ).exists() )
-      c.paths.push_back( Path( "/usr/share/dictd", true ) );
-
-    if ( QDir( "/usr/share/opendict/dictionaries" ).exists() )
-      c.paths.push_back( Path( "/usr/share/opendict/dictionaries", true ) );
-
-    if ( QDir( "/usr/share/goldendict-wordnet" ).exists() )
-      c.paths.push_back( Path( "/usr/share/goldendict-wordnet", true ) );
-
-    if ( QDir( "/usr/share/WyabdcRealPeopleTTS" ).exists() )
-      c.soundDirs.push_back( SoundDir( "/usr/share/WyabdcRealPeopleTTS", "WyabdcRealPeopleTTS" ) );
-
-    if ( QDir( "/usr/share/myspell/dicts" ).exists() )
-      c.hunspell.dictionariesPath = "/usr/share/myspell/dicts";
-
-#endif
-
-
-#ifndef Q_OS_WIN32
-    c.preferences.audioPlaybackProgram = "mplayer";
-#endif
-
-    QString possibleMorphologyPath = getProgramDataDir() + "/content/morphology";
-
-    if ( QDir( possibleMorphologyPath ).exists() )
-      c.hunspell.dictionariesPath = possibleMorphologyPath;
-
-    c.mediawikis  = makeDefaultMediaWikis( true );
-    c.webSites    = makeDefaultWebSites();
-    c.dictServers = makeDefaultDictServers();
-    c.programs    = makeDefaultPrograms();
-
-    // Check if we have a template config file. If we do, load it instead
-
-    configName       = getProgramDataDir() + "/content/defconfig";
-    loadFromTemplate = QFile( configName ).exists();
-
-    if ( !loadFromTemplate ) {
-      save( c );
-
-      return c;
-    }
-  }
-
-  getStylesDir();
+namespace {
 
-  QFile configFile( configName );
+/// Reads the XML config. The template one has %PROGRAMDIR% replaced.
+QDomDocument readXml( QString const & fileName, bool isTemplate )
+{
+  QFile configFile( fileName );
 
   if ( !configFile.open( QFile::ReadOnly ) )
     throw exCantReadConfigFile();
@@ -593,7 +542,7 @@ Class load()
   QString errorStr;
   int errorLine, errorColumn;
 
-  if ( !loadFromTemplate ) {
+  if ( !isTemplate ) {
     // Load the config as usual
     if ( !dd.setContent( &configFile, false, &errorStr, &errorLine, &errorColumn ) ) {
       GD_DPRINTF( "Error: %s at %d,%d\n", errorStr.toLocal8Bit().constData(), errorLine, errorColumn );
@@ -614,8 +563,11 @@ Class load()
     }
   }
 
-  configFile.close();
+  return dd;
+}
 
+Class fromXml( QDomDocument const & dd )
+{
   QDomNode root = dd.namedItem( "config" );
 
   Class c;
@@ -764,6 +716,7 @@ Class load()
       p.enabled      = ( pr.attribute( "enabled" ) == "1" );
       p.type         = ( Program::Type )( pr.attribute( "type" ).toInt() );
       p.iconFilename = pr.attribute( "icon" );
+      p.server       = ( pr.attribute( "server" ) == "1" );
 
       c.programs.push_back( p );
     }
@@ -1042,6 +995,18 @@ Class load()
       c.preferences.removeInvalidIndexOnExit =
         ( preferences.namedItem( "removeInvalidIndexOnExit" ).toElement().text() == "1" );
 
+    if ( !preferences.namedItem( "indexWarmUpBudget" ).isNull() )
+      c.preferences.indexWarmUpBudget = preferences.namedItem( "indexWarmUpBudget" ).toElement().text().toUInt();
+
+    if ( !preferences.namedItem( "packedIndexStore" ).isNull() )
+      c.preferences.packedIndexStore = ( preferences.namedItem( "packedIndexStore" ).toElement().text() == "1" );
+
+    if ( !preferences.namedItem( "sharedIndexDir" ).isNull() )
+      c.preferences.sharedIndexDir = preferences.namedItem( "sharedIndexDir" ).toElement().text();
+
+    if ( !preferences.namedItem( "cacheMemoryBudget" ).isNull() )
+      c.preferences.cacheMemoryBudget = preferences.namedItem( "cacheMemoryBudget" ).toElement().text().toUInt();
+
     if ( !preferences.namedItem( "maxStringsInHistory" ).isNull() )
       c.preferences.maxStringsInHistory = preferences.namedItem( "maxStringsInHistory" ).toElement().text().toUInt();
 
@@ -1221,6 +1186,261 @@ Class load()
   return c;
 }
 
+/// The config as kept in the store. The lists of the dictionaries, which
+/// take most of it, are in binary, and the rest is XML made by the same
+/// code as the XML config, just without those lists.
+struct Store
+{
+  /// The time of the XML config when the store was written, -1 if none.
+  qint64 xmlModified = -1;
+
+  QMap< QByteArray, QByteArray > sections;
+};
+
+quint32 const storeMagic   = 0x47444346; // GDCF
+quint32 const storeVersion = 1;
+
+/// Holds the hash of the other sections as of the last time the XML config
+/// was written, so it isn't written again while they stay the same.
+char const xmlExportSection[] = "xmlExport";
+
+/// What was last read from or written to the store, so that nothing is
+/// written when nothing has changed.
+Store & storedSections()
+{
+  static Store store;
+  return store;
+}
+
+/// The lists the stored sections were made from, so those of them which
+/// haven't changed aren't encoded again
+struct StoredLists
+{
+  Group dictionaryOrder;
+  Group inactiveDictionaries;
+  Groups groups;
+  MutedDictionaries mutedDictionaries;
+  MutedDictionaries popupMutedDictionaries;
+};
+
+std::optional< StoredLists > & storedLists()
+{
+  static std::optional< StoredLists > lists;
+  return lists;
+}
+
+void rememberLists( Class const & c )
+{
+  storedLists() =
+    StoredLists{ c.dictionaryOrder, c.inactiveDictionaries, c.groups, c.mutedDictionaries, c.popupMutedDictionaries };
+}
+
+Store readStore( QString const & fileName )
+{
+  QFile file( fileName );
+
+  if ( !file.open( QFile::ReadOnly ) )
+    throw exCantReadConfigFile();
+
+  QDataStream in( &file );
+  in.setVersion( QDataStream::Qt_5_15 );
+
+  quint32 magic, version;
+  in >> magic >> version;
+
+  if ( in.status() != QDataStream::Ok || magic != storeMagic || version != storeVersion )
+    throw exMalformedConfigFile();
+
+  Store store;
+  in >> store.xmlModified >> store.sections;
+
+  if ( in.status() != QDataStream::Ok )
+    throw exMalformedConfigFile();
+
+  storedSections() = store;
+
+  return store;
+}
+
+/// Runs the function reading the section, checking it's read in full.
+template< class Read >
+void decodeSection( Store const & store, char const * name, Read read )
+{
+  QDataStream in( store.sections.value( name ) );
+  in.setVersion( QDataStream::Qt_5_15 );
+
+  read( in );
+
+  if ( in.status() != QDataStream::Ok || !in.atEnd() )
+    throw exMalformedConfigFile();
+}
+
+MutedDictionaries readMutedDictionaries( QDataStream & in )
+{
+  QStringList list;
+  in >> list;
+
+  return MutedDictionaries( list.begin(), list.end() );
+}
+
+Group readGroup( QDataStream & in )
+{
+  Group g;
+  QString shortcut;
+  quint32 count;
+
+  in >> g.id >> g.name >> g.icon >> g.iconData >> shortcut >> g.favoritesFolder >> count;
+
+  if ( !shortcut.isEmpty() )
+    g.shortcut = QKeySequence::fromString( shortcut );
+
+  for ( quint32 x = 0; x < count && in.status() == QDataStream::Ok; ++x ) {
+    DictionaryRef ref;
+    in >> ref.id >> ref.name;
+    g.dictionaries.push_back( ref );
+  }
+
+  g.mutedDictionaries      = readMutedDictionaries( in );
+  g.popupMutedDictionaries = readMutedDictionaries( in );
+
+  return g;
+}
+
+Class fromStore( Store const & store )
+{
+  QDomDocument dd;
+
+  if ( !dd.setContent( store.sections.value( "xml" ) ) )
+    throw exMalformedConfigFile();
+
+  Class c = fromXml( dd );
+
+  decodeSection( store, "dictionaryOrder", [ &c ]( QDataStream & in ) {
+    c.dictionaryOrder = readGroup( in );
+  } );
+
+  decodeSection( store, "inactiveDictionaries", [ &c ]( QDataStream & in ) {
+    c.inactiveDictionaries = readGroup( in );
+  } );
+
+  decodeSection( store, "groups", [ &c ]( QDataStream & in ) {
+    quint32 count;
+    in >> c.groups.nextId >> count;
+
+    for ( quint32 x = 0; x < count && in.status() == QDataStream::Ok; ++x )
+      c.groups.push_back( readGroup( in ) );
+  } );
+
+  decodeSection( store, "mutedDictionaries", [ &c ]( QDataStream & in ) {
+    c.mutedDictionaries      = readMutedDictionaries( in );
+    c.popupMutedDictionaries = readMutedDictionaries( in );
+  } );
+
+  return c;
+}
+
+} // namespace
+
+Class load()
+{
+  QString configName      = getConfigFileName();
+  QString const storeName = getConfigStoreFileName();
+
+  bool loadFromTemplate = false;
+
+  if ( !QFile::exists( configName ) && !QFile::exists( storeName ) ) {
+    // Make the default config, save it and return it
+    Class c;
+
+#ifdef Q_OS_LINUX
+    if ( QDir( "/usr/share/stardict/dic" ).exists() )
+      c.paths.push_back( Path( "/usr/share/stardict/dic", true ) );
+
+    if ( QDir( "/usr/share/dictd" ).exists() )
+      c.paths.push_back( Path( "/usr/share/dictd", true ) );
+
+    if ( QDir( "/usr/share/opendict/dictionaries" ).exists() )
+      c.paths.push_back( Path( "/usr/share/opendict/dictionaries", true ) );
+
+    if ( QDir( "/usr/share/goldendict-wordnet" ).exists() )
+      c.paths.push_back( Path( "/usr/share/goldendict-wordnet", true ) );
+
+    if ( QDir( "/usr/share/WyabdcRealPeopleTTS" ).exists() )
+      c.soundDirs.push_back( SoundDir( "/usr/share/WyabdcRealPeopleTTS", "WyabdcRealPeopleTTS" ) );
+
+    if ( QDir( "/usr/share/myspell/dicts" ).exists() )
+      c.hunspell.dictionariesPath = "/usr/share/myspell/dicts";
+
+#endif
+
+
+#ifndef Q_OS_WIN32
+    c.preferences.audioPlaybackProgram = "mplayer";
+#endif
+
+    QString possibleMorphologyPath = getProgramDataDir() + "/content/morphology";
+
+    if ( QDir( possibleMorphologyPath ).exists() )
+      c.hunspell.dictionariesPath = possibleMorphologyPath;
+
+    c.mediawikis  = makeDefaultMediaWikis( true );
+    c.webSites    = makeDefaultWebSites();
+    c.dictServers = makeDefaultDictServers();
+    c.programs    = makeDefaultPrograms();
+
+    // Check if we have a template config file. If we do, load it instead
+
+    configName       = getProgramDataDir() + "/content/defconfig";
+    loadFromTemplate = QFile( configName ).exists();
+
+    if ( !loadFromTemplate ) {
+      save( c );
+
+      return c;
+    }
+  }
+
+  getStylesDir();
+
+  if ( loadFromTemplate )
+    return fromXml( readXml( configName, true ) );
+
+  QElapsedTimer timer;
+  timer.start();
+
+  // The store is used unless the XML has changed since it was written, which
+  // means either an older version or the user has edited it
+
+  if ( QFile::exists( storeName ) ) {
+    QFileInfo const xml( configName );
+
+    try {
+      Store store = readStore( storeName );
+
+      if ( !xml.exists() || xml.lastModified().toMSecsSinceEpoch() == store.xmlModified ) {
+        Class c = fromStore( store );
+        rememberLists( c );
+        GD_DPRINTF( "Config loaded from the store in %lld ms\n", timer.elapsed() );
+        return c;
+      }
+    }
+    catch ( exMalformedConfigFile & ) {
+      if ( !xml.exists() )
+        throw;
+
+      gdWarning( "The configuration store is malformed, importing the XML instead\n" );
+    }
+  }
+
+  Class c = fromXml( readXml( configName, false ) );
+  GD_DPRINTF( "Config imported from XML in %lld ms\n", timer.elapsed() );
+
+  // Have the store written now, so the next start takes it
+  save( c );
+
+  return c;
+}
+
 namespace {
 void saveGroup( Group const & data, QDomElement & group )
 {
@@ -1304,15 +1524,10 @@ void saveGroup( Group const & data, QDomElement & group )
   }
 }
 
-} // namespace
-
-void save( Class const & c )
+/// Makes the XML config. Without the lists, it's only what the store keeps
+/// as XML.
+QDomDocument toXml( Class const & c, bool withLists )
 {
-  QSaveFile configFile( getConfigFileName() );
-
-  if ( !configFile.open( QFile::WriteOnly ) )
-    throw exCantWriteConfigFile();
-
   QDomDocument dd;
 
   QDomElement root = dd.createElement( "config" );
@@ -1358,19 +1573,19 @@ void save( Class const & c )
     }
   }
 
-  {
+  if ( withLists ) {
     QDomElement dictionaryOrder = dd.createElement( "dictionaryOrder" );
     root.appendChild( dictionaryOrder );
     saveGroup( c.dictionaryOrder, dictionaryOrder );
   }
 
-  {
+  if ( withLists ) {
     QDomElement inactiveDictionaries = dd.createElement( "inactiveDictionaries" );
     root.appendChild( inactiveDictionaries );
     saveGroup( c.inactiveDictionaries, inactiveDictionaries );
   }
 
-  {
+  if ( withLists ) {
     QDomElement groups = dd.createElement( "groups" );
     root.appendChild( groups );
 
@@ -1666,6 +1881,10 @@ void save( Class const & c )
       QDomAttr icon = dd.createAttribute( "icon" );
       icon.setValue( program.iconFilename );
       p.setAttributeNode( icon );
+
+      QDomAttr server = dd.createAttribute( "server" );
+      server.setValue( program.server ? "1" : "0" );
+      p.setAttributeNode( server );
     }
   }
 #ifndef NO_TTS_SUPPORT
@@ -1712,13 +1931,13 @@ void save( Class const & c )
   }
 #endif
 
-  {
+  if ( withLists ) {
     QDomElement muted = dd.createElement( "mutedDictionaries" );
     root.appendChild( muted );
     saveMutedDictionaries( dd, muted, c.mutedDictionaries );
   }
 
-  {
+  if ( withLists ) {
     QDomElement muted = dd.createElement( "popupMutedDictionaries" );
     root.appendChild( muted );
     saveMutedDictionaries( dd, muted, c.popupMutedDictionaries );
@@ -2032,6 +2251,22 @@ void save( Class const & c )
     opt.appendChild( dd.createTextNode( c.preferences.removeInvalidIndexOnExit ? "1" : "0" ) );
     preferences.appendChild( opt );
 
+    opt = dd.createElement( "indexWarmUpBudget" );
+    opt.appendChild( dd.createTextNode( QString::number( c.preferences.indexWarmUpBudget ) ) );
+    preferences.appendChild( opt );
+
+    opt = dd.createElement( "packedIndexStore" );
+    opt.appendChild( dd.createTextNode( c.preferences.packedIndexStore ? "1" : "0" ) );
+    preferences.appendChild( opt );
+
+    opt = dd.createElement( "sharedIndexDir" );
+    opt.appendChild( dd.createTextNode( c.preferences.sharedIndexDir ) );
+    preferences.appendChild( opt );
+
+    opt = dd.createElement( "cacheMemoryBudget" );
+    opt.appendChild( dd.createTextNode( QString::number( c.preferences.cacheMemoryBudget ) ) );
+    preferences.appendChild( opt );
+
     opt = dd.createElement( "maxStringsInHistory" );
     opt.appendChild( dd.createTextNode( QString::number( c.preferences.maxStringsInHistory ) ) );
     preferences.appendChild( opt );
@@ -2231,9 +2466,169 @@ void save( Class const & c )
     hd.appendChild( opt );
   }
 
-  configFile.write( dd.toByteArray() );
-  if ( !configFile.commit() )
+  return dd;
+}
+
+/// The sets are written sorted, so the same ones always give the same bytes.
+void writeMutedDictionaries( QDataStream & out, MutedDictionaries const & muted )
+{
+  QStringList list( muted.begin(), muted.end() );
+  list.sort();
+
+  out << list;
+}
+
+void writeGroup( QDataStream & out, Group const & g )
+{
+  out << g.id << g.name << g.icon << g.iconData << g.shortcut.toString() << g.favoritesFolder
+      << (quint32)g.dictionaries.size();
+
+  for ( auto const & ref : g.dictionaries )
+    out << ref.id << ref.name;
+
+  writeMutedDictionaries( out, g.mutedDictionaries );
+  writeMutedDictionaries( out, g.popupMutedDictionaries );
+}
+
+template< class Write >
+QByteArray encodeSection( Write write )
+{
+  QByteArray section;
+  QDataStream out( &section, QIODevice::WriteOnly );
+  out.setVersion( QDataStream::Qt_5_15 );
+
+  write( out );
+
+  return section;
+}
+
+/// The hash of the sections, but for the one holding it
+QByteArray sectionsHash( Store const & store )
+{
+  QMap< QByteArray, QByteArray > sections = store.sections;
+  sections.remove( xmlExportSection );
+
+  return QCryptographicHash::hash( encodeSection( [ &sections ]( QDataStream & out ) {
+                                     out << sections;
+                                   } ),
+                                   QCryptographicHash::Sha1 );
+}
+
+/// The settings section is always made anew. The sections of the lists are
+/// only encoded if the lists differ from those last stored.
+Store toStore( Class const & c )
+{
+  Store const & stored                      = storedSections();
+  std::optional< StoredLists > const & lists = storedLists();
+
+  Store store;
+
+  auto const section = [ &stored ]( char const * name, bool unchanged, auto write ) {
+    if ( unchanged && stored.sections.contains( name ) )
+      return stored.sections.value( name );
+
+    return encodeSection( write );
+  };
+
+  store.sections[ "xml" ] = toXml( c, false ).toByteArray();
+
+  store.sections[ "dictionaryOrder" ] =
+    section( "dictionaryOrder", lists && lists->dictionaryOrder == c.dictionaryOrder, [ &c ]( QDataStream & out ) {
+      writeGroup( out, c.dictionaryOrder );
+    } );
+
+  store.sections[ "inactiveDictionaries" ] =
+    section( "inactiveDictionaries",
+             lists && lists->inactiveDictionaries == c.inactiveDictionaries,
+             [ &c ]( QDataStream & out ) {
+               writeGroup( out, c.inactiveDictionaries );
+             } );
+
+  store.sections[ "groups" ] =
+    section( "groups",
+             lists && lists->groups.nextId == c.groups.nextId && lists->groups == c.groups,
+             [ &c ]( QDataStream & out ) {
+               out << c.groups.nextId << (quint32)c.groups.size();
+
+               for ( auto const & g : c.groups )
+                 writeGroup( out, g );
+             } );
+
+  store.sections[ "mutedDictionaries" ] =
+    section( "mutedDictionaries",
+             lists && lists->mutedDictionaries == c.mutedDictionaries
+               && lists->popupMutedDictionaries == c.popupMutedDictionaries,
+             [ &c ]( QDataStream & out ) {
+               writeMutedDictionaries( out, c.mutedDictionaries );
+               writeMutedDictionaries( out, c.popupMutedDictionaries );
+             } );
+
+  return store;
+}
+
+void writeStore( QString const & fileName, Store const & store )
+{
+  QSaveFile file( fileName );
+
+  if ( !file.open( QFile::WriteOnly ) )
     throw exCantWriteConfigFile();
+
+  QDataStream out( &file );
+  out.setVersion( QDataStream::Qt_5_15 );
+
+  out << storeMagic << storeVersion << store.xmlModified << store.sections;
+
+  if ( out.status() != QDataStream::Ok || !file.commit() )
+    throw exCantWriteConfigFile();
+}
+
+} // namespace
+
+void save( Class const & c, bool withXml )
+{
+  QString const configName = getConfigFileName();
+  QString const storeName  = getConfigStoreFileName();
+
+  Store & stored = storedSections();
+  Store store    = toStore( c );
+
+  QFileInfo xml( configName );
+
+  // The XML is written again only if the config has changed since it last
+  // was, or the file was edited or removed in the meantime
+  QByteArray const hash = sectionsHash( store );
+  QByteArray exported   = stored.sections.value( xmlExportSection );
+
+  if ( withXml
+       && ( !xml.exists() || xml.lastModified().toMSecsSinceEpoch() != stored.xmlModified || exported != hash ) ) {
+    QSaveFile configFile( configName );
+
+    if ( !configFile.open( QFile::WriteOnly ) )
+      throw exCantWriteConfigFile();
+
+    configFile.write( toXml( c, true ).toByteArray() );
+    if ( !configFile.commit() )
+      throw exCantWriteConfigFile();
+
+    xml.refresh();
+    exported = hash;
+  }
+
+  if ( !exported.isEmpty() )
+    store.sections[ xmlExportSection ] = exported;
+
+  if ( xml.exists() )
+    store.xmlModified = xml.lastModified().toMSecsSinceEpoch();
+
+  if ( store.xmlModified == stored.xmlModified && store.sections == stored.sections && QFile::exists( storeName ) ) {
+    rememberLists( c );
+    return; // Nothing has changed
+  }
+
+  writeStore( storeName, store );
+
+  stored = std::move( store );
+  rememberLists( c );
 }
 
 QString getConfigFileName()
@@ -2241,6 +2636,11 @@ QString getConfigFileName()
   return getHomeDir().absoluteFilePath( "config" );
 }
 
+QString getConfigStoreFileName()
+{
+  return getHomeDir().absoluteFilePath( "config.bin" );
+}
+
 QString getConfigDir()
 {
   return getHomeDir().path() + QDir::separator();
@@ -405,6 +405,22 @@ struct Preferences
   bool clearNetworkCacheOnExit;
   bool removeInvalidIndexOnExit = false;
 
+  /// How much index data, in MiB, may be prefetched in background after
+  /// startup for the dictionaries of the current group. 0 disables it.
+  unsigned indexWarmUpBudget = 32;
+
+  /// Keep all the dictionaries' indexes in a single packed file, see indexpack.hh
+  bool packedIndexStore = false;
+
+  /// A read-only directory of indexes shared by several users, see
+  /// indexpack.hh. Empty means the GOLDENDICT_SHARED_INDEX_DIR environment
+  /// variable is used, if set.
+  QString sharedIndexDir;
+
+  /// The memory, in MiB, all the in-memory caches may take together, see
+  /// memorybudget.hh. 0 derives it from the memory available.
+  unsigned cacheMemoryBudget = 0;
+
   qreal zoomFactor;
   qreal helpZoomFactor;
   int wordsZoomLevel;
@@ -744,9 +760,13 @@ struct Program
   } type;
   QString id, name, commandLine;
   QString iconFilename;
+  /// Keep the program running and feed it the words one per line, instead of
+  /// starting it anew for each of them. See Programs::ProgramServer.
+  bool server;
 
   Program():
-    enabled( false )
+    enabled( false ),
+    server( false )
   {
   }
 
@@ -761,14 +781,15 @@ struct Program
     id( id_ ),
     name( name_ ),
     commandLine( commandLine_ ),
-    iconFilename( iconFilename_ )
+    iconFilename( iconFilename_ ),
+    server( false )
   {
   }
 
   bool operator==( Program const & other ) const
   {
     return enabled == other.enabled && type == other.type && name == other.name && commandLine == other.commandLine
-      && iconFilename == other.iconFilename;
+      && iconFilename == other.iconFilename && server == other.server;
   }
 
   bool operator!=( Program const & other ) const
@@ -958,12 +979,22 @@ DEF_EX( exMalformedConfigFile, "The configuration file is malformed", exError )
 /// Loads the configuration, or creates the default one if none is present
 Class load();
 
-/// Saves the configuration
-void save( Class const & );
-
-/// Returns the configuration file name.
+/// Saves the configuration to the store, unless it hasn't changed. The lists
+/// of the dictionaries are only encoded again when they differ from the ones
+/// last stored, while the settings section, in XML, is always made for the
+/// comparison. Any change rewrites the whole store. With withXml, the XML
+/// config, which older versions read and which the user might edit by hand,
+/// is written as well, unless nothing has changed since it last was; it's
+/// enough to do so on exit. An XML config changed since the store was written
+/// is imported on load.
+void save( Class const &, bool withXml = false );
+
+/// Returns the XML configuration file name.
 QString getConfigFileName();
 
+/// Returns the name of the binary configuration store.
+QString getConfigStoreFileName();
+
 /// Returns the main configuration directory.
 QString getConfigDir();
 
@@ -3,6 +3,7 @@
 
 #include "aard.hh"
 #include "btreeidx.hh"
+#include "articleassembler.hh"
 #include "folding.hh"
 #include "utf8.hh"
 #include "chunkedstorage.hh"
@@ -593,7 +594,9 @@ AardDictionary::getSearchResults( QString const & searchString, int searchMode,
 
 /// AardDictionary::getArticle()
 
-class AardArticleRequest: public Dictionary::DataRequest
+class AardArticleRequest:
+  public Dictionary::DataRequest,
+  public ArticleAssembler::Assembler< AardArticleRequest >
 {
   wstring word;
   vector< wstring > alts;
@@ -621,6 +624,10 @@ public:
 
   void run();
 
+  bool loadArticle( WordArticleLink const &, ArticleAssembler::Article & );
+
+  void appendArticle( string & out, ArticleAssembler::Article const & );
+
   void cancel() override
   {
     isCancelled.ref();
@@ -640,92 +647,34 @@ void AardArticleRequest::run()
     return;
   }
 
-  vector< WordArticleLink > chain = dict.findArticles( word, ignoreDiacritics );
-
-  for ( const auto & alt : alts ) {
-    /// Make an additional query for each alt
-
-    vector< WordArticleLink > altChain = dict.findArticles( alt, ignoreDiacritics );
-
-    chain.insert( chain.end(), altChain.begin(), altChain.end() );
-  }
-
-  multimap< wstring, pair< string, string > > mainArticles, alternateArticles;
-
-  set< quint32 > articlesIncluded; // Some synonims make it that the articles
-                                   // appear several times. We combat this
-                                   // by only allowing them to appear once.
-
-  wstring wordCaseFolded = Folding::applySimpleCaseOnly( word );
-  if ( ignoreDiacritics )
-    wordCaseFolded = Folding::applyDiacriticsOnly( wordCaseFolded );
-
-  for ( auto & x : chain ) {
-    if ( Utils::AtomicInt::loadAcquire( isCancelled ) ) {
-      finish();
-      return;
-    }
-
-    if ( articlesIncluded.find( x.articleOffset ) != articlesIncluded.end() )
-      continue; // We already have this article in the body.
-
-    // Now grab that article
-
-    string headword, articleText;
-
-    headword = x.word;
-    try {
-      dict.loadArticle( x.articleOffset, articleText );
-    }
-    catch ( ... ) {
-    }
-
-    // Ok. Now, does it go to main articles, or to alternate ones? We list
-    // main ones first, and alternates after.
-
-    // We do the case-folded comparison here.
-
-    wstring headwordStripped = Folding::applySimpleCaseOnly( headword );
-    if ( ignoreDiacritics )
-      headwordStripped = Folding::applyDiacriticsOnly( headwordStripped );
-
-    multimap< wstring, pair< string, string > > & mapToUse =
-      ( wordCaseFolded == headwordStripped ) ? mainArticles : alternateArticles;
-
-    mapToUse.insert( pair( Folding::applySimpleCaseOnly( headword ), pair( headword, articleText ) ) );
+  string result;
 
-    articlesIncluded.insert( x.articleOffset );
-  }
+  if ( assemble( dict, word, alts, ignoreDiacritics, isCancelled, result ) ) {
+    appendString( std::move( result ) );
 
-  if ( mainArticles.empty() && alternateArticles.empty() ) {
-    // No such word
-    finish();
-    return;
+    hasAnyData = true;
   }
 
-  string result;
-
-  multimap< wstring, pair< string, string > >::const_iterator i;
+  finish();
+}
 
-  for ( i = mainArticles.begin(); i != mainArticles.end(); ++i ) {
-    result += "<h3>";
-    result += i->second.first;
-    result += "</h3>";
-    result += i->second.second;
+bool AardArticleRequest::loadArticle( WordArticleLink const & link, ArticleAssembler::Article & article )
+{
+  try {
+    dict.loadArticle( link.articleOffset, article.text );
   }
-
-  for ( i = alternateArticles.begin(); i != alternateArticles.end(); ++i ) {
-    result += "<h3>";
-    result += i->second.first;
-    result += "</h3>";
-    result += i->second.second;
+  catch ( ... ) {
   }
 
-  appendString( result );
-
-  hasAnyData = true;
+  return true;
+}
 
-  finish();
+void AardArticleRequest::appendArticle( string & out, ArticleAssembler::Article const & article )
+{
+  out += "<h3>";
+  out += article.headword;
+  out += "</h3>";
+  out += article.text;
 }
 
 sptr< Dictionary::DataRequest > AardDictionary::getArticle( wstring const & word,
@@ -0,0 +1,238 @@
+/* This file is part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
+
+#ifndef __ARTICLEASSEMBLER_HH_INCLUDED__
+#define __ARTICLEASSEMBLER_HH_INCLUDED__
+
+#include "btreeidx.hh"
+#include "folding.hh"
+#include "utils.hh"
+
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <QAtomicInt>
+
+/// What the article requests of the btree-indexed dictionaries have in common:
+/// looking the word and its alternate forms up in the index, loading each of
+/// the articles found once, and putting them on the page, the ones whose
+/// headwords match the word first and the rest after them.
+namespace ArticleAssembler {
+
+using BtreeIndexing::WordArticleLink;
+using gd::wstring;
+using std::string;
+using std::vector;
+
+struct Article
+{
+  string headword; // Preset to the link's word
+  string text;
+
+  /// Shown instead of the headword when not empty
+  string displayedHeadword;
+
+  /// The articles with the same key are only shown once. Preset to the one
+  /// the link got, but can be changed while loading, if it's only then that
+  /// the article turns out to be the same as some other one.
+  quint64 key;
+
+  /// Whether the headword matches the word looked up. Set after loading.
+  bool isMain = false;
+};
+
+/// A base to be mixed into the request, which has to supply
+///
+///   bool loadArticle( WordArticleLink const &, Article & );
+///     Loads the article. Returns false to leave it out.
+///   void appendArticle( string & out, Article const & );
+///     Appends the article's html to the page.
+///
+/// and might hide any of the defaults below.
+template< class Request >
+class Assembler
+{
+public:
+
+  /// Only this many links are taken, the alternate forms' ones included.
+  /// 0 stands for no limit.
+  static constexpr size_t maxLinks = 0;
+
+  /// The alternate forms are ignored altogether when there are more of them.
+  static constexpr size_t maxAlts = 0;
+
+  /// An alternate form's chain is ignored when it's longer than that.
+  static constexpr size_t maxAltChain = 0;
+
+  /// Tells the same articles apart before they are loaded. The articles are
+  /// loaded in the order of the keys, so it's best for them to follow the
+  /// order of the articles' storage.
+  quint64 articleKey( WordArticleLink const & link )
+  {
+    return link.articleOffset;
+  }
+
+  /// The headword as compared to the word, case-folded. The headword itself
+  /// is given.
+  wstring matchedHeadword( Article const &, wstring const & caseFolded )
+  {
+    return caseFolded;
+  }
+
+protected:
+
+  /// Appends the articles to the result. Returns false if nothing was found
+  /// or the request was cancelled. The exceptions loadArticle() throws are
+  /// passed on.
+  bool assemble( BtreeIndexing::BtreeIndex & index,
+                 wstring const & word,
+                 vector< wstring > const & alts,
+                 bool ignoreDiacritics,
+                 QAtomicInt const & isCancelled,
+                 string & result );
+};
+
+template< class Request >
+bool Assembler< Request >::assemble( BtreeIndexing::BtreeIndex & index,
+                                     wstring const & word,
+                                     vector< wstring > const & alts,
+                                     bool ignoreDiacritics,
+                                     QAtomicInt const & isCancelled,
+                                     string & result )
+{
+  Request & request = static_cast< Request & >( *this );
+
+  // The word and its alternate forms are looked up in one go
+
+  vector< wstring > words( 1, word );
+
+  if ( !Request::maxAlts || alts.size() < Request::maxAlts )
+    words.insert( words.end(), alts.begin(), alts.end() );
+
+  vector< vector< WordArticleLink > > chains = index.findArticles( words, ignoreDiacritics );
+
+  vector< WordArticleLink > chain = std::move( chains.front() );
+
+  for ( size_t x = 1; x < chains.size(); ++x ) {
+    if ( Request::maxAltChain && chains[ x ].size() > Request::maxAltChain )
+      continue;
+
+    chain.insert( chain.end(),
+                  std::make_move_iterator( chains[ x ].begin() ),
+                  std::make_move_iterator( chains[ x ].end() ) );
+  }
+
+  if ( Request::maxLinks && chain.size() > Request::maxLinks )
+    chain.resize( Request::maxLinks );
+
+  // Some synonyms make it that the articles appear several times. Those are
+  // dropped before anything gets loaded.
+
+  struct Entry
+  {
+    size_t order; // In the chain
+    WordArticleLink const * link;
+    Article article;
+    wstring caseFolded;
+    bool dropped;
+  };
+
+  vector< Entry > entries;
+  entries.reserve( chain.size() );
+
+  {
+    std::unordered_set< quint64 > keys;
+
+    for ( size_t x = 0; x < chain.size(); ++x ) {
+      quint64 key = request.articleKey( chain[ x ] );
+
+      if ( keys.insert( key ).second ) {
+        entries.push_back( Entry{ x, &chain[ x ], Article(), wstring(), false } );
+        entries.back().article.key = key;
+      }
+    }
+  }
+
+  std::sort( entries.begin(), entries.end(), []( Entry const & a, Entry const & b ) {
+    return a.article.key < b.article.key;
+  } );
+
+  auto const dropped = []( Entry const & entry ) {
+    return entry.dropped;
+  };
+
+  for ( auto & entry : entries ) {
+    if ( Utils::AtomicInt::loadAcquire( isCancelled ) )
+      return false;
+
+    entry.article.headword = entry.link->word;
+    entry.dropped          = !request.loadArticle( *entry.link, entry.article );
+  }
+
+  entries.erase( std::remove_if( entries.begin(), entries.end(), dropped ), entries.end() );
+
+  // Back to the order of the chain, which decides among the articles which
+  // turned out to be the same only after loading, and among the equal
+  // headwords below
+
+  std::sort( entries.begin(), entries.end(), []( Entry const & a, Entry const & b ) {
+    return a.order < b.order;
+  } );
+
+  wstring wordCaseFolded = Folding::applySimpleCaseOnly( word );
+  if ( ignoreDiacritics )
+    wordCaseFolded = Folding::applyDiacriticsOnly( wordCaseFolded );
+
+  {
+    std::unordered_set< quint64 > keys;
+
+    for ( auto & entry : entries ) {
+      entry.dropped = !keys.insert( entry.article.key ).second;
+      if ( entry.dropped )
+        continue;
+
+      entry.caseFolded = Folding::applySimpleCaseOnly( entry.article.headword );
+
+      wstring matched = request.matchedHeadword( entry.article, entry.caseFolded );
+      if ( ignoreDiacritics )
+        matched = Folding::applyDiacriticsOnly( matched );
+
+      entry.article.isMain = matched == wordCaseFolded;
+    }
+  }
+
+  entries.erase( std::remove_if( entries.begin(), entries.end(), dropped ), entries.end() );
+
+  if ( entries.empty() )
+    return false;
+
+  // The main articles go first, each part ordered by the headwords
+
+  std::stable_sort( entries.begin(), entries.end(), []( Entry const & a, Entry const & b ) {
+    if ( a.article.isMain != b.article.isMain )
+      return a.article.isMain;
+
+    return a.caseFolded < b.caseFolded;
+  } );
+
+  // Enough for the articles and the markup around them to go in without
+  // reallocations
+
+  size_t size = result.size();
+
+  for ( auto const & entry : entries )
+    size += entry.article.headword.size() + entry.article.displayedHeadword.size() + entry.article.text.size() + 256;
+
+  result.reserve( size );
+
+  for ( auto const & entry : entries )
+    request.appendArticle( result, entry.article );
+
+  return true;
+}
+
+} // namespace ArticleAssembler
+
+#endif
@@ -2,6 +2,7 @@
  * Part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
 
 #include "bgl.hh"
+#include "articleassembler.hh"
 #include "bgl_babylon.hh"
 #include "btreeidx.hh"
 #include "chunkedstorage.hh"
@@ -56,9 +57,13 @@ using BtreeIndexing::IndexInfo;
 namespace {
 enum {
   Signature            = 0x584c4742, // BGLX on little-endian, XLGB on big-endian
-  CurrentFormatVersion = 19 + BtreeIndexing::FormatVersion
+  CurrentFormatVersion = 20 + BtreeIndexing::FormatVersion
 };
 
+// The articles are stored right in the chunks, and most of them are short,
+// so smaller chunks make fetching one noticeably cheaper.
+unsigned const ChunkSizeBits = 14; // 16 KB
+
 struct IdxHeader
 {
   uint32_t signature;      // First comes the signature, BGLX
@@ -550,7 +555,9 @@ string postfixToSuperscript( string const & in )
 /// BglDictionary::getArticle()
 
 
-class BglArticleRequest: public Dictionary::DataRequest
+class BglArticleRequest:
+  public Dictionary::DataRequest,
+  public ArticleAssembler::Assembler< BglArticleRequest >
 {
   wstring word;
   vector< wstring > alts;
@@ -558,6 +565,7 @@ class BglArticleRequest: public Dictionary::DataRequest
 
   QAtomicInt isCancelled;
   bool ignoreDiacritics;
+  string cleaner = Utils::Html::getHtmlCleaner();
   QFuture< void > f;
 
 public:
@@ -578,6 +586,12 @@ public:
 
   void run();
 
+  wstring matchedHeadword( ArticleAssembler::Article const &, wstring const & );
+
+  bool loadArticle( WordArticleLink const &, ArticleAssembler::Article & );
+
+  void appendArticle( string & out, ArticleAssembler::Article const & );
+
   void cancel() override
   {
     isCancelled.ref();
@@ -635,128 +649,15 @@ void BglArticleRequest::run()
     return;
   }
 
-  vector< WordArticleLink > chain = dict.findArticles( word, ignoreDiacritics );
-
-  static Language::Id hebrew = LangCoder::code2toInt( "he" ); // Hebrew support
-
-  for ( const auto & alt : alts ) {
-    /// Make an additional query for each alt
-
-    vector< WordArticleLink > altChain = dict.findArticles( alt, ignoreDiacritics );
-
-    chain.insert( chain.end(), altChain.begin(), altChain.end() );
-  }
-
-  multimap< wstring, pair< string, string > > mainArticles, alternateArticles;
-
-  set< uint32_t > articlesIncluded; // Some synonims make it that the articles
-                                    // appear several times. We combat this
-                                    // by only allowing them to appear once.
-  // Sometimes the articles are physically duplicated. We store hashes of
-  // the bodies to account for this.
-  set< QByteArray > articleBodiesIncluded;
-
-  wstring wordCaseFolded = Folding::applySimpleCaseOnly( word );
-  if ( ignoreDiacritics )
-    wordCaseFolded = Folding::applyDiacriticsOnly( wordCaseFolded );
-
-  for ( auto & x : chain ) {
-    if ( Utils::AtomicInt::loadAcquire( isCancelled ) ) {
-      finish();
-      return;
-    }
-
-    try {
-
-      if ( articlesIncluded.find( x.articleOffset ) != articlesIncluded.end() )
-        continue; // We already have this article in the body.
-
-      // Now grab that article
-
-      string headword, displayedHeadword, articleText;
-
-      dict.loadArticle( x.articleOffset, headword, displayedHeadword, articleText );
-
-      // Ok. Now, does it go to main articles, or to alternate ones? We list
-      // main ones first, and alternates after.
-
-      // We do the case-folded and postfix-less comparison here.
-
-      wstring headwordStripped = Folding::applySimpleCaseOnly( removePostfix( headword ) );
-      if ( ignoreDiacritics )
-        headwordStripped = Folding::applyDiacriticsOnly( headwordStripped );
-
-      // Hebrew support - fix Hebrew text
-      if ( dict.idxHeader.langFrom == hebrew ) {
-        displayedHeadword = displayedHeadword.size() ? displayedHeadword : headword;
-        fixHebString( articleText );
-        fixHebArticle( articleText );
-        fixHebString( displayedHeadword );
-      }
-
-      string const & targetHeadword = displayedHeadword.size() ? displayedHeadword : headword;
-
-      QCryptographicHash hash( QCryptographicHash::Md5 );
-      hash.addData( targetHeadword.data(), targetHeadword.size() + 1 ); // with 0
-      hash.addData( articleText.data(), articleText.size() );
-
-      if ( !articleBodiesIncluded.insert( hash.result() ).second )
-        continue; // Already had this body
-
-      multimap< wstring, pair< string, string > > & mapToUse =
-        ( wordCaseFolded == headwordStripped ) ? mainArticles : alternateArticles;
-
-      mapToUse.insert( pair( Folding::applySimpleCaseOnly( headword ), pair( targetHeadword, articleText ) ) );
-
-      articlesIncluded.insert( x.articleOffset );
-
-    } // try
-    catch ( std::exception & ex ) {
-      gdWarning( "BGL: Failed loading article from \"%s\", reason: %s\n", dict.getName().c_str(), ex.what() );
-    }
-  }
+  string result;
 
-  if ( mainArticles.empty() && alternateArticles.empty() ) {
+  if ( !assemble( dict, word, alts, ignoreDiacritics, isCancelled, result ) ) {
     // No such word
     finish();
     return;
   }
 
-  string result;
-
-  multimap< wstring, pair< string, string > >::const_iterator i;
-
-  string cleaner = Utils::Html::getHtmlCleaner();
-  for ( i = mainArticles.begin(); i != mainArticles.end(); ++i ) {
-    if ( dict.isFromLanguageRTL() ) // RTL support
-      result += "<h3 style=\"text-align:right;direction:rtl\">";
-    else
-      result += "<h3>";
-    result += postfixToSuperscript( i->second.first );
-    result += "</h3>";
-    if ( dict.isToLanguageRTL() )
-      result += "<div class=\"bglrtl\">" + i->second.second + "</div>";
-    else
-      result += "<div>" + i->second.second + "</div>";
-    result += cleaner;
-  }
-
-
-  for ( i = alternateArticles.begin(); i != alternateArticles.end(); ++i ) {
-    if ( dict.isFromLanguageRTL() ) // RTL support
-      result += "<h3 style=\"text-align:right;direction:rtl\">";
-    else
-      result += "<h3>";
-    result += postfixToSuperscript( i->second.first );
-    result += "</h3>";
-    if ( dict.isToLanguageRTL() )
-      result += "<div class=\"bglrtl\">" + i->second.second + "</div>";
-    else
-      result += "<div>" + i->second.second + "</div>";
-    result += cleaner;
-  }
   // Do some cleanups in the text
-
   BglDictionary::replaceCharsetEntities( result );
 
   result =
@@ -785,14 +686,67 @@ void BglArticleRequest::run()
       .toUtf8()
       .data();
 
-
-  appendString( result );
+  appendString( std::move( result ) );
 
   hasAnyData = true;
 
   finish();
 }
 
+bool BglArticleRequest::loadArticle( WordArticleLink const & link, ArticleAssembler::Article & article )
+{
+  static Language::Id hebrew = LangCoder::code2toInt( "he" ); // Hebrew support
+
+  try {
+    dict.loadArticle( link.articleOffset, article.headword, article.displayedHeadword, article.text );
+  }
+  catch ( std::exception & ex ) {
+    gdWarning( "BGL: Failed loading article from \"%s\", reason: %s\n", dict.getName().c_str(), ex.what() );
+    return false;
+  }
+
+  // Hebrew support - fix Hebrew text
+  if ( dict.idxHeader.langFrom == hebrew ) {
+    if ( article.displayedHeadword.empty() )
+      article.displayedHeadword = article.headword;
+    fixHebString( article.text );
+    fixHebArticle( article.text );
+    fixHebString( article.displayedHeadword );
+  }
+
+  string const & targetHeadword = article.displayedHeadword.size() ? article.displayedHeadword : article.headword;
+
+  // Sometimes the articles are physically duplicated. The hashes of the
+  // bodies are used as the keys to account for this.
+  QCryptographicHash hash( QCryptographicHash::Md5 );
+  hash.addData( targetHeadword.data(), targetHeadword.size() + 1 ); // with 0
+  hash.addData( article.text.data(), article.text.size() );
+
+  memcpy( &article.key, hash.result().constData(), sizeof( article.key ) );
+
+  return true;
+}
+
+wstring BglArticleRequest::matchedHeadword( ArticleAssembler::Article const & article, wstring const & )
+{
+  // The comparison is postfix-less
+  return Folding::applySimpleCaseOnly( removePostfix( article.headword ) );
+}
+
+void BglArticleRequest::appendArticle( string & out, ArticleAssembler::Article const & article )
+{
+  if ( dict.isFromLanguageRTL() ) // RTL support
+    out += "<h3 style=\"text-align:right;direction:rtl\">";
+  else
+    out += "<h3>";
+  out += postfixToSuperscript( article.displayedHeadword.size() ? article.displayedHeadword : article.headword );
+  out += "</h3>";
+  out += dict.isToLanguageRTL() ? "<div class=\"bglrtl\">" : "<div>";
+  out += article.text;
+  out += "</div>";
+  out += cleaner;
+}
+
 sptr< Dictionary::DataRequest > BglDictionary::getArticle( wstring const & word,
                                                            vector< wstring > const & alts,
                                                            wstring const &,
@@ -1072,7 +1026,7 @@ vector< sptr< Dictionary::Class > > makeDictionaries( vector< string > const & f
         // We use this buffer to decode utf8 into it.
         vector< wchar > wcharBuffer;
 
-        ChunkedStorage::Writer chunks( idx );
+        ChunkedStorage::Writer chunks( idx, ChunkSizeBits );
 
         uint32_t articleCount = 0, wordCount = 0;
 
@@ -3,12 +3,15 @@
 
 #include "dictdfiles.hh"
 #include "btreeidx.hh"
+#include "articleassembler.hh"
 #include "folding.hh"
 #include "utf8.hh"
 #include "dictzip.hh"
 #include "htmlescape.hh"
 
 #include "langcoder.hh"
+#include <exception>
+#include <iterator>
 #include <map>
 #include <set>
 #include <string>
@@ -18,7 +21,9 @@
 #include <stdlib.h>
 #include "gddebug.hh"
 #include "ftshelpers.hh"
+#include <QThread>
 #include <QUrl>
+#include <QtConcurrent>
 
 
 #include <QRegularExpression>
@@ -35,6 +40,7 @@ using std::pair;
 using std::set;
 using std::string;
 using gd::wstring;
+using gd::wchar;
 using std::vector;
 using std::list;
 
@@ -130,6 +136,10 @@ public:
   sptr< Dictionary::DataRequest >
   getArticle( wstring const &, vector< wstring > const & alts, wstring const &, bool ignoreDiacritics ) override;
 
+  /// Loads the article the .index file line at the given offset points to,
+  /// converting it to html.
+  string loadArticle( uint32_t address );
+
   QString const & getDescription() override;
 
   sptr< Dictionary::DataRequest >
@@ -145,6 +155,33 @@ public:
   }
 };
 
+/// Puts the page together for DictdDictionary::getArticle(), which does it
+/// right away
+class DictdArticles: public ArticleAssembler::Assembler< DictdArticles >
+{
+  DictdDictionary & dict;
+
+public:
+
+  explicit DictdArticles( DictdDictionary & dict_ ):
+    dict( dict_ )
+  {
+  }
+
+  using Assembler::assemble;
+
+  bool loadArticle( WordArticleLink const & link, ArticleAssembler::Article & article )
+  {
+    article.text = dict.loadArticle( link.articleOffset );
+    return true;
+  }
+
+  void appendArticle( string & out, ArticleAssembler::Article const & article )
+  {
+    out += article.text;
+  }
+};
+
 DictdDictionary::DictdDictionary( string const & id,
                                   string const & indexFile,
                                   vector< string > const & dictionaryFiles ):
@@ -223,188 +260,160 @@ void DictdDictionary::loadIcon() noexcept
   dictionaryIconLoaded = true;
 }
 
-uint32_t decodeBase64( string const & str )
+uint32_t decodeBase64( char const * begin, char const * end )
 {
-  static char const digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  // The value of each digit, -1 for the chars which aren't ones
+  static signed char const * const values = [] {
+    static signed char table[ 256 ];
+    static char const digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    memset( table, -1, sizeof( table ) );
+    for ( int x = 0; x < 64; ++x )
+      table[ (unsigned char)digits[ x ] ] = x;
+
+    return table;
+  }();
 
   uint32_t number = 0;
 
-  for ( char const * next = str.c_str(); *next; ++next ) {
-    char const * d = strchr( digits, *next );
+  for ( ; begin != end; ++begin ) {
+    signed char value = values[ (unsigned char)*begin ];
 
-    if ( !d )
+    if ( value < 0 )
       throw exInvalidBase64();
 
-    number = number * 64 + ( d - digits );
+    number = number * 64 + value;
   }
 
   return number;
 }
 
-sptr< Dictionary::DataRequest > DictdDictionary::getArticle( wstring const & word,
-                                                             vector< wstring > const & alts,
-                                                             wstring const &,
-                                                             bool ignoreDiacritics )
-
+uint32_t decodeBase64( char const * str )
 {
-  try {
-    vector< WordArticleLink > chain = findArticles( word, ignoreDiacritics );
-
-    for ( const auto & alt : alts ) {
-      /// Make an additional query for each alt
-
-      vector< WordArticleLink > altChain = findArticles( alt, ignoreDiacritics );
-
-      chain.insert( chain.end(), altChain.begin(), altChain.end() );
-    }
-
-    multimap< wstring, string > mainArticles, alternateArticles;
-
-    set< uint32_t > articlesIncluded; // Some synonyms make it that the articles
-                                      // appear several times. We combat this
-                                      // by only allowing them to appear once.
-
-    wstring wordCaseFolded = Folding::applySimpleCaseOnly( word );
-    if ( ignoreDiacritics )
-      wordCaseFolded = Folding::applyDiacriticsOnly( wordCaseFolded );
-
-    char buf[ 16384 ];
-
-    for ( auto & x : chain ) {
-      if ( articlesIncluded.find( x.articleOffset ) != articlesIncluded.end() )
-        continue; // We already have this article in the body.
-
-      // Now load that article
-
-      {
-        QMutexLocker _( &indexFileMutex );
-        indexFile.seek( x.articleOffset );
-
-        if ( !indexFile.gets( buf, sizeof( buf ), true ) )
-          throw exFailedToReadLineFromIndex();
-      }
-
-      char * tab1 = strchr( buf, '\t' );
+  return decodeBase64( str, str + strlen( str ) );
+}
 
-      if ( !tab1 )
-        throw exMalformedIndexFileLine();
+string DictdDictionary::loadArticle( uint32_t address )
+{
+  char buf[ 16384 ];
 
-      char * tab2 = strchr( tab1 + 1, '\t' );
+  {
+    QMutexLocker _( &indexFileMutex );
+    indexFile.seek( address );
 
-      if ( !tab2 )
-        throw exMalformedIndexFileLine();
+    if ( !indexFile.gets( buf, sizeof( buf ), true ) )
+      throw exFailedToReadLineFromIndex();
+  }
 
-      // After tab1 should be article offset, after tab2 -- article size
+  char * tab1 = strchr( buf, '\t' );
 
-      uint32_t articleOffset = decodeBase64( string( tab1 + 1, tab2 - tab1 - 1 ) );
+  if ( !tab1 )
+    throw exMalformedIndexFileLine();
 
-      char * tab3 = strchr( tab2 + 1, '\t' );
+  char * tab2 = strchr( tab1 + 1, '\t' );
 
-      uint32_t articleSize;
-      if ( tab3 ) {
-        articleSize = decodeBase64( string( tab2 + 1, tab3 - tab2 - 1 ) );
-      }
-      else {
-        articleSize = decodeBase64( tab2 + 1 );
-      }
+  if ( !tab2 )
+    throw exMalformedIndexFileLine();
 
-      string articleText;
+  // After tab1 should be article offset, after tab2 -- article size
 
-      char * articleBody;
-      {
-        QMutexLocker _( &dzMutex );
-        articleBody = dict_data_read_( dz, articleOffset, articleSize, 0, 0 );
-      }
+  uint32_t articleOffset = decodeBase64( tab1 + 1, tab2 );
 
-      if ( !articleBody ) {
-        articleText = string( "<div class=\"dictd_article\">DICTZIP error: " ) + dict_error_str( dz ) + "</div>";
-      }
-      else {
-        static QRegularExpression phonetic( R"(\\([^\\]+)\\)",
-                                            QRegularExpression::CaseInsensitiveOption ); // phonetics: \stuff\ ...
-        static QRegularExpression refs( R"(\{([^\{\}]+)\})",
-                                        QRegularExpression::CaseInsensitiveOption ); // links: {stuff}
-        static QRegularExpression links( "<a href=\"gdlookup://localhost/([^\"]*)\">",
-                                         QRegularExpression::CaseInsensitiveOption );
-        static QRegularExpression tags( "<[^>]*>", QRegularExpression::CaseInsensitiveOption );
-
-
-        articleText = string( "<div class=\"dictd_article\"" );
-        if ( isToLanguageRTL() )
-          articleText += " dir=\"rtl\"";
-        articleText += ">";
-
-        string convertedText = Html::preformat( articleBody, isToLanguageRTL() );
-        free( articleBody );
-
-        QString articleString = QString::fromUtf8( convertedText.c_str() )
-                                  .replace( phonetic, R"(<span class="dictd_phonetic">\1</span>)" )
-                                  .replace( refs, R"(<a href="gdlookup://localhost/\1">\1</a>)" );
-        convertedText.erase();
-
-        int pos = 0;
-
-        QString articleNewString;
-        QRegularExpressionMatchIterator it = links.globalMatch( articleString );
-        while ( it.hasNext() ) {
-          QRegularExpressionMatch match = it.next();
-          articleNewString += articleString.mid( pos, match.capturedStart() - pos );
-          pos = match.capturedEnd();
-
-          QString link = match.captured( 1 );
-          link.replace( tags, " " );
-          link.replace( "&nbsp;", " " );
-
-          QString newLink = match.captured();
-          newLink.replace( 30,
-                           match.capturedLength( 1 ),
-                           QString::fromUtf8( QUrl::toPercentEncoding( link.simplified() ) ) );
-          articleNewString += newLink;
-        }
-        if ( pos ) {
-          articleNewString += articleString.mid( pos );
-          articleString = articleNewString;
-          articleNewString.clear();
-        }
+  char * tab3 = strchr( tab2 + 1, '\t' );
 
+  uint32_t articleSize;
+  if ( tab3 ) {
+    articleSize = decodeBase64( tab2 + 1, tab3 );
+  }
+  else {
+    articleSize = decodeBase64( tab2 + 1 );
+  }
 
-        articleString += "</div>";
+  string articleText;
 
-        articleText += articleString.toUtf8().data();
-      }
+  char * articleBody;
+  {
+    QMutexLocker _( &dzMutex );
+    articleBody = dict_data_read_( dz, articleOffset, articleSize, 0, 0 );
+  }
 
-      // Ok. Now, does it go to main articles, or to alternate ones? We list
-      // main ones first, and alternates after.
+  if ( !articleBody ) {
+    articleText = string( "<div class=\"dictd_article\">DICTZIP error: " ) + dict_error_str( dz ) + "</div>";
+  }
+  else {
+    static QRegularExpression phonetic( R"(\\([^\\]+)\\)",
+                                        QRegularExpression::CaseInsensitiveOption ); // phonetics: \stuff\ ...
+    static QRegularExpression refs( R"(\{([^\{\}]+)\})",
+                                    QRegularExpression::CaseInsensitiveOption ); // links: {stuff}
+    static QRegularExpression links( "<a href=\"gdlookup://localhost/([^\"]*)\">",
+                                     QRegularExpression::CaseInsensitiveOption );
+    static QRegularExpression tags( "<[^>]*>", QRegularExpression::CaseInsensitiveOption );
+
+
+    articleText = string( "<div class=\"dictd_article\"" );
+    if ( isToLanguageRTL() )
+      articleText += " dir=\"rtl\"";
+    articleText += ">";
+
+    string convertedText = Html::preformat( articleBody, isToLanguageRTL() );
+    free( articleBody );
+
+    QString articleString = QString::fromUtf8( convertedText.c_str() )
+                              .replace( phonetic, R"(<span class="dictd_phonetic">\1</span>)" )
+                              .replace( refs, R"(<a href="gdlookup://localhost/\1">\1</a>)" );
+    convertedText.erase();
+
+    int pos = 0;
+
+    QString articleNewString;
+    QRegularExpressionMatchIterator it = links.globalMatch( articleString );
+    while ( it.hasNext() ) {
+      QRegularExpressionMatch match = it.next();
+      articleNewString += articleString.mid( pos, match.capturedStart() - pos );
+      pos = match.capturedEnd();
+
+      QString link = match.captured( 1 );
+      link.replace( tags, " " );
+      link.replace( "&nbsp;", " " );
+
+      QString newLink = match.captured();
+      newLink.replace( 30,
+                       match.capturedLength( 1 ),
+                       QString::fromUtf8( QUrl::toPercentEncoding( link.simplified() ) ) );
+      articleNewString += newLink;
+    }
+    if ( pos ) {
+      articleNewString += articleString.mid( pos );
+      articleString = articleNewString;
+      articleNewString.clear();
+    }
 
-      // We do the case-folded comparison here.
 
-      wstring headwordStripped = Folding::applySimpleCaseOnly( x.word );
-      if ( ignoreDiacritics )
-        headwordStripped = Folding::applyDiacriticsOnly( headwordStripped );
+    articleString += "</div>";
 
-      multimap< wstring, string > & mapToUse =
-        ( wordCaseFolded == headwordStripped ) ? mainArticles : alternateArticles;
+    articleText += articleString.toUtf8().data();
+  }
 
-      mapToUse.insert( pair( Folding::applySimpleCaseOnly( x.word ), articleText ) );
+  return articleText;
+}
 
-      articlesIncluded.insert( x.articleOffset );
-    }
+sptr< Dictionary::DataRequest > DictdDictionary::getArticle( wstring const & word,
+                                                             vector< wstring > const & alts,
+                                                             wstring const &,
+                                                             bool ignoreDiacritics )
 
-    if ( mainArticles.empty() && alternateArticles.empty() )
-      return std::make_shared< Dictionary::DataRequestInstant >( false );
+{
+  try {
+    DictdArticles articles( *this );
+    QAtomicInt isCancelled; // The articles are assembled right away
 
     string result;
 
-    multimap< wstring, string >::const_iterator i;
-
-    for ( i = mainArticles.begin(); i != mainArticles.end(); ++i )
-      result += i->second;
-
-    for ( i = alternateArticles.begin(); i != alternateArticles.end(); ++i )
-      result += i->second;
+    if ( !articles.assemble( *this, word, alts, ignoreDiacritics, isCancelled, result ) )
+      return std::make_shared< Dictionary::DataRequestInstant >( false );
 
     auto ret = std::make_shared< Dictionary::DataRequestInstant >( true );
-    ret->appendString( result );
+    ret->appendString( std::move( result ) );
 
     return ret;
   }
@@ -484,13 +493,13 @@ void DictdDictionary::getArticleText( uint32_t articleAddress, QString & headwor
 
     // After tab1 should be article offset, after tab2 -- article size
 
-    uint32_t articleOffset = decodeBase64( string( tab1 + 1, tab2 - tab1 - 1 ) );
+    uint32_t articleOffset = decodeBase64( tab1 + 1, tab2 );
 
     char * tab3 = strchr( tab2 + 1, '\t' );
 
     uint32_t articleSize;
     if ( tab3 ) {
-      articleSize = decodeBase64( string( tab2 + 1, tab3 - tab2 - 1 ) );
+      articleSize = decodeBase64( tab2 + 1, tab3 );
     }
     else {
       articleSize = decodeBase64( tab2 + 1 );
@@ -538,6 +547,141 @@ DictdDictionary::getSearchResults( QString const & searchString, int searchMode,
                                                             ignoreDiacritics );
 }
 
+/// A run of whole lines of the .index file, parsed on its own while building
+/// the index.
+struct IndexBlock
+{
+  char const * begin;
+  char const * end;
+
+  IndexedWords indexedWords;
+  uint32_t wordCount    = 0;
+  uint32_t articleCount = 0;
+
+  /// The 00-database-short lines, which tell the dictionary's name
+  vector< pair< char const *, char const * > > nameLines;
+
+  std::exception_ptr error;
+};
+
+/// Adds the words of the block's lines. The offsets are relative to the
+/// beginning of the file.
+void parseIndexBlock( IndexBlock & block, char const * fileBegin )
+{
+  vector< wchar > buffer;
+
+  auto const addWord = [ & ]( char const * begin, char const * end, uint32_t offset ) {
+    buffer.resize( end - begin );
+
+    long size = Utf8::decode( begin, end - begin, buffer.data() );
+    if ( size < 0 )
+      throw Utf8::exCantDecode( string( begin, end ) );
+
+    block.indexedWords.addWord( wstring( buffer.data(), size ), offset );
+  };
+
+  try {
+    for ( char const * next = block.begin; next != block.end; ) {
+      char const * line = next;
+
+      auto * eol = (char const *)memchr( line, '\n', block.end - line );
+      next       = eol ? eol + 1 : block.end;
+      eol        = eol ? eol : block.end;
+
+      // The line ends at a zero byte too, should there be one
+      if ( auto * zero = (char const *)memchr( line, 0, eol - line ) )
+        eol = zero;
+
+      while ( eol != line && eol[ -1 ] == '\r' )
+        --eol;
+
+      uint32_t const offset = line - fileBegin;
+
+      // Check that there are exactly two or three tabs in the record.
+      auto * tab1 = (char const *)memchr( line, '\t', eol - line );
+      if ( !tab1 ) {
+        GD_DPRINTF( "Warning: no tabs present, skipping: %s\n", string( line, eol ).c_str() );
+        continue;
+      }
+
+      auto * tab2 = (char const *)memchr( tab1 + 1, '\t', eol - tab1 - 1 );
+      if ( !tab2 ) {
+        GD_DPRINTF( "Warning: only a single tab present, skipping: %s\n", string( line, eol ).c_str() );
+        continue;
+      }
+
+      if ( auto * tab3 = (char const *)memchr( tab2 + 1, '\t', eol - tab2 - 1 ) ) {
+        if ( memchr( tab3 + 1, '\t', eol - tab3 - 1 ) ) {
+          GD_DPRINTF( "Warning: too many tabs present, skipping: %s\n", string( line, eol ).c_str() );
+          continue;
+        }
+
+        // Handle the forth entry, if it exists. From dictfmt man:
+        // When --index-keep-orig option is used fourth column is created
+        // (if necessary) in .index file.
+        addWord( tab3 + 1, eol, offset );
+        ++block.wordCount;
+      }
+
+      addWord( line, tab1, offset );
+      ++block.wordCount;
+      ++block.articleCount;
+
+      if ( ( eol - line >= 15 && !strncmp( line, "00databaseshort", 15 ) )
+           || ( eol - line >= 17 && !strncmp( line, "00-database-short", 17 ) ) )
+        block.nameLines.emplace_back( line, eol );
+    }
+  }
+  catch ( ... ) {
+    block.error = std::current_exception();
+  }
+}
+
+/// Splits the file into blocks of whole lines, to be parsed in parallel
+vector< IndexBlock > splitIndex( char const * begin, char const * end )
+{
+  size_t const minBlockSize = 1024 * 1024;
+
+  size_t blockSize = ( end - begin ) / ( QThread::idealThreadCount() * 4 ) + 1;
+  blockSize        = std::max( blockSize, minBlockSize );
+
+  vector< IndexBlock > blocks;
+
+  while ( begin != end ) {
+    char const * blockEnd = end;
+
+    if ( (size_t)( end - begin ) > blockSize ) {
+      auto * eol = (char const *)memchr( begin + blockSize, '\n', end - begin - blockSize );
+      blockEnd   = eol ? eol + 1 : end;
+    }
+
+    blocks.emplace_back();
+    blocks.back().begin = begin;
+    blocks.back().end   = blockEnd;
+
+    begin = blockEnd;
+  }
+
+  return blocks;
+}
+
+/// Moves the words of 'from' into 'to', after the ones already there.
+void mergeIndexedWords( IndexedWords & to, IndexedWords & from )
+{
+  for ( auto & [ word, links ] : from ) {
+    auto i = to.lower_bound( word );
+
+    if ( i == to.end() || i->first != word )
+      to.emplace_hint( i, word, std::move( links ) );
+    else
+      i->second.insert( i->second.end(),
+                        std::make_move_iterator( links.begin() ),
+                        std::make_move_iterator( links.end() ) );
+  }
+
+  from.clear();
+}
+
 } // anonymous namespace
 
 vector< sptr< Dictionary::Class > > makeDictionaries( vector< string > const & fileNames,
@@ -594,88 +738,79 @@ vector< sptr< Dictionary::Class > > makeDictionaries( vector< string > const & f
 
         File::Index indexFile( dictFiles[ 0 ], "rb" );
 
-        // Read words from index until none's left.
-
-        char buf[ 16384 ];
+        // The lines are parsed in parallel, straight from the mapped file
 
-        do {
-          uint32_t curOffset = indexFile.tell();
+        qint64 const indexFileSize = indexFile.file().size();
+        QByteArray indexFileData;
 
-          if ( !indexFile.gets( buf, sizeof( buf ), true ) )
-            break;
+        auto * begin      = indexFileSize > 0 ? (char const *)indexFile.map( 0, indexFileSize ) : nullptr;
+        bool const mapped = begin;
+        char const * end  = begin + indexFileSize;
 
-          // Check that there are exactly two or three tabs in the record.
-          char * tab1 = strchr( buf, '\t' );
-          if ( tab1 ) {
-            char * tab2 = strchr( tab1 + 1, '\t' );
-            if ( tab2 ) {
-              char * tab3 = strchr( tab2 + 1, '\t' );
-              if ( tab3 ) {
-                char * tab4 = strchr( tab3 + 1, '\t' );
-                if ( tab4 ) {
-                  GD_DPRINTF( "Warning: too many tabs present, skipping: %s\n", buf );
-                  continue;
-                }
+        if ( !mapped ) {
+          indexFileData = indexFile.readall();
+          begin         = indexFileData.constData();
+          end           = begin + indexFileData.size();
+        }
 
-                // Handle the forth entry, if it exists. From dictfmt man:
-                // When --index-keep-orig option is used fourth column is created
-                // (if necessary) in .index file.
-                indexedWords.addWord( Utf8::decode( string( tab3 + 1, strlen( tab3 + 1 ) ) ), curOffset );
-                ++idxHeader.wordCount;
-              }
-              indexedWords.addWord( Utf8::decode( string( buf, strchr( buf, '\t' ) - buf ) ), curOffset );
-              ++idxHeader.wordCount;
-              ++idxHeader.articleCount;
-
-              // Check for proper dictionary name
-              if ( !strncmp( buf, "00databaseshort", 15 ) || !strncmp( buf, "00-database-short", 17 ) ) {
-                // After tab1 should be article offset, after tab2 -- article size
-                uint32_t articleOffset = decodeBase64( string( tab1 + 1, tab2 - tab1 - 1 ) );
-                uint32_t articleSize   = decodeBase64( tab2 + 1 );
-
-                DZ_ERRORS error;
-                dictData * dz = dict_data_open( dictFiles[ 1 ].c_str(), &error, 0 );
-
-                if ( dz ) {
-                  char * articleBody = dict_data_read_( dz, articleOffset, articleSize, 0, 0 );
-                  if ( articleBody ) {
-                    char * eol;
-                    if ( !strncmp( articleBody, "00databaseshort", 15 )
-                         || !strncmp( articleBody, "00-database-short", 17 ) )
-                      eol = strchr( articleBody, '\n' ); // skip the first line (headword itself)
-                    else
-                      eol = articleBody; // No headword itself
-                    if ( eol ) {
-                      while ( *eol && Utf8::isspace( *eol ) )
-                        ++eol; // skip spaces
-
-                      // use only the single line for the dictionary title
-                      char * endEol = strchr( eol, '\n' );
-                      if ( endEol )
-                        *endEol = 0;
-
-                      GD_DPRINTF( "DICT NAME: '%s'\n", eol );
-                      dictionaryName = eol;
-                    }
-                  }
-                  dict_data_close( dz );
-                }
+        vector< IndexBlock > blocks = splitIndex( begin, end );
+
+        QtConcurrent::blockingMap( blocks, [ begin ]( IndexBlock & block ) {
+          parseIndexBlock( block, begin );
+        } );
+
+        for ( auto & block : blocks ) {
+          if ( block.error )
+            std::rethrow_exception( block.error );
+
+          mergeIndexedWords( indexedWords, block.indexedWords );
+          idxHeader.wordCount += block.wordCount;
+          idxHeader.articleCount += block.articleCount;
+
+          // Check for proper dictionary name
+          for ( auto const & [ line, lineEnd ] : block.nameLines ) {
+            // After tab1 should be article offset, after tab2 -- article size
+            char const * tab1      = (char const *)memchr( line, '\t', lineEnd - line );
+            char const * tab2      = (char const *)memchr( tab1 + 1, '\t', lineEnd - tab1 - 1 );
+            uint32_t articleOffset = decodeBase64( tab1 + 1, tab2 );
+            uint32_t articleSize   = decodeBase64( tab2 + 1, lineEnd );
+
+            DZ_ERRORS error;
+            dictData * dz = dict_data_open( dictFiles[ 1 ].c_str(), &error, 0 );
+
+            if ( dz ) {
+              char * articleBody = dict_data_read_( dz, articleOffset, articleSize, 0, 0 );
+              if ( articleBody ) {
+                char * eol;
+                if ( !strncmp( articleBody, "00databaseshort", 15 )
+                     || !strncmp( articleBody, "00-database-short", 17 ) )
+                  eol = strchr( articleBody, '\n' ); // skip the first line (headword itself)
                 else
-                  throw exDictzipError( string( dz_error_str( error ) ) + "(" + dictFiles[ 1 ] + ")" );
+                  eol = articleBody; // No headword itself
+                if ( eol ) {
+                  while ( *eol && Utf8::isspace( *eol ) )
+                    ++eol; // skip spaces
+
+                  // use only the single line for the dictionary title
+                  char * endEol = strchr( eol, '\n' );
+                  if ( endEol )
+                    *endEol = 0;
+
+                  GD_DPRINTF( "DICT NAME: '%s'\n", eol );
+                  dictionaryName = eol;
+                }
               }
+              dict_data_close( dz );
             }
-            else {
-              GD_DPRINTF( "Warning: only a single tab present, skipping: %s\n", buf );
-              continue;
-            }
-          }
-          else {
-            GD_DPRINTF( "Warning: no tabs present, skipping: %s\n", buf );
-            continue;
+            else
+              throw exDictzipError( string( dz_error_str( error ) ) + "(" + dictFiles[ 1 ] + ")" );
           }
+        }
 
+        blocks.clear();
 
-        } while ( !indexFile.eof() );
+        if ( mapped )
+          indexFile.unmap( (uchar *)begin );
 
 
         // Write dictionary name
@@ -22,6 +22,8 @@
 #include <QRegularExpression>
 #include "utils.hh"
 #include "zipfile.hh"
+#include "indexpack.hh"
+#include "iconcache.hh"
 
 namespace Dictionary {
 
@@ -108,11 +110,12 @@ void WordSearchRequest::addMatch( WordMatch const & match )
 long DataRequest::dataSize()
 {
   QMutexLocker _( &dataMutex );
-  long size = hasAnyData ? (long)data.size() : -1;
+  size_t const segmentsSize = segmentEnds.empty() ? 0 : segmentEnds.back();
+  long size                 = hasAnyData ? (long)( segmentsSize + data.size() ) : -1;
 
   if ( size == 0 && !isFinished() ) {
     cond.wait( &dataMutex );
-    size = hasAnyData ? (long)data.size() : -1;
+    size = hasAnyData ? (long)( ( segmentEnds.empty() ? 0 : segmentEnds.back() ) + data.size() ) : -1;
   }
   return size;
 }
@@ -137,17 +140,105 @@ void DataRequest::appendString( std::string_view str )
   cond.wakeAll();
 }
 
+void DataRequest::appendString( std::string && str )
+{
+  if ( str.size() < 256 ) {
+    // Not worth a segment of its own
+    appendString( std::string_view( str ) );
+    return;
+  }
+
+  auto const owner = std::make_shared< std::string const >( std::move( str ) );
+
+  QMutexLocker _( &dataMutex );
+  sealData();
+  addSegment( Segment{ owner, owner->data(), owner->size() } );
+  cond.wakeAll();
+}
+
+void DataRequest::appendSegments( vector< Segment > const & other )
+{
+  QMutexLocker _( &dataMutex );
+  sealData();
+
+  for ( auto const & segment : other )
+    addSegment( segment );
+
+  cond.wakeAll();
+}
+
+void DataRequest::sealData()
+{
+  if ( data.empty() )
+    return;
+
+  auto const owner = std::make_shared< vector< char > const >( std::move( data ) );
+  data.clear();
+
+  addSegment( Segment{ owner, owner->data(), owner->size() } );
+}
+
+void DataRequest::addSegment( Segment const & segment )
+{
+  if ( !segment.size )
+    return;
+
+  segments.push_back( segment );
+  segmentEnds.push_back( ( segmentEnds.empty() ? 0 : segmentEnds.back() ) + segment.size );
+}
+
 void DataRequest::getDataSlice( size_t offset, size_t size, void * buffer )
 {
   if ( size == 0 ) {
     return;
   }
-  QMutexLocker _( &dataMutex );
 
-  if ( !hasAnyData )
-    throw exSliceOutOfRange();
+  char * out = static_cast< char * >( buffer );
+
+  // The segments the slice spans, held so they could be copied from after
+  // the mutex is released
+  vector< Segment > spanned;
+  size_t firstOffset = 0; // Where the slice starts in the first of them
+
+  {
+    QMutexLocker _( &dataMutex );
+
+    if ( !hasAnyData )
+      throw exSliceOutOfRange();
+
+    size_t const segmentsSize = segmentEnds.empty() ? 0 : segmentEnds.back();
+
+    if ( offset + size > segmentsSize + data.size() )
+      throw exSliceOutOfRange();
+
+    if ( offset < segmentsSize ) {
+      size_t x    = std::upper_bound( segmentEnds.begin(), segmentEnds.end(), offset ) - segmentEnds.begin();
+      firstOffset = offset - ( segmentEnds[ x ] - segments[ x ].size );
+
+      for ( ; x < segments.size() && segmentEnds[ x ] - segments[ x ].size < offset + size; ++x )
+        spanned.push_back( segments[ x ] );
+    }
+
+    // The rest is in the data, which may change as soon as the mutex is
+    // released
+    if ( offset + size > segmentsSize ) {
+      size_t const dataOffset = offset > segmentsSize ? offset - segmentsSize : 0;
+      size_t const dataSize   = offset + size - segmentsSize - dataOffset;
+
+      memcpy( out + ( size - dataSize ), &data[ dataOffset ], dataSize );
+      size -= dataSize;
+    }
+  }
 
-  memcpy( buffer, &data[ offset ], size );
+  for ( auto const & segment : spanned ) {
+    size_t const n = std::min( segment.size - firstOffset, size );
+
+    memcpy( out, segment.data + firstOffset, n );
+
+    out += n;
+    size -= n;
+    firstOffset = 0;
+  }
 }
 
 vector< char > & DataRequest::getFullData()
@@ -155,9 +246,36 @@ vector< char > & DataRequest::getFullData()
   if ( !isFinished() )
     throw exRequestUnfinished();
 
+  QMutexLocker _( &dataMutex );
+
+  if ( !segments.empty() ) {
+    vector< char > full;
+    full.reserve( segmentEnds.back() + data.size() );
+
+    for ( auto const & segment : segments )
+      full.insert( full.end(), segment.data, segment.data + segment.size );
+
+    full.insert( full.end(), data.begin(), data.end() );
+
+    data = std::move( full );
+    segments.clear();
+    segmentEnds.clear();
+  }
+
   return data;
 }
 
+vector< DataRequest::Segment > DataRequest::getSegments()
+{
+  if ( !isFinished() )
+    throw exRequestUnfinished();
+
+  QMutexLocker _( &dataMutex );
+  sealData();
+
+  return segments;
+}
+
 Class::Class( string const & id_, vector< string > const & dictionaryFiles_ ):
   id( id_ ),
   dictionaryFiles( dictionaryFiles_ ),
@@ -266,7 +384,15 @@ bool Class::loadIconFromFile( QString const & _filename, bool isFullName )
   }
 
   if ( info.isFile() ) {
-    QImage img( fileName );
+    QString const source = info.absoluteFilePath() + '@' + QString::number( info.lastModified().toMSecsSinceEpoch() );
+
+    QImage img;
+    if ( IconCache::find( id, source, img ) ) {
+      dictionaryIcon = QIcon( QPixmap::fromImage( img ) );
+      return true;
+    }
+
+    img.load( fileName );
 
     if ( !img.isNull() ) {
       // Load successful
@@ -292,6 +418,8 @@ bool Class::loadIconFromFile( QString const & _filename, bool isFullName )
 
       painter.end();
 
+      IconCache::store( id, source, result );
+
       dictionaryIcon = QIcon( QPixmap::fromImage( result ) );
 
       return !dictionaryIcon.isNull();
@@ -304,7 +432,16 @@ bool Class::loadIconFromText( QString iconUrl, QString const & text )
 {
   if ( text.isEmpty() )
     return false;
-  QImage img( iconUrl );
+
+  QString const source = iconUrl + '\n' + text;
+
+  QImage img;
+  if ( IconCache::find( id, source, img ) ) {
+    dictionaryIcon = QIcon( QPixmap::fromImage( img ) );
+    return true;
+  }
+
+  img.load( iconUrl );
 
   if ( !img.isNull() ) {
     int iconSize = 64;
@@ -337,6 +474,8 @@ bool Class::loadIconFromText( QString iconUrl, QString const & text )
 
     painter.end();
 
+    IconCache::store( id, source, result );
+
     dictionaryIcon = QIcon( QPixmap::fromImage( result ) );
 
     return !dictionaryIcon.isNull();
@@ -576,8 +715,13 @@ bool needToRebuildIndex( vector< string > const & dictionaryFiles, string const
 
   QFileInfo fileInfo( indexFile.c_str() );
 
-  if ( !fileInfo.exists() )
+  if ( !fileInfo.exists() ) {
+    IndexPack::Segment segment;
+    if ( IndexPack::findSegment( indexFile, segment ) )
+      return segment.lastModified < (qint64)lastModified;
+
     return true;
+  }
 
   return fileInfo.lastModified().toSecsSinceEpoch() < lastModified;
 }
@@ -5,6 +5,7 @@
 #define __DICTIONARY_HH_INCLUDED__
 
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -210,17 +211,38 @@ public:
   /// the resource wasn't found.
   long dataSize();
 
+  /// A part of the data. It's never changed once added, so it can be read
+  /// without locking for as long as it's held.
+  struct Segment
+  {
+    std::shared_ptr< void const > owner;
+    char const * data;
+    size_t size;
+  };
+
   void appendDataSlice( const void * buffer, size_t size );
   void appendString( std::string_view str );
 
+  /// Takes the string over as is, without copying it.
+  void appendString( std::string && str );
+
+  /// Appends the segments of some other request, sharing them.
+  void appendSegments( vector< Segment > const & );
+
   /// Writes "size" bytes starting from "offset" of the data read to the given
-  /// buffer. "size + offset" must be <= than dataSize().
+  /// buffer. "size + offset" must be <= than dataSize(). The segments are
+  /// copied from after the mutex is released.
   void getDataSlice( size_t offset, size_t size, void * buffer );
 
   /// Returns all the data read. Since no further locking can or would be
-  /// done, this can only be called after the request has finished.
+  /// done, this can only be called after the request has finished. The data
+  /// held in segments is joined into one piece first.
   vector< char > & getFullData();
 
+  /// Returns all the data read, as segments to be read without copying. Can
+  /// only be called after the request has finished.
+  vector< Segment > getSegments();
+
   DataRequest( QObject * parent = 0 ):
     Request( parent ),
     hasAnyData( false )
@@ -231,7 +253,21 @@ signals:
 
 protected:
   bool hasAnyData; // With this being false, dataSize() always returns -1
+
+  /// The data goes after the segments. Whatever is in it is turned into a
+  /// segment of its own as soon as a segment is appended.
   vector< char > data;
+
+private:
+
+  /// Makes a segment out of the data, so it could be followed by some other
+  /// segment. The mutex must be held.
+  void sealData();
+
+  void addSegment( Segment const & );
+
+  vector< Segment > segments;
+  vector< size_t > segmentEnds; // Offset of each segment's end
 };
 
 /// A helper class for synchronous word search implementations.
@@ -347,6 +383,17 @@ public:
   /// The default implementation does nothing.
   virtual void deferredInit();
 
+  /// Prefetches the data the first lookups are going to need, such as the
+  /// upper levels of the index, in background. Not more than 'ioBudget'
+  /// bytes should be read or requested; the budget is to be decreased by the
+  /// amount used. The operation should stop as soon as isCancelled is set.
+  /// The default implementation does nothing.
+  virtual void warmUp( qint64 & ioBudget, QAtomicInt & isCancelled )
+  {
+    Q_UNUSED( ioBudget )
+    Q_UNUSED( isCancelled )
+  }
+
   /// Returns the dictionary's id.
   string getId() noexcept
   {
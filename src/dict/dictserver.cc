@@ -650,7 +650,7 @@ public:
 
 
       if ( !articleData.empty() ) {
-        appendString( articleData );
+        appendString( std::move( articleData ) );
         articleData.clear();
 
         hasAnyData = true;
@@ -19,6 +19,7 @@
 #include "gddebug.hh"
 #include "tiff.hh"
 #include "ftshelpers.hh"
+#include "startupprofile.hh"
 
 #include <map>
 #include <set>
@@ -252,6 +253,12 @@ protected:
 private:
 
   string const & ensureInitDone() override;
+
+  bool isInitDone() override
+  {
+    return Utils::AtomicInt::loadAcquire( deferredInitDone );
+  }
+
   void doDeferredInit();
 
   /// Loads the article. Does not process the DSL language.
@@ -368,6 +375,8 @@ void DslDictionary::doDeferredInit()
     if ( Utils::AtomicInt::loadAcquire( deferredInitDone ) )
       return;
 
+    StartupProfile::Phase phase( QString::fromUtf8( getName().c_str() ), StartupProfile::Phase::InBackground );
+
     // Do deferred init
 
     try {
@@ -1489,7 +1498,7 @@ void DslArticleRequest::run()
         string( "<span class=\"dsl_article\">" ) + QObject::tr( "Article loading error" ).toStdString() + "</span>";
     }
 
-    appendString( articleText );
+    appendString( std::move( articleText ) );
 
     hasAnyData = true;
   }
@@ -742,7 +742,7 @@ void EpwingArticleRequest::run()
 
   result += "</div>";
 
-  appendString( result );
+  appendString( std::move( result ) );
 
   hasAnyData = true;
 
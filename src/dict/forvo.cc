@@ -306,7 +306,7 @@ void ForvoArticleRequest::requestFinished( QNetworkReply * r )
 
             articleBody += "</table>";
 
-            appendString( articleBody );
+            appendString( std::move( articleBody ) );
 
             hasAnyData = true;
 
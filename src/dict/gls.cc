@@ -7,6 +7,7 @@
 #include "dictionary.hh"
 #include "ufile.hh"
 #include "btreeidx.hh"
+#include "articleassembler.hh"
 #include "folding.hh"
 #include "gddebug.hh"
 #include "utf8.hh"
@@ -882,7 +883,9 @@ sptr< Dictionary::WordSearchRequest > GlsDictionary::findHeadwordsForSynonym( ws
 
 /// GlsDictionary::getArticle()
 
-class GlsArticleRequest: public Dictionary::DataRequest
+class GlsArticleRequest:
+  public Dictionary::DataRequest,
+  public ArticleAssembler::Assembler< GlsArticleRequest >
 {
 
   wstring word;
@@ -911,6 +914,10 @@ public:
 
   void run();
 
+  bool loadArticle( WordArticleLink const &, ArticleAssembler::Article & );
+
+  void appendArticle( string & out, ArticleAssembler::Article const & );
+
   void cancel() override
   {
     isCancelled.ref();
@@ -929,81 +936,15 @@ void GlsArticleRequest::run()
     finish();
     return;
   }
-  try {
-    vector< WordArticleLink > chain = dict.findArticles( word, ignoreDiacritics );
-
-    for ( const auto & alt : alts ) {
-      /// Make an additional query for each alt
-
-      vector< WordArticleLink > altChain = dict.findArticles( alt, ignoreDiacritics );
-
-      chain.insert( chain.end(), altChain.begin(), altChain.end() );
-    }
-
-    multimap< wstring, pair< string, string > > mainArticles, alternateArticles;
-
-    set< uint32_t > articlesIncluded; // Some synonims make it that the articles
-                                      // appear several times. We combat this
-                                      // by only allowing them to appear once.
-
-    wstring wordCaseFolded = Folding::applySimpleCaseOnly( word );
-    if ( ignoreDiacritics )
-      wordCaseFolded = Folding::applyDiacriticsOnly( wordCaseFolded );
-
-    for ( auto & x : chain ) {
-      if ( Utils::AtomicInt::loadAcquire( isCancelled ) ) {
-        finish();
-        return;
-      }
-
-      if ( articlesIncluded.find( x.articleOffset ) != articlesIncluded.end() )
-        continue; // We already have this article in the body.
-
-      // Now grab that article
-
-      string headword, articleText;
-
-      dict.loadArticle( x.articleOffset, headword, articleText );
-
-      // Ok. Now, does it go to main articles, or to alternate ones? We list
-      // main ones first, and alternates after.
-
-      // We do the case-folded comparison here.
-
-      wstring headwordStripped = Folding::applySimpleCaseOnly( Utf8::decode( headword ) );
-      if ( ignoreDiacritics )
-        headwordStripped = Folding::applyDiacriticsOnly( headwordStripped );
-
-      multimap< wstring, pair< string, string > > & mapToUse =
-        ( wordCaseFolded == headwordStripped ) ? mainArticles : alternateArticles;
-
-      mapToUse.insert(
-        pair( Folding::applySimpleCaseOnly( Utf8::decode( headword ) ), pair( headword, articleText ) ) );
-
-      articlesIncluded.insert( x.articleOffset );
-    }
-
-    if ( mainArticles.empty() && alternateArticles.empty() ) {
-      // No such word
-      finish();
-      return;
-    }
 
+  try {
     string result;
 
-    multimap< wstring, pair< string, string > >::const_iterator i;
-
-    for ( i = mainArticles.begin(); i != mainArticles.end(); ++i ) {
-      result += i->second.second;
-    }
+    if ( assemble( dict, word, alts, ignoreDiacritics, isCancelled, result ) ) {
+      appendString( std::move( result ) );
 
-    for ( i = alternateArticles.begin(); i != alternateArticles.end(); ++i ) {
-      result += i->second.second;
+      hasAnyData = true;
     }
-
-    appendString( result );
-
-    hasAnyData = true;
   }
   catch ( std::exception & e ) {
     setErrorString( QString::fromUtf8( e.what() ) );
@@ -1012,6 +953,17 @@ void GlsArticleRequest::run()
   finish();
 }
 
+bool GlsArticleRequest::loadArticle( WordArticleLink const & link, ArticleAssembler::Article & article )
+{
+  dict.loadArticle( link.articleOffset, article.headword, article.text );
+  return true;
+}
+
+void GlsArticleRequest::appendArticle( string & out, ArticleAssembler::Article const & article )
+{
+  out += article.text;
+}
+
 sptr< Dictionary::DataRequest > GlsDictionary::getArticle( wstring const & word,
                                                            vector< wstring > const & alts,
                                                            wstring const &,
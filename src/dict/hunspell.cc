@@ -276,7 +276,7 @@ void HunspellArticleRequest::run()
 
       result += "</div>";
 
-      appendString( result );
+      appendString( std::move( result ) );
 
       hasAnyData = true;
     }
@@ -0,0 +1,276 @@
+/* This file is part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
+
+#include "iconcache.hh"
+#include "memorybudget.hh"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QPainter>
+#include <QSaveFile>
+
+namespace IconCache {
+
+namespace {
+
+enum {
+  Signature            = 0x43494447, // GDIC on little-endian machines
+  CurrentFormatVersion = 1,
+  CellsPerRow          = 16,
+  MaxCells             = 4096 // Stale icons are dropped beyond that
+};
+
+struct Cell
+{
+  QString source;
+  int index = 0;
+  bool used = false; // Looked up or stored during this run
+};
+
+QMutex cacheMutex;
+bool loaded   = false;
+bool dirty    = false;
+bool released = false; // Dropped from memory to keep within the budget
+int budgetId  = 0;
+QString cacheFileName;
+QHash< QString, Cell > cells;
+QImage atlas;
+int cellCount = 0;
+
+QRect cellRect( int index )
+{
+  return QRect( ( index % CellsPerRow ) * CellSize, ( index / CellsPerRow ) * CellSize, CellSize, CellSize );
+}
+
+/// Gives a cell to a new icon, growing the atlas if needed.
+int allocateCell()
+{
+  int const index = cellCount++;
+  int const rows  = ( cellCount + CellsPerRow - 1 ) / CellsPerRow;
+
+  if ( atlas.height() < rows * CellSize ) {
+    // Grow by doubling to keep the number of copies low
+    QImage grown( CellsPerRow * CellSize, qMax( rows, atlas.height() / CellSize * 2 ) * CellSize,
+                  QImage::Format_ARGB32_Premultiplied );
+    grown.fill( Qt::transparent );
+
+    if ( !atlas.isNull() ) {
+      QPainter painter( &grown );
+      painter.setCompositionMode( QPainter::CompositionMode_Source );
+      painter.drawImage( 0, 0, atlas );
+    }
+
+    atlas = grown;
+  }
+
+  return index;
+}
+
+/// Drops the cells not used during this run, packing the rest together.
+void compact()
+{
+  QHash< QString, Cell > kept;
+  QImage packed;
+
+  std::swap( packed, atlas );
+  cellCount = 0;
+
+  for ( auto i = cells.constBegin(); i != cells.constEnd(); ++i ) {
+    if ( !i->used )
+      continue;
+
+    Cell cell  = *i;
+    cell.index = allocateCell();
+
+    QPainter painter( &atlas );
+    painter.setCompositionMode( QPainter::CompositionMode_Source );
+    painter.drawImage( cellRect( cell.index ).topLeft(), packed, cellRect( i->index ) );
+
+    kept.insert( i.key(), cell );
+  }
+
+  cells.swap( kept );
+}
+
+/// Reads the atlas from the cache file. Must be called with the mutex held.
+void readAtlas()
+{
+  QFile file( cacheFileName );
+  if ( !file.open( QFile::ReadOnly ) )
+    return;
+
+  // The whole atlas is read at once
+  QByteArray const data = file.readAll();
+  QDataStream in( data );
+
+  quint32 signature, version, count;
+  in >> signature >> version >> count;
+
+  if ( in.status() != QDataStream::Ok || signature != Signature || version != CurrentFormatVersion )
+    return;
+
+  QHash< QString, Cell > readCells;
+
+  int readCellCount = 0;
+
+  for ( quint32 x = 0; x < count; ++x ) {
+    QString dictId;
+    Cell cell;
+    qint32 index;
+
+    in >> dictId >> cell.source >> index;
+    cell.index    = index;
+    readCellCount = qMax( readCellCount, index + 1 );
+
+    readCells.insert( dictId, cell );
+  }
+
+  QImage readImage;
+  in >> readImage;
+
+  if ( in.status() != QDataStream::Ok || readImage.width() != CellsPerRow * CellSize
+       || ( readCellCount && cellRect( readCellCount - 1 ).bottom() >= readImage.height() ) ) {
+    qWarning() << "Icon cache" << cacheFileName << "is damaged, ignoring it";
+    return;
+  }
+
+  atlas = readImage.convertToFormat( QImage::Format_ARGB32_Premultiplied );
+  cells.swap( readCells );
+  cellCount = readCellCount;
+
+  MemoryBudget::setUsage( budgetId, atlas.sizeInBytes() );
+}
+
+/// Brings the atlas back if it was released. Must be called with the mutex held.
+void reacquire()
+{
+  if ( !released )
+    return;
+
+  released = false;
+  readAtlas();
+}
+
+/// Drops the atlas from memory when the memory budget is exceeded. It is read
+/// again the next time it's needed.
+qint64 release( qint64 )
+{
+  save();
+
+  QMutexLocker _( &cacheMutex );
+
+  if ( dirty || released || atlas.isNull() )
+    return 0; // Couldn't be saved, or nothing to free
+
+  qint64 const freed = atlas.sizeInBytes();
+
+  atlas = QImage();
+  cells.clear();
+  cellCount = 0;
+  released  = true;
+
+  MemoryBudget::setUsage( budgetId, 0 );
+
+  return freed;
+}
+
+} // namespace
+
+void load( QString const & fileName )
+{
+  QMutexLocker _( &cacheMutex );
+
+  if ( loaded )
+    return;
+
+  loaded        = true;
+  cacheFileName = fileName;
+  budgetId      = MemoryBudget::registerCache( "Dictionary icons", 1, release );
+
+  readAtlas();
+}
+
+void save()
+{
+  QMutexLocker _( &cacheMutex );
+
+  if ( !dirty || cacheFileName.isEmpty() )
+    return;
+
+  if ( cellCount > MaxCells )
+    compact();
+
+  QDir().mkpath( QFileInfo( cacheFileName ).path() );
+
+  QSaveFile file( cacheFileName );
+  if ( !file.open( QFile::WriteOnly ) )
+    return;
+
+  QDataStream out( &file );
+  out << (quint32)Signature << (quint32)CurrentFormatVersion << (quint32)cells.size();
+
+  for ( auto i = cells.constBegin(); i != cells.constEnd(); ++i )
+    out << i.key() << i->source << (qint32)i->index;
+
+  // Only the rows in use are written
+  out << atlas.copy( 0, 0, atlas.width(), ( cellCount + CellsPerRow - 1 ) / CellsPerRow * CellSize );
+
+  if ( file.commit() )
+    dirty = false;
+}
+
+bool find( std::string const & dictId, QString const & source, QImage & icon )
+{
+  QMutexLocker _( &cacheMutex );
+
+  reacquire();
+
+  auto i = cells.find( QString::fromStdString( dictId ) );
+  if ( i == cells.end() || i->source != source )
+    return false;
+
+  i->used = true;
+  icon    = atlas.copy( cellRect( i->index ) );
+
+  return true;
+}
+
+void store( std::string const & dictId, QString const & source, QImage const & icon )
+{
+  if ( icon.isNull() )
+    return;
+
+  QMutexLocker _( &cacheMutex );
+
+  if ( !loaded )
+    return; // Nowhere to save it anyway
+
+  reacquire();
+
+  QString const key = QString::fromStdString( dictId );
+
+  auto i = cells.find( key );
+  if ( i == cells.end() ) {
+    i        = cells.insert( key, Cell() );
+    i->index = allocateCell();
+  }
+
+  i->source = source;
+  i->used   = true;
+
+  QPainter painter( &atlas );
+  painter.setCompositionMode( QPainter::CompositionMode_Source );
+  painter.setRenderHint( QPainter::SmoothPixmapTransform );
+  painter.drawImage( cellRect( i->index ), icon );
+  painter.end();
+
+  dirty = true;
+
+  MemoryBudget::setUsage( budgetId, atlas.sizeInBytes() );
+}
+
+} // namespace IconCache
@@ -0,0 +1,37 @@
+/* This file is part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
+
+#ifndef __ICONCACHE_HH_INCLUDED__
+#define __ICONCACHE_HH_INCLUDED__
+
+#include <QImage>
+#include <QString>
+#include <string>
+
+/// A persistent cache of the dictionaries' icons in their final form, i.e.
+/// already scaled, color-keyed and made square. All of them are kept as cells
+/// of a single atlas image in the cache dir, which is read and decoded once at
+/// startup, so showing hundreds of dictionaries doesn't decode hundreds of
+/// image files.
+namespace IconCache {
+
+/// The size of the atlas cells. Cached icons are scaled to it.
+int const CellSize = 64;
+
+/// Reads the atlas from the given file. Only the first call does anything.
+void load( QString const & fileName );
+
+/// Writes the atlas back if anything was added to it since it was loaded.
+void save();
+
+/// Looks up the icon of the given dictionary. The source describes where the
+/// icon comes from, e.g. the file name and its modification time; a cell made
+/// from a different source is not returned.
+bool find( std::string const & dictId, QString const & source, QImage & icon );
+
+/// Puts the icon of the given dictionary into the atlas, replacing its
+/// previous one if any.
+void store( std::string const & dictId, QString const & source, QImage const & icon );
+
+} // namespace IconCache
+
+#endif
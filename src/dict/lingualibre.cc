@@ -367,7 +367,7 @@ void LinguaArticleRequest::requestFinished( QNetworkReply * r )
 
     articleBody += "</p>";
 
-    appendString( articleBody );
+    appendString( std::move( articleBody ) );
 
 
     hasAnyData = true;
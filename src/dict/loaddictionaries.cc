@@ -33,6 +33,8 @@
 #include "dict/gls.hh"
 #include "dict/lingualibre.hh"
 #include "metadata.hh"
+#include "indexpack.hh"
+#include "iconcache.hh"
 
 #ifndef NO_EPWING_SUPPORT
   #include "dict/epwing.hh"
@@ -94,11 +96,13 @@ void LoadDictionaries::run()
   try {
     for ( const auto & path : paths ) {
       qDebug() << "handle path:" << path.path;
+      StartupProfile::Phase phase( "Path " + path.path );
       handlePath( path );
     }
 
     // Make soundDirs
     {
+      StartupProfile::Phase phase( "Sound directories" );
       vector< sptr< Dictionary::Class > > soundDirDictionaries =
         SoundDir::makeDictionaries( soundDirs, Config::getIndexDir().toStdString(), *this );
 
@@ -107,12 +111,14 @@ void LoadDictionaries::run()
 
     // Make hunspells
     {
+      StartupProfile::Phase phase( "Hunspell" );
       vector< sptr< Dictionary::Class > > hunspellDictionaries = HunspellMorpho::makeDictionaries( hunspell );
 
       dictionaries.insert( dictionaries.end(), hunspellDictionaries.begin(), hunspellDictionaries.end() );
     }
 
     //handle the custom dictionary name&fts option
+    StartupProfile::Phase metadataPhase( "Metadata" );
     for ( const auto & dict : dictionaries ) {
       auto baseDir = dict->getContainingFolder();
       if ( baseDir.isEmpty() )
@@ -132,6 +138,7 @@ void LoadDictionaries::run()
     exceptionText.clear();
   }
   catch ( std::exception & e ) {
+    dictionaryPhase.reset();
     exceptionText = e.what();
   }
 }
@@ -141,6 +148,22 @@ void LoadDictionaries::addDicts( const std::vector< sptr< Dictionary::Class > >
   std::move( dicts.begin(), dicts.end(), std::back_inserter( dictionaries ) );
 }
 
+template< class Make >
+void LoadDictionaries::addFormat( char const * format, Make const & make )
+{
+  StartupProfile::Phase phase( format );
+
+  vector< sptr< Dictionary::Class > > dicts = make();
+
+  dictionaryPhase.reset();
+
+  // Most formats find nothing in a folder, which isn't worth a mention
+  if ( dicts.empty() )
+    phase.drop();
+
+  addDicts( dicts );
+}
+
 void LoadDictionaries::handlePath( Config::Path const & path )
 {
   vector< string > allFiles;
@@ -163,34 +186,72 @@ void LoadDictionaries::handlePath( Config::Path const & path )
       allFiles.push_back( QDir::toNativeSeparators( fullName ).toStdString() );
   }
 
-  addDicts( Bgl::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this ) );
-  addDicts( Stardict::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this, maxHeadwordToExpand ) );
-  addDicts( Lsa::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this ) );
-  addDicts( Dsl::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this, maxHeadwordSize ) );
-  addDicts( DictdFiles::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this ) );
-  addDicts( Xdxf::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this ) );
-  addDicts( Sdict::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this ) );
-  addDicts( Aard::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this, maxHeadwordToExpand ) );
-  addDicts( ZipSounds::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this ) );
-  addDicts( Mdx::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this ) );
-  addDicts( Gls::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this ) );
-  addDicts( Slob::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this, maxHeadwordToExpand ) );
+  addFormat( "Bgl", [ & ] {
+    return Bgl::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this );
+  } );
+  addFormat( "Stardict", [ & ] {
+    return Stardict::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this, maxHeadwordToExpand );
+  } );
+  addFormat( "Lsa", [ & ] {
+    return Lsa::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this );
+  } );
+  addFormat( "Dsl", [ & ] {
+    return Dsl::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this, maxHeadwordSize );
+  } );
+  addFormat( "DictdFiles", [ & ] {
+    return DictdFiles::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this );
+  } );
+  addFormat( "Xdxf", [ & ] {
+    return Xdxf::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this );
+  } );
+  addFormat( "Sdict", [ & ] {
+    return Sdict::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this );
+  } );
+  addFormat( "Aard", [ & ] {
+    return Aard::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this, maxHeadwordToExpand );
+  } );
+  addFormat( "ZipSounds", [ & ] {
+    return ZipSounds::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this );
+  } );
+  addFormat( "Mdx", [ & ] {
+    return Mdx::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this );
+  } );
+  addFormat( "Gls", [ & ] {
+    return Gls::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this );
+  } );
+  addFormat( "Slob", [ & ] {
+    return Slob::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this, maxHeadwordToExpand );
+  } );
 #ifdef MAKE_ZIM_SUPPORT
-  addDicts( Zim::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this, maxHeadwordToExpand ) );
+  addFormat( "Zim", [ & ] {
+    return Zim::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this, maxHeadwordToExpand );
+  } );
 #endif
 #ifndef NO_EPWING_SUPPORT
-  addDicts( Epwing::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this ) );
+  addFormat( "Epwing", [ & ] {
+    return Epwing::makeDictionaries( allFiles, Config::getIndexDir().toStdString(), *this );
+  } );
 #endif
 }
 
 void LoadDictionaries::indexingDictionary( string const & dictionaryName ) noexcept
 {
-  emit indexingDictionarySignal( QString::fromUtf8( dictionaryName.c_str() ) );
+  QString const name = QString::fromUtf8( dictionaryName.c_str() );
+
+  dictionaryPhase.reset();
+  dictionaryPhase.emplace( "Indexing " + name );
+
+  emit indexingDictionarySignal( name );
 }
 
 void LoadDictionaries::loadingDictionary( string const & dictionaryName ) noexcept
 {
-  emit loadingDictionarySignal( QString::fromUtf8( dictionaryName.c_str() ) );
+  QString const name = QString::fromUtf8( dictionaryName.c_str() );
+
+  dictionaryPhase.reset();
+  dictionaryPhase.emplace( "Loading " + name );
+
+  emit loadingDictionarySignal( name );
 }
 
 
@@ -203,6 +264,16 @@ void loadDictionaries( QWidget * parent,
 {
   dictionaries.clear();
 
+  QString sharedIndexDir = cfg.preferences.sharedIndexDir;
+  if ( sharedIndexDir.isEmpty() )
+    sharedIndexDir = qEnvironmentVariable( "GOLDENDICT_SHARED_INDEX_DIR" );
+
+  // An existing pack is always used, so turning the option off doesn't
+  // force a reindex; new indexes just stay standalone then.
+  IndexPack::init( Config::getIndexDir(), cfg.preferences.packedIndexStore, sharedIndexDir );
+
+  IconCache::load( Config::getCacheDir() + "/dict_icons.cache" );
+
   ::Initializing init( parent, showInitially );
 
   // Start a thread to load all the dictionaries
@@ -240,6 +311,8 @@ void loadDictionaries( QWidget * parent,
 
   ///// We create transliterations synchronously since they are very simple
 
+  StartupProfile::Phase othersPhase( "Transliterations and online sources" );
+
 #ifdef MAKE_CHINESE_CONVERSION_SUPPORT
   addDicts( Chinese::makeDictionaries( cfg.transliteration.chinese ) );
 #endif
@@ -274,6 +347,8 @@ void loadDictionaries( QWidget * parent,
 #endif
   addDicts( DictServer::makeDictionaries( cfg.dictServers ) );
 
+  othersPhase.end();
+
 
   GD_DPRINTF( "Load done\n" );
 
@@ -302,6 +377,10 @@ void loadDictionaries( QWidget * parent,
 
 void doDeferredInit( std::vector< sptr< Dictionary::Class > > & dictionaries )
 {
+  // The formats with a deferred init only queue it here, each job times
+  // itself as a background phase
+  StartupProfile::Phase phase( "Deferred init" );
+
   for ( const auto & dictionarie : dictionaries )
     dictionarie->deferredInit();
 }
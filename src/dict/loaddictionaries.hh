@@ -7,9 +7,11 @@
 #include "initializing.hh"
 #include "config.hh"
 #include "dict/dictionary.hh"
+#include "startupprofile.hh"
 
 #include <QThread>
 #include <QNetworkAccessManager>
+#include <optional>
 
 /// Use loadDictionaries() function below -- this is a helper thread class
 class LoadDictionaries: public QThread, public Dictionary::Initializing
@@ -26,6 +28,10 @@ class LoadDictionaries: public QThread, public Dictionary::Initializing
   unsigned int maxHeadwordSize;
   unsigned int maxHeadwordToExpand;
 
+  /// Times the dictionary being loaded or indexed, from the moment the
+  /// format's code tells which one it is
+  std::optional< StartupProfile::Phase > dictionaryPhase;
+
 public:
 
   LoadDictionaries( Config::Class const & cfg );
@@ -56,6 +62,10 @@ private:
   // Helper function that will add a vector of dictionary::Class to the dictionary list
   void addDicts( const std::vector< sptr< Dictionary::Class > > & dicts );
 
+  /// Adds the dictionaries of the format the function makes, timing it
+  template< class Make >
+  void addFormat( char const * format, Make const & make );
+
 signals:
   void indexingDictionarySignal( QString const & dictionaryName );
   void loadingDictionarySignal( QString const & dictionaryName );
@@ -17,6 +17,7 @@
 #include "mdictparser.hh"
 #include "filetype.hh"
 #include "ftshelpers.hh"
+#include "startupprofile.hh"
 #include "htmlescape.hh"
 
 #include <algorithm>
@@ -274,6 +275,12 @@ protected:
 private:
 
   string const & ensureInitDone() override;
+
+  bool isInitDone() override
+  {
+    return Utils::AtomicInt::loadAcquire( deferredInitDone );
+  }
+
   void doDeferredInit();
 
   /// Loads an article with the given offset, filling the given strings.
@@ -371,6 +378,8 @@ void MdxDictionary::doDeferredInit()
     if ( Utils::AtomicInt::loadAcquire( deferredInitDone ) )
       return;
 
+    StartupProfile::Phase phase( QString::fromUtf8( getName().c_str() ), StartupProfile::Phase::InBackground );
+
     // Do deferred init
 
     try {
@@ -11,8 +11,11 @@
 #include "utils.hh"
 #include "globalbroadcaster.hh"
 
+#include <QCoreApplication>
 #include <QDir>
 #include <QFileInfo>
+#include <QHash>
+#include <QSet>
 
 namespace Programs {
 
@@ -20,6 +23,17 @@ using namespace Dictionary;
 
 namespace {
 
+/// The servers of each program in the server mode, keyed by serverKey(). They
+/// are kept until the program is changed, disabled or removed.
+QHash< QString, QList< ProgramServer * > > servers;
+
+/// Having the command line in the key too makes editing the program get it a
+/// fresh set of servers.
+QString serverKey( Config::Program const & prg )
+{
+  return prg.id + '\n' + prg.commandLine;
+}
+
 class ProgramsDictionary: public Dictionary::Class
 {
   Config::Program prg;
@@ -102,7 +116,7 @@ ProgramsDictionary::getArticle( wstring const & word, vector< wstring > const &,
       result += "</tr></table>";
 
       auto ret = std::make_shared< DataRequestInstant >( true );
-      ret->appendString( result );
+      ret->appendString( std::move( result ) );
       return ret;
     }
 
@@ -142,6 +156,9 @@ RunInstance::RunInstance():
 
 bool RunInstance::start( Config::Program const & prg, QString const & word, QString & error )
 {
+  if ( prg.server )
+    return ProgramServer::query( prg, word, this, error );
+
   QStringList args = parseCommandLine( prg.commandLine );
 
   if ( !args.empty() ) {
@@ -201,6 +218,220 @@ void RunInstance::handleProcessFinished()
   emit finished( output, error );
 }
 
+bool ProgramServer::query( Config::Program const & prg, QString const & word, RunInstance * instance, QString & error )
+{
+  QStringList commandLine = parseCommandLine( prg.commandLine );
+  if ( commandLine.empty() ) {
+    error = RunInstance::tr( "No program name was given." );
+    return false;
+  }
+
+  QList< ProgramServer * > & pool = servers[ serverKey( prg ) ];
+
+  ProgramServer * server = nullptr;
+  for ( auto * candidate : pool )
+    if ( !server || candidate->queries.size() < server->queries.size() )
+      server = candidate;
+
+  if ( !server || ( !server->queries.isEmpty() && pool.size() < MaxServers ) ) {
+    server = new ProgramServer( commandLine, QCoreApplication::instance() );
+    pool.append( server );
+  }
+
+  server->queries.enqueue( { word, instance } );
+  server->sendQuery();
+
+  return true;
+}
+
+void ProgramServer::dropUnused( Config::Programs const & programs )
+{
+  QSet< QString > used;
+  for ( auto const & program : programs )
+    if ( program.enabled && program.server )
+      used.insert( serverKey( program ) );
+
+  for ( auto i = servers.begin(); i != servers.end(); ) {
+    if ( used.contains( i.key() ) ) {
+      ++i;
+      continue;
+    }
+
+    for ( auto * server : i.value() )
+      server->shutDown();
+
+    i = servers.erase( i );
+  }
+}
+
+ProgramServer::ProgramServer( QStringList const & commandLine_, QObject * parent ):
+  QObject( parent ),
+  commandLine( commandLine_ ),
+  process( this ),
+  queryInFlight( false )
+{
+  timeout.setSingleShot( true );
+  timeout.setInterval( QueryTimeout );
+
+  connect( &process, &QProcess::readyReadStandardOutput, this, &ProgramServer::readOutput );
+  connect( &process, &QProcess::finished, this, [ this ]() {
+    fail( RunInstance::tr( "The program has exited unexpectedly." ) );
+  } );
+  connect( &process, &QProcess::errorOccurred, this, [ this ]( QProcess::ProcessError error ) {
+    // Other errors are followed by finished()
+    if ( error == QProcess::FailedToStart )
+      fail( RunInstance::tr( "The program could not be started." ) );
+  } );
+  connect( &timeout, &QTimer::timeout, this, [ this ]() {
+    fail( RunInstance::tr( "The program has not answered in time." ) );
+  } );
+}
+
+void ProgramServer::sendQuery()
+{
+  if ( queryInFlight )
+    return;
+
+  // Drop the queries of the lookups which are gone by now
+  while ( !queries.isEmpty() && queries.head().instance.isNull() )
+    queries.dequeue();
+
+  if ( queries.isEmpty() )
+    return;
+
+  queryInFlight = true;
+
+  if ( process.state() == QProcess::NotRunning ) {
+    output.clear();
+    // The word is passed through stdin only, so %GDWORD% and the like are
+    // left as they are.
+    process.start( commandLine.first(), commandLine.mid( 1 ) );
+
+    if ( !queryInFlight )
+      return; // Failed to start right away
+  }
+
+  QString word = queries.head().word;
+  word.replace( '\n', ' ' );
+
+  process.write( word.toLocal8Bit() + '\n' );
+  timeout.start();
+}
+
+bool ProgramServer::takeAnswer( QByteArray & answer )
+{
+  static QByteArray const lengthHeader( "Content-Length:" );
+
+  if ( output.startsWith( lengthHeader ) ) {
+    auto headerEnd = output.indexOf( '\n' );
+    if ( headerEnd < 0 )
+      return false;
+
+    bool ok;
+    qsizetype length = output.mid( lengthHeader.size(), headerEnd - lengthHeader.size() ).trimmed().toLongLong( &ok );
+    if ( !ok || length < 0 ) {
+      fail( RunInstance::tr( "The program has given an invalid answer." ) );
+      return false;
+    }
+
+    if ( output.size() - headerEnd - 1 < length )
+      return false;
+
+    answer = output.mid( headerEnd + 1, length );
+    output.remove( 0, headerEnd + 1 + length );
+    return true;
+  }
+
+  if ( lengthHeader.startsWith( output ) )
+    return false; // Could still turn out to be the header
+
+  // Otherwise the answer lasts until an empty line
+  for ( qsizetype lineStart = 0;; ) {
+    auto lineEnd = output.indexOf( '\n', lineStart );
+    if ( lineEnd < 0 )
+      return false;
+
+    if ( lineEnd == lineStart || ( lineEnd == lineStart + 1 && output[ lineStart ] == '\r' ) ) {
+      answer = output.left( lineStart );
+      output.remove( 0, lineEnd + 1 );
+      return true;
+    }
+
+    lineStart = lineEnd + 1;
+  }
+}
+
+void ProgramServer::readOutput()
+{
+  output += process.readAllStandardOutput();
+
+  if ( !queryInFlight ) {
+    output.clear(); // Nobody asked for that
+    return;
+  }
+
+  QByteArray result;
+  if ( takeAnswer( result ) )
+    answer( result, QString() );
+}
+
+void ProgramServer::answer( QByteArray const & result, QString const & error )
+{
+  timeout.stop();
+  queryInFlight = false;
+
+  Query query = queries.dequeue();
+  if ( !query.instance.isNull() )
+    emit query.instance->finished( result, error );
+
+  // Not right away, since this might be called from the process' signals
+  QMetaObject::invokeMethod( this, &ProgramServer::sendQuery, Qt::QueuedConnection );
+}
+
+void ProgramServer::fail( QString const & error )
+{
+  if ( process.state() != QProcess::NotRunning ) {
+    // Any further signals would be about the process being killed here
+    process.blockSignals( true );
+    process.kill();
+    process.waitForFinished( 1000 );
+    process.blockSignals( false );
+  }
+
+  QString message = error;
+  QByteArray err  = process.readAllStandardError();
+  if ( !err.isEmpty() )
+    message += "\n\n" + QString::fromLocal8Bit( err );
+
+  output.clear();
+
+  if ( queryInFlight )
+    answer( QByteArray(), message );
+}
+
+void ProgramServer::shutDown()
+{
+  timeout.stop();
+
+  if ( process.state() != QProcess::NotRunning ) {
+    process.blockSignals( true );
+    process.kill();
+    process.waitForFinished( 1000 );
+  }
+
+  queryInFlight = false;
+
+  QString const error = RunInstance::tr( "The program has been changed or disabled." );
+
+  while ( !queries.isEmpty() ) {
+    Query query = queries.dequeue();
+    if ( !query.instance.isNull() )
+      emit query.instance->finished( QByteArray(), error );
+  }
+
+  deleteLater();
+}
+
 ProgramDataRequest::ProgramDataRequest( QString const & word, Config::Program const & prg_ ):
   prg( prg_ )
 {
@@ -342,6 +573,8 @@ vector< sptr< Dictionary::Class > > makeDictionaries( Config::Programs const & p
 {
   vector< sptr< Dictionary::Class > > result;
 
+  ProgramServer::dropUnused( programs );
+
   for ( const auto & program : programs )
     if ( program.enabled )
       result.push_back( std::make_shared< ProgramsDictionary >( program ) );
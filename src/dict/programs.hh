@@ -4,7 +4,10 @@
 #ifndef __PROGRAMS_HH_INCLUDED__
 #define __PROGRAMS_HH_INCLUDED__
 
+#include <QPointer>
 #include <QProcess>
+#include <QQueue>
+#include <QTimer>
 #include "dictionary.hh"
 #include "config.hh"
 #include "wstring.hh"
@@ -44,6 +47,70 @@ private slots:
   void handleProcessFinished();
 };
 
+/// A program running in the server mode (see Config::Program::server). It
+/// gets the words on its standard input, one per line, and answers each one
+/// either with a block of lines ended by an empty line, or with a
+/// "Content-Length: <bytes>" line followed by that many bytes. The queries are
+/// answered in order. Should the program exit or fail to answer in time, the
+/// query fails and the program is restarted for the next one.
+class ProgramServer: public QObject
+{
+  Q_OBJECT
+
+  QStringList commandLine;
+  QProcess process;
+  QByteArray output;
+  QTimer timeout;
+
+  struct Query
+  {
+    QString word;
+    QPointer< RunInstance > instance; // Null once the lookup is gone
+  };
+
+  QQueue< Query > queries;
+  bool queryInFlight;
+
+public:
+
+  /// Queues the word to the least busy server running the given program,
+  /// starting a new one if they are all busy and there are not too many yet.
+  /// The result is emitted by the instance's finished() signal.
+  static bool query( Config::Program const &, QString const & word, RunInstance *, QString & error );
+
+  /// Shuts down the servers of the programs which are no longer among the
+  /// given enabled ones in the server mode, or whose command line has changed.
+  /// Their pending queries fail.
+  static void dropUnused( Config::Programs const & );
+
+private:
+
+  ProgramServer( QStringList const & commandLine, QObject * parent );
+
+  /// Makes sure the program is running and sends it the current query.
+  void sendQuery();
+
+  /// Extracts the complete answer from the output, if there is one.
+  bool takeAnswer( QByteArray & answer );
+
+  /// Completes the current query and proceeds to the next one.
+  void answer( QByteArray const & output, QString const & error );
+
+  /// Fails the current query and kills the program, so the next query would
+  /// start it anew.
+  void fail( QString const & error );
+
+  /// Kills the program, fails all the queries and deletes the server later.
+  void shutDown();
+
+  static int const MaxServers   = 2;
+  static int const QueryTimeout = 20000; // ms, including the program startup
+
+private slots:
+
+  void readOutput();
+};
+
 class ProgramDataRequest: public Dictionary::DataRequest
 {
   Q_OBJECT
@@ -3,6 +3,7 @@
 
 #include "sdict.hh"
 #include "btreeidx.hh"
+#include "articleassembler.hh"
 #include "folding.hh"
 #include "utf8.hh"
 #include "chunkedstorage.hh"
@@ -435,7 +436,9 @@ SdictDictionary::getSearchResults( QString const & searchString, int searchMode,
 /// SdictDictionary::getArticle()
 
 
-class SdictArticleRequest: public Dictionary::DataRequest
+class SdictArticleRequest:
+  public Dictionary::DataRequest,
+  public ArticleAssembler::Assembler< SdictArticleRequest >
 {
 
   wstring word;
@@ -465,6 +468,10 @@ public:
 
   void run();
 
+  bool loadArticle( WordArticleLink const &, ArticleAssembler::Article & );
+
+  void appendArticle( string & out, ArticleAssembler::Article const & );
+
   void cancel() override
   {
     isCancelled.ref();
@@ -484,98 +491,43 @@ void SdictArticleRequest::run()
     return;
   }
 
-  vector< WordArticleLink > chain = dict.findArticles( word, ignoreDiacritics );
-
-  for ( const auto & alt : alts ) {
-    /// Make an additional query for each alt
-
-    vector< WordArticleLink > altChain = dict.findArticles( alt, ignoreDiacritics );
-
-    chain.insert( chain.end(), altChain.begin(), altChain.end() );
-  }
-
-  multimap< wstring, pair< string, string > > mainArticles, alternateArticles;
-
-  set< uint32_t > articlesIncluded; // Some synonims make it that the articles
-                                    // appear several times. We combat this
-                                    // by only allowing them to appear once.
-
-  wstring wordCaseFolded = Folding::applySimpleCaseOnly( word );
-  if ( ignoreDiacritics )
-    wordCaseFolded = Folding::applyDiacriticsOnly( wordCaseFolded );
-
-  for ( auto & x : chain ) {
-    if ( Utils::AtomicInt::loadAcquire( isCancelled ) ) {
-      finish();
-      return;
-    }
-
-    if ( articlesIncluded.find( x.articleOffset ) != articlesIncluded.end() )
-      continue; // We already have this article in the body.
-
-    // Now grab that article
-
-    string headword, articleText;
-
-    headword = x.word;
-
-    try {
-      dict.loadArticle( x.articleOffset, articleText );
-
-      // Ok. Now, does it go to main articles, or to alternate ones? We list
-      // main ones first, and alternates after.
-
-      // We do the case-folded comparison here.
-
-      wstring headwordStripped = Folding::applySimpleCaseOnly( headword );
-      if ( ignoreDiacritics )
-        headwordStripped = Folding::applyDiacriticsOnly( headwordStripped );
-
-      multimap< wstring, pair< string, string > > & mapToUse =
-        ( wordCaseFolded == headwordStripped ) ? mainArticles : alternateArticles;
-
-      mapToUse.insert( pair( Folding::applySimpleCaseOnly( headword ), pair( headword, articleText ) ) );
+  string result;
 
-      articlesIncluded.insert( x.articleOffset );
-    }
-    catch ( std::exception & ex ) {
-      gdWarning( "SDict: Failed loading article from \"%s\", reason: %s\n", dict.getName().c_str(), ex.what() );
-    }
-  }
+  if ( assemble( dict, word, alts, ignoreDiacritics, isCancelled, result ) ) {
+    appendString( std::move( result ) );
 
-  if ( mainArticles.empty() && alternateArticles.empty() ) {
-    // No such word
-    finish();
-    return;
+    hasAnyData = true;
   }
 
-  string result;
-
-  multimap< wstring, pair< string, string > >::const_iterator i;
+  finish();
+}
 
-  for ( i = mainArticles.begin(); i != mainArticles.end(); ++i ) {
-    result += dict.isFromLanguageRTL() ? "<h3 dir=\"rtl\">" : "<h3>";
-    result += i->second.first;
-    result += "</h3>";
-    result += i->second.second;
+bool SdictArticleRequest::loadArticle( WordArticleLink const & link, ArticleAssembler::Article & article )
+{
+  try {
+    dict.loadArticle( link.articleOffset, article.text );
+    return true;
   }
-
-  for ( i = alternateArticles.begin(); i != alternateArticles.end(); ++i ) {
-    result += dict.isFromLanguageRTL() ? "<h3 dir=\"rtl\">" : "<h3>";
-    result += i->second.first;
-    result += "</h3>";
-    if ( dict.isToLanguageRTL() )
-      result += "<span dir=\"rtl\">";
-    result += i->second.second;
-    if ( dict.isToLanguageRTL() )
-      result += "</span>";
+  catch ( std::exception & ex ) {
+    gdWarning( "SDict: Failed loading article from \"%s\", reason: %s\n", dict.getName().c_str(), ex.what() );
+    return false;
   }
+}
 
-  appendString( result );
-
-  hasAnyData = true;
-
-  finish();
+void SdictArticleRequest::appendArticle( string & out, ArticleAssembler::Article const & article )
+{
+  out += dict.isFromLanguageRTL() ? "<h3 dir=\"rtl\">" : "<h3>";
+  out += article.headword;
+  out += "</h3>";
+
+  // Only the alternate articles were ever marked as right-to-left
+  bool const rtl = !article.isMain && dict.isToLanguageRTL();
+
+  if ( rtl )
+    out += "<span dir=\"rtl\">";
+  out += article.text;
+  if ( rtl )
+    out += "</span>";
 }
 
 sptr< Dictionary::DataRequest > SdictDictionary::getArticle( wstring const & word,
@@ -4,6 +4,7 @@
 
 #include "slob.hh"
 #include "btreeidx.hh"
+#include "articleassembler.hh"
 
 #include "folding.hh"
 #include "gddebug.hh"
@@ -13,6 +14,7 @@
 #include "wstring_qt.hh"
 #include "ftshelpers.hh"
 #include "htmlescape.hh"
+#include "htmlrewriter.hh"
 #include "filetype.hh"
 #include "tiff.hh"
 #include "utils.hh"
@@ -781,74 +783,73 @@ void SlobDictionary::loadArticle( quint32 address, string & articleText )
 
 string SlobDictionary::convert( const string & in, RefEntry const & entry )
 {
-  QString text = QString::fromUtf8( in.c_str() );
-
-  // pattern of img and script
-  text.replace( QRegularExpression( "<\\s*(img|script)\\s+([^>]*)src=\"(?!(?:data|https?|ftp):)(|/)([^\"]*)\"" ),
-                QString( R"(<\1 \2src="bres://%1/\4")" ).arg( getId().c_str() ) );
-
-  // pattern <link... href="..." ...>
-  text.replace( QRegularExpression( R"(<\s*link\s+([^>]*)href="(?!(?:data|https?|ftp):))" ),
-                QString( "<link \\1href=\"bres://%1/" ).arg( getId().c_str() ) );
-
-  // pattern <a href="..." ...>, excluding any known protocols such as http://, mailto:, #(comment)
-  // these links will be translated into local definitions
-  QString anchor;
-  QRegularExpression rxLink(
-    R"lit(<\s*a\s+([^>]*)href="(?!(?:\w+://|#|mailto:|tel:))(/|)([^"]*)"\s*(title="[^"]*")?[^>]*>)lit" );
-  QRegularExpressionMatchIterator it = rxLink.globalMatch( text );
-  int pos                            = 0;
-  QString newText;
-  while ( it.hasNext() ) {
-    QRegularExpressionMatch match = it.next();
-
-    newText += text.mid( pos, match.capturedStart() - pos );
-    pos = match.capturedEnd();
-
-    QStringList list = match.capturedTexts();
-    // Add empty strings for compatibility with QRegExp behaviour
-    for ( int i = match.lastCapturedIndex() + 1; i < 5; i++ )
-      list.append( QString() );
-
-    QString tag = list[ 3 ];
-    if ( !list[ 4 ].isEmpty() )
-      tag = list[ 4 ].split( "\"" )[ 1 ];
-
-    // Find anchor
-    int n = list[ 3 ].indexOf( '#' );
-    if ( n > 0 ) {
-      anchor = QString( "?gdanchor=" ) + list[ 3 ].mid( n + 1 );
-      tag.remove( list[ 3 ].mid( n ) );
+  string const resourcePrefix = "bres://" + getId() + "/";
+
+  // All the links are fixed in a single pass over the article
+  string rewritten = Html::rewriteTags( in, [ &resourcePrefix ]( Html::Tag & tag ) {
+    auto isExternal = []( std::string_view url ) {
+      return url.rfind( "data:", 0 ) == 0 || url.rfind( "http:", 0 ) == 0 || url.rfind( "https:", 0 ) == 0
+        || url.rfind( "ftp:", 0 ) == 0;
+    };
+
+    if ( tag.is( "img" ) || tag.is( "script" ) ) {
+      auto src = tag.attribute( "src" );
+      if ( src && !isExternal( *src ) )
+        tag.setAttribute( "src", resourcePrefix + string( src->substr( src->rfind( "/", 0 ) == 0 ? 1 : 0 ) ) );
     }
-    else
-      anchor.clear();
+    else if ( tag.is( "link" ) ) {
+      auto href = tag.attribute( "href" );
+      if ( href && !isExternal( *href ) )
+        tag.setAttribute( "href", resourcePrefix + string( *href ) );
+    }
+    else if ( tag.is( "a" ) ) {
+      // Links without any known protocol, such as http://, mailto:, #(comment),
+      // are translated into local definitions
+      auto href = tag.attribute( "href" );
+      if ( !href || href->rfind( "#", 0 ) == 0 || href->rfind( "mailto:", 0 ) == 0 || href->rfind( "tel:", 0 ) == 0
+           || href->find( "://" ) != std::string_view::npos )
+        return;
+
+      std::string_view link = href->substr( href->rfind( "/", 0 ) == 0 ? 1 : 0 );
+      auto title            = tag.attribute( "title" );
+      string word( title ? *title : link );
+
+      // Find anchor
+      string anchor;
+      size_t n = link.find( '#' );
+      if ( n != std::string_view::npos && n > 0 ) {
+        anchor = "?gdanchor=" + string( link.substr( n + 1 ) );
+        if ( !title )
+          word.resize( n );
+      }
 
-    tag.remove( QRegularExpression( ".*/" ) )
-      .remove( QRegularExpression( "\\.(s|)htm(l|)$", QRegularExpression::PatternOption::CaseInsensitiveOption ) )
-      .replace( "_", "%20" )
-      .prepend( "<a href=\"gdlookup://localhost/" )
-      .append( anchor + "\" " + list[ 4 ] + ">" );
+      // Strip the path and the html extension
+      n = word.rfind( '/' );
+      if ( n != string::npos )
+        word.erase( 0, n + 1 );
 
-    newText += tag;
-  }
-  if ( pos ) {
-    newText += text.mid( pos );
-    text = newText;
-  }
-  newText.clear();
+      QString qword = QString::fromStdString( word );
+      static QRegularExpression const rxHtmlExtension( "\\.(s|)htm(l|)$",
+                                                       QRegularExpression::PatternOption::CaseInsensitiveOption );
+      qword.remove( rxHtmlExtension ).replace( "_", "%20" );
 
+      tag.setAttribute( "href", "gdlookup://localhost/" + qword.toStdString() + anchor );
+    }
+  } );
+
+  QString text = QString::fromStdString( rewritten );
 
   // Handle TeX formulas via mimetex.cgi
 
   if ( !texCgiPath.isEmpty() ) {
-    QRegularExpression texImage( R"lit(<\s*img\s+class="([^"]+)"\s*([^>]*)alt="([^"]+)"[^>]*>)lit" );
-    QRegularExpression regFrac( "\\\\[dt]frac" );
-    QRegularExpression regSpaces( R"(\s+([\{\(\[\}\)\]]))" );
+    static QRegularExpression const texImage( R"lit(<\s*img\s+class="([^"]+)"\s*([^>]*)alt="([^"]+)"[^>]*>)lit" );
+    static QRegularExpression const regFrac( "\\\\[dt]frac" );
+    static QRegularExpression const regSpaces( R"(\s+([\{\(\[\}\)\]]))" );
 
     QRegExp multReg( R"(\*\{(\d+)\}([^\{]|\{([^\}]+)\}))", Qt::CaseSensitive, QRegExp::RegExp2 );
 
     QString arrayDesc( "\\begin{array}{" );
-    pos               = 0;
+    int pos           = 0;
     unsigned texCount = 0;
     QString imgName;
 
@@ -1111,7 +1112,9 @@ SlobDictionary::getSearchResults( QString const & searchString, int searchMode,
 /// SlobDictionary::getArticle()
 
 
-class SlobArticleRequest: public Dictionary::DataRequest
+class SlobArticleRequest:
+  public Dictionary::DataRequest,
+  public ArticleAssembler::Assembler< SlobArticleRequest >
 {
 
   wstring word;
@@ -1140,6 +1143,12 @@ public:
 
   void run();
 
+  quint64 articleKey( WordArticleLink const & );
+
+  bool loadArticle( WordArticleLink const &, ArticleAssembler::Article & );
+
+  void appendArticle( string & out, ArticleAssembler::Article const & );
+
   void cancel() override
   {
     isCancelled.ref();
@@ -1160,94 +1169,40 @@ void SlobArticleRequest::run()
     return;
   }
 
-  vector< WordArticleLink > chain = dict.findArticles( word, ignoreDiacritics );
-
-  for ( const auto & alt : alts ) {
-    /// Make an additional query for each alt
-
-    vector< WordArticleLink > altChain = dict.findArticles( alt, ignoreDiacritics );
-
-    chain.insert( chain.end(), altChain.begin(), altChain.end() );
-  }
-
-  multimap< wstring, pair< string, string > > mainArticles, alternateArticles;
-
-  set< quint64 > articlesIncluded; // Some synonims make it that the articles
-                                   // appear several times. We combat this
-                                   // by only allowing them to appear once.
-
-  wstring wordCaseFolded = Folding::applySimpleCaseOnly( word );
-  if ( ignoreDiacritics )
-    wordCaseFolded = Folding::applyDiacriticsOnly( wordCaseFolded );
-
-  for ( auto & x : chain ) {
-    if ( Utils::AtomicInt::loadAcquire( isCancelled ) ) {
-      finish();
-      return;
-    }
-
-    quint64 pos = dict.getArticlePos( x.articleOffset ); // Several "articleOffset" values may refer to one article
-
-    if ( articlesIncluded.find( pos ) != articlesIncluded.end() )
-      continue; // We already have this article in the body.
-
-    // Now grab that article
-
-    string headword, articleText;
-
-    headword = x.word;
-    try {
-      dict.loadArticle( x.articleOffset, articleText );
-    }
-    catch ( ... ) {
-    }
-
-    // Ok. Now, does it go to main articles, or to alternate ones? We list
-    // main ones first, and alternates after.
-
-    // We do the case-folded comparison here.
-
-    wstring headwordStripped = Folding::applySimpleCaseOnly( headword );
-    if ( ignoreDiacritics )
-      headwordStripped = Folding::applyDiacriticsOnly( headwordStripped );
-
-    multimap< wstring, pair< string, string > > & mapToUse =
-      ( wordCaseFolded == headwordStripped ) ? mainArticles : alternateArticles;
-
-    mapToUse.insert( pair( Folding::applySimpleCaseOnly( headword ), pair( headword, articleText ) ) );
+  string result;
 
-    articlesIncluded.insert( pos );
-  }
+  if ( assemble( dict, word, alts, ignoreDiacritics, isCancelled, result ) ) {
+    appendString( std::move( result ) );
 
-  if ( mainArticles.empty() && alternateArticles.empty() ) {
-    // No such word
-    finish();
-    return;
+    hasAnyData = true;
   }
 
-  string result;
+  finish();
+}
 
-  multimap< wstring, pair< string, string > >::const_iterator i;
+quint64 SlobArticleRequest::articleKey( WordArticleLink const & link )
+{
+  // Several "articleOffset" values may refer to one article
+  return dict.getArticlePos( link.articleOffset );
+}
 
-  for ( i = mainArticles.begin(); i != mainArticles.end(); ++i ) {
-    result += R"(<div class="slobdict"><h3 class="slobdict_headword">)";
-    result += i->second.first;
-    result += "</h3></div>";
-    result += i->second.second;
+bool SlobArticleRequest::loadArticle( WordArticleLink const & link, ArticleAssembler::Article & article )
+{
+  try {
+    dict.loadArticle( link.articleOffset, article.text );
   }
-
-  for ( i = alternateArticles.begin(); i != alternateArticles.end(); ++i ) {
-    result += R"(<div class="slobdict"><h3 class="slobdict_headword">)";
-    result += i->second.first;
-    result += "</h3></div>";
-    result += i->second.second;
+  catch ( ... ) {
   }
 
-  appendString( result );
-
-  hasAnyData = true;
+  return true;
+}
 
-  finish();
+void SlobArticleRequest::appendArticle( string & out, ArticleAssembler::Article const & article )
+{
+  out += R"(<div class="slobdict"><h3 class="slobdict_headword">)";
+  out += article.headword;
+  out += "</h3></div>";
+  out += article.text;
 }
 
 sptr< Dictionary::DataRequest > SlobDictionary::getArticle( wstring const & word,
@@ -15,9 +15,12 @@
 #include "utils.hh"
 
 #include <set>
+#include <QDataStream>
 #include <QDir>
-#include <QFileInfo>
 #include <QDirIterator>
+#include <QFileInfo>
+#include <QHash>
+#include <QtConcurrent>
 
 namespace SoundDir {
 
@@ -284,7 +287,7 @@ sptr< Dictionary::DataRequest > SoundDirDictionary::getArticle( wstring const &
 
   auto ret = std::make_shared< Dictionary::DataRequestInstant >( true );
 
-  ret->appendString( result );
+  ret->appendString( std::move( result ) );
 
   return ret;
 }
@@ -382,36 +385,159 @@ sptr< Dictionary::DataRequest > SoundDirDictionary::getResource( string const &
   }
 }
 
-void addDir( QDir const & baseDir,
-             QDir const & dir,
-             IndexedWords & indexedWords,
-             uint32_t & soundsCount,
-             ChunkedStorage::Writer & chunks )
+/// What is known about one directory of the sound dir. The manifest of all
+/// of them is kept next to the index, so on the next run only the directories
+/// whose modification time or number of entries has changed get listed again.
+struct DirEntry
+{
+  QString path; // Relative to the sound dir, empty for the sound dir itself
+  qint64 modified = 0;
+  quint32 entryCount = 0; // All the entries, not just the ones kept below
+  QStringList subDirs;    // Names only
+  QStringList sounds;
+};
+
+QDataStream & operator<<( QDataStream & out, DirEntry const & entry )
+{
+  return out << entry.path << entry.modified << entry.entryCount << entry.subDirs << entry.sounds;
+}
+
+QDataStream & operator>>( QDataStream & in, DirEntry & entry )
+{
+  return in >> entry.path >> entry.modified >> entry.entryCount >> entry.subDirs >> entry.sounds;
+}
+
+using Manifest = QHash< QString, DirEntry >;
+
+enum {
+  ManifestSignature = 0x4d524453, // SDRM on little-endian
+  ManifestVersion   = 1
+};
+
+QString manifestFileName( string const & indexFile )
+{
+  return QString::fromStdString( indexFile ) + "_dirs";
+}
+
+Manifest loadManifest( string const & indexFile )
+{
+  Manifest manifest;
+
+  QFile file( manifestFileName( indexFile ) );
+  if ( !file.open( QFile::ReadOnly ) )
+    return manifest;
+
+  QDataStream in( &file );
+  quint32 signature, version, count;
+  in >> signature >> version >> count;
+
+  if ( signature != ManifestSignature || version != ManifestVersion )
+    return manifest;
+
+  DirEntry entry;
+  for ( quint32 x = 0; x < count && in.status() == QDataStream::Ok; ++x ) {
+    in >> entry;
+    manifest.insert( entry.path, entry );
+  }
+
+  if ( in.status() != QDataStream::Ok )
+    manifest.clear();
+
+  return manifest;
+}
+
+void saveManifest( string const & indexFile, QList< DirEntry > const & entries )
+{
+  QFile file( manifestFileName( indexFile ) );
+  if ( !file.open( QFile::WriteOnly | QFile::Truncate ) )
+    return;
+
+  QDataStream out( &file );
+  out << (quint32)ManifestSignature << (quint32)ManifestVersion << (quint32)entries.size();
+
+  for ( auto const & entry : entries )
+    out << entry;
+}
+
+/// Brings the entry of the given directory up to date, listing it only if it
+/// has changed since the old manifest was made.
+DirEntry scanDir( QDir const & baseDir, QString const & path, Manifest const & oldManifest )
+{
+  QFileInfo const info( path.isEmpty() ? baseDir.path() : baseDir.filePath( path ) );
+
+  DirEntry entry;
+  entry.path     = path;
+  entry.modified = info.lastModified().toMSecsSinceEpoch();
+
+  auto old = oldManifest.constFind( path );
+  if ( old != oldManifest.constEnd() && old->modified == entry.modified ) {
+    // Some filesystems don't update the modification time of a directory
+    // reliably, so its entries are counted as well. That takes just reading
+    // the names, without looking at each of the files.
+    QDirIterator it( info.filePath(), QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot );
+    quint32 count = 0;
+    while ( it.hasNext() ) {
+      it.next();
+      ++count;
+    }
+
+    if ( count == old->entryCount )
+      return *old;
+  }
+
+  const QFileInfoList entries =
+    QDir( info.filePath() ).entryInfoList( QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot );
+
+  for ( auto const & i : entries ) {
+    if ( i.isDir() )
+      entry.subDirs.append( i.fileName() );
+    else if ( Filetype::isNameOfSound( i.fileName().toUtf8().data() ) )
+      entry.sounds.append( i.fileName() );
+  }
+
+  entry.entryCount = entries.size();
+
+  return entry;
+}
+
+/// Walks the whole tree level by level, scanning the directories of each
+/// level in parallel. Returns true if the set of sounds differs from the one in
+/// the old manifest, and sets touched if any directory was listed again.
+bool scanTree( QDir const & baseDir, Manifest const & oldManifest, QList< DirEntry > & entries, bool & touched )
 {
-  const QFileInfoList entries = dir.entryInfoList( QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot );
+  bool changed = false;
+  QStringList level( QString() );
 
-  for ( QFileInfoList::const_iterator i = entries.constBegin(); i != entries.constEnd(); ++i ) {
-    if ( i->isDir() )
-      addDir( baseDir, QDir( i->absoluteFilePath() ), indexedWords, soundsCount, chunks );
-    else if ( Filetype::isNameOfSound( i->fileName().toUtf8().data() ) ) {
-      // Add this sound to index
-      string fileName = baseDir.relativeFilePath( i->filePath() ).toUtf8().data();
+  touched = false;
 
-      const uint32_t articleOffset = chunks.startNewBlock();
-      chunks.addToBlock( fileName.c_str(), fileName.size() + 1 );
+  while ( !level.isEmpty() ) {
+    auto const scanned = QtConcurrent::blockingMapped< QList< DirEntry > >( level, [ & ]( QString const & path ) {
+      return scanDir( baseDir, path, oldManifest );
+    } );
 
-      wstring name = gd::toWString( i->fileName() );
+    level.clear();
 
-      const wstring::size_type pos = name.rfind( L'.' );
+    for ( auto const & entry : scanned ) {
+      auto old = oldManifest.constFind( entry.path );
+      if ( old == oldManifest.constEnd() )
+        changed = true;
+      else if ( old->modified != entry.modified || old->entryCount != entry.entryCount ) {
+        touched = true;
 
-      if ( pos != wstring::npos )
-        name.erase( pos );
+        // Something else than sounds, e.g. a text file, might have been added
+        if ( old->subDirs != entry.subDirs || old->sounds != entry.sounds )
+          changed = true;
+      }
 
-      indexedWords.addWord( name, articleOffset );
+      for ( auto const & subDir : entry.subDirs )
+        level.append( entry.path.isEmpty() ? subDir : entry.path + '/' + subDir );
 
-      ++soundsCount;
+      entries.append( entry );
     }
   }
+
+  // Removed directories don't show up in the walk, but do in the count
+  return changed || entries.size() != oldManifest.size();
 }
 
 } // namespace
@@ -439,24 +565,21 @@ vector< sptr< Dictionary::Class > > makeDictionaries( Config::SoundDirs const &
 
     string indexFile = indicesDir + dictId;
 
-    // Check if the soundDir and its subdirs' modification date changed, that means the user modified the sound files inside
-
-    bool soundDirModified = false;
-    {
-      QDateTime indexFileModifyTime = QFileInfo( QString::fromStdString( indexFile ) ).lastModified();
-      QDirIterator it( dir.path(),
-                       QDir::AllDirs | QDir::NoDotAndDotDot | QDir::NoSymLinks,
-                       QDirIterator::Subdirectories );
-      while ( it.hasNext() ) {
-        it.next();
-        if ( it.fileInfo().lastModified() > indexFileModifyTime ) {
-          soundDirModified = true;
-          break;
-        }
-      }
-    }
+    // Check if the soundDir and its subdirs' modification date changed, that means the user modified the sound files inside.
+    // Only the changed directories are listed, the rest is taken from the manifest of the previous scan.
+
+    Manifest oldManifest;
+    if ( !indexIsOldOrBad( indexFile ) )
+      oldManifest = loadManifest( indexFile );
 
-    if ( Dictionary::needToRebuildIndex( dictFiles, indexFile ) || indexIsOldOrBad( indexFile ) || soundDirModified ) {
+    QList< DirEntry > dirEntries;
+    bool dirsTouched      = false;
+    bool soundDirModified = scanTree( dir, oldManifest, dirEntries, dirsTouched );
+
+    if ( !soundDirModified && dirsTouched )
+      saveManifest( indexFile, dirEntries ); // Only the modification times differ
+
+    if ( soundDirModified ) {
       // Building the index
 
       qDebug() << "Sounds: Building the index for directory: " << soundDir.path;
@@ -480,7 +603,26 @@ vector< sptr< Dictionary::Class > > makeDictionaries( Config::SoundDirs const &
 
       uint32_t soundsCount = 0; // Header's one is packed, we can't ref it
 
-      addDir( dir, dir, indexedWords, soundsCount, chunks );
+      for ( auto const & entry : dirEntries ) {
+        for ( auto const & sound : entry.sounds ) {
+          // Add this sound to index
+          string fileName = ( entry.path.isEmpty() ? sound : entry.path + '/' + sound ).toUtf8().data();
+
+          const uint32_t articleOffset = chunks.startNewBlock();
+          chunks.addToBlock( fileName.c_str(), fileName.size() + 1 );
+
+          wstring name = gd::toWString( sound );
+
+          const wstring::size_type pos = name.rfind( L'.' );
+
+          if ( pos != wstring::npos )
+            name.erase( pos );
+
+          indexedWords.addWord( name, articleOffset );
+
+          ++soundsCount;
+        }
+      }
 
       idxHeader.soundsCount = soundsCount;
 
@@ -503,6 +645,8 @@ vector< sptr< Dictionary::Class > > makeDictionaries( Config::SoundDirs const &
       idx.rewind();
 
       idx.write( &idxHeader, sizeof( idxHeader ) );
+
+      saveManifest( indexFile, dirEntries );
     }
 
     dictionaries.push_back( std::make_shared< SoundDirDictionary >( dictId,
@@ -81,6 +81,7 @@ Sources::Sources( QWidget * parent, Config::Class const & cfg ):
   ui.programs->resizeColumnToContents( 2 );
   ui.programs->resizeColumnToContents( 3 );
   ui.programs->resizeColumnToContents( 4 );
+  ui.programs->resizeColumnToContents( 5 );
   ui.programs->setItemDelegate( itemDelegate );
 
   ui.paths->setTabKeyNavigation( true );
@@ -934,7 +935,7 @@ Qt::ItemFlags ProgramsModel::flags( QModelIndex const & index ) const
   Qt::ItemFlags result = QAbstractItemModel::flags( index );
 
   if ( index.isValid() ) {
-    if ( !index.column() )
+    if ( !index.column() || index.column() == 5 )
       result |= Qt::ItemIsUserCheckable;
     else
       result |= Qt::ItemIsEditable;
@@ -956,7 +957,7 @@ int ProgramsModel::columnCount( QModelIndex const & parent ) const
   if ( parent.isValid() )
     return 0;
   else
-    return 5;
+    return 6;
 }
 
 QVariant ProgramsModel::headerData( int section, Qt::Orientation /*orientation*/, int role ) const
@@ -973,6 +974,8 @@ QVariant ProgramsModel::headerData( int section, Qt::Orientation /*orientation*/
         return tr( "Command Line" );
       case 4:
         return tr( "Icon" );
+      case 5:
+        return tr( "Keep Running" );
       default:
         return QVariant();
     }
@@ -1006,6 +1009,13 @@ QVariant ProgramsModel::data( QModelIndex const & index, int role ) const
   if ( role == Qt::CheckStateRole && !index.column() )
     return programs[ index.row() ].enabled ? Qt::Checked : Qt::Unchecked;
 
+  if ( role == Qt::CheckStateRole && index.column() == 5 )
+    return programs[ index.row() ].server ? Qt::Checked : Qt::Unchecked;
+
+  if ( role == Qt::ToolTipRole && index.column() == 5 )
+    return tr( "Keep the program running and pass it the words one per line. Each answer should end with an "
+               "empty line, or start with a \"Content-Length: <bytes>\" line." );
+
   return QVariant();
 }
 
@@ -1021,6 +1031,13 @@ bool ProgramsModel::setData( QModelIndex const & index, const QVariant & value,
     return true;
   }
 
+  if ( role == Qt::CheckStateRole && index.column() == 5 ) {
+    programs[ index.row() ].server = !programs[ index.row() ].server;
+
+    dataChanged( index, index );
+    return true;
+  }
+
   if ( role == Qt::DisplayRole || role == Qt::EditRole )
     switch ( index.column() ) {
       case 1:
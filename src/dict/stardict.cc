@@ -3,6 +3,7 @@
 
 #include "stardict.hh"
 #include "btreeidx.hh"
+#include "articleassembler.hh"
 #include "folding.hh"
 #include "utf8.hh"
 #include "chunkedstorage.hh"
@@ -1230,13 +1231,16 @@ sptr< Dictionary::WordSearchRequest > StardictDictionary::findHeadwordsForSynony
 /// StardictDictionary::getArticle()
 
 
-class StardictArticleRequest: public Dictionary::DataRequest
+class StardictArticleRequest:
+  public Dictionary::DataRequest,
+  public ArticleAssembler::Assembler< StardictArticleRequest >
 {
 
   wstring word;
   vector< wstring > alts;
   StardictDictionary & dict;
   bool ignoreDiacritics;
+  string cleaner = Utils::Html::getHtmlCleaner();
 
   QAtomicInt isCancelled;
   QFuture< void > f;
@@ -1244,6 +1248,12 @@ class StardictArticleRequest: public Dictionary::DataRequest
 
 public:
 
+  // If there are too many alts or links, it's likely that the dictionary was
+  // wrongly produced or parsed
+  static constexpr size_t maxAlts     = 100;
+  static constexpr size_t maxAltChain = 100;
+  static constexpr size_t maxLinks    = 10;
+
   StardictArticleRequest( wstring const & word_,
                           vector< wstring > const & alts_,
                           StardictDictionary & dict_,
@@ -1260,6 +1270,10 @@ public:
 
   void run();
 
+  bool loadArticle( WordArticleLink const &, ArticleAssembler::Article & );
+
+  void appendArticle( string & out, ArticleAssembler::Article const & );
+
   void cancel() override
   {
     isCancelled.ref();
@@ -1280,103 +1294,13 @@ void StardictArticleRequest::run()
   }
 
   try {
-    vector< WordArticleLink > chain = dict.findArticles( word, ignoreDiacritics );
-
-    //if alts has more than 100 , great probability that the dictionary is wrong produced or parsed.
-    if ( alts.size() < 100 ) {
-      for ( const auto & alt : alts ) {
-        /// Make an additional query for each alt
-
-        vector< WordArticleLink > altChain = dict.findArticles( alt, ignoreDiacritics );
-        if ( altChain.size() > 100 ) {
-          continue;
-        }
-        chain.insert( chain.end(), altChain.begin(), altChain.end() );
-      }
-    }
-
-    multimap< wstring, pair< string, string > > mainArticles, alternateArticles;
-
-    set< uint32_t > articlesIncluded; // Some synonyms make it that the articles
-                                      // appear several times. We combat this
-                                      // by only allowing them to appear once.
-
-    wstring wordCaseFolded = Folding::applySimpleCaseOnly( word );
-    if ( ignoreDiacritics )
-      wordCaseFolded = Folding::applyDiacriticsOnly( wordCaseFolded );
-
-    //if the chain is too large, it is more likely has some dictionary making or parsing issue.
-    for ( unsigned x = 0; x < qMin( 10, (int)chain.size() ); ++x ) {
-      if ( Utils::AtomicInt::loadAcquire( isCancelled ) ) {
-        finish();
-        return;
-      }
-
-      if ( articlesIncluded.find( chain[ x ].articleOffset ) != articlesIncluded.end() )
-        continue; // We already have this article in the body.
-
-      // Now grab that article
-
-      string headword, articleText;
-
-      dict.loadArticle( chain[ x ].articleOffset, headword, articleText );
-
-      // Ok. Now, does it go to main articles, or to alternate ones? We list
-      // main ones first, and alternates after.
-
-      // We do the case-folded comparison here.
-
-      wstring headwordStripped = Folding::applySimpleCaseOnly( headword );
-      if ( ignoreDiacritics )
-        headwordStripped = Folding::applyDiacriticsOnly( headwordStripped );
-
-      multimap< wstring, pair< string, string > > & mapToUse =
-        ( wordCaseFolded == headwordStripped ) ? mainArticles : alternateArticles;
-
-      mapToUse.insert( pair( Folding::applySimpleCaseOnly( headword ), pair( headword, articleText ) ) );
-
-      articlesIncluded.insert( chain[ x ].articleOffset );
-    }
-
-    if ( mainArticles.empty() && alternateArticles.empty() ) {
-      // No such word
-      finish();
-      return;
-    }
-
     string result;
 
-    multimap< wstring, pair< string, string > >::const_iterator i;
-
-    string cleaner = Utils::Html::getHtmlCleaner();
+    if ( assemble( dict, word, alts, ignoreDiacritics, isCancelled, result ) ) {
+      appendString( std::move( result ) );
 
-    for ( i = mainArticles.begin(); i != mainArticles.end(); ++i ) {
-      result += dict.isFromLanguageRTL() ? R"(<h3 class="sdct_headwords" dir="rtl">)" : "<h3 class=\"sdct_headwords\">";
-      result += i->second.first;
-      result += "</h3>";
-      if ( dict.isToLanguageRTL() )
-        result += R"(<div style="display:inline;" dir="rtl">)";
-      result += i->second.second;
-      result += cleaner;
-      if ( dict.isToLanguageRTL() )
-        result += "</div>";
+      hasAnyData = true;
     }
-
-    for ( i = alternateArticles.begin(); i != alternateArticles.end(); ++i ) {
-      result += dict.isFromLanguageRTL() ? R"(<h3 class="sdct_headwords" dir="rtl">)" : "<h3 class=\"sdct_headwords\">";
-      result += i->second.first;
-      result += "</h3>";
-      if ( dict.isToLanguageRTL() )
-        result += R"(<div style="display:inline;" dir="rtl">)";
-      result += i->second.second;
-      result += cleaner;
-      if ( dict.isToLanguageRTL() )
-        result += "</div>";
-    }
-
-    appendString( result );
-
-    hasAnyData = true;
   }
   catch ( std::exception & e ) {
     setErrorString( QString::fromUtf8( e.what() ) );
@@ -1385,6 +1309,25 @@ void StardictArticleRequest::run()
   finish();
 }
 
+bool StardictArticleRequest::loadArticle( WordArticleLink const & link, ArticleAssembler::Article & article )
+{
+  dict.loadArticle( link.articleOffset, article.headword, article.text );
+  return true;
+}
+
+void StardictArticleRequest::appendArticle( string & out, ArticleAssembler::Article const & article )
+{
+  out += dict.isFromLanguageRTL() ? R"(<h3 class="sdct_headwords" dir="rtl">)" : "<h3 class=\"sdct_headwords\">";
+  out += article.headword;
+  out += "</h3>";
+  if ( dict.isToLanguageRTL() )
+    out += R"(<div style="display:inline;" dir="rtl">)";
+  out += article.text;
+  out += cleaner;
+  if ( dict.isToLanguageRTL() )
+    out += "</div>";
+}
+
 sptr< Dictionary::DataRequest > StardictDictionary::getArticle( wstring const & word,
                                                                 vector< wstring > const & alts,
                                                                 wstring const &,
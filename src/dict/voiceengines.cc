@@ -105,7 +105,7 @@ VoiceEnginesDictionary::getArticle( wstring const & word, vector< wstring > cons
   result += "</tr></table>";
 
   auto ret = std::make_shared< DataRequestInstant >( true );
-  ret->appendString( result );
+  ret->appendString( std::move( result ) );
   return ret;
 }
 
@@ -382,7 +382,7 @@ WebSiteDictionary::getArticle( wstring const & str, vector< wstring > const &, w
                       "</iframe>";
 
     auto dr = std::make_shared< DataRequestInstant >( true );
-    dr->appendString( result );
+    dr->appendString( std::move( result ) );
     return dr;
   }
 
@@ -3,6 +3,7 @@
 
 #include "xdxf.hh"
 #include "btreeidx.hh"
+#include "articleassembler.hh"
 #include "folding.hh"
 #include "utf8.hh"
 #include "chunkedstorage.hh"
@@ -416,13 +417,16 @@ XdxfDictionary::getSearchResults( QString const & searchString, int searchMode,
 /// XdxfDictionary::getArticle()
 
 
-class XdxfArticleRequest: public Dictionary::DataRequest
+class XdxfArticleRequest:
+  public Dictionary::DataRequest,
+  public ArticleAssembler::Assembler< XdxfArticleRequest >
 {
 
   wstring word;
   vector< wstring > alts;
   XdxfDictionary & dict;
   bool ignoreDiacritics;
+  string cleaner = Utils::Html::getHtmlCleaner();
 
   QAtomicInt isCancelled;
   QFuture< void > f;
@@ -445,6 +449,10 @@ public:
 
   void run();
 
+  bool loadArticle( WordArticleLink const &, ArticleAssembler::Article & );
+
+  void appendArticle( string & out, ArticleAssembler::Article const & );
+
   void cancel() override
   {
     isCancelled.ref();
@@ -465,98 +473,33 @@ void XdxfArticleRequest::run()
     return;
   }
 
-  vector< WordArticleLink > chain = dict.findArticles( word, ignoreDiacritics );
-
-  for ( const auto & alt : alts ) {
-    /// Make an additional query for each alt
-
-    vector< WordArticleLink > altChain = dict.findArticles( alt, ignoreDiacritics );
-
-    chain.insert( chain.end(), altChain.begin(), altChain.end() );
-  }
-
-  multimap< wstring, pair< string, string > > mainArticles, alternateArticles;
-
-  set< uint32_t > articlesIncluded; // Some synonims make it that the articles
-                                    // appear several times. We combat this
-                                    // by only allowing them to appear once.
-
-  wstring wordCaseFolded = Folding::applySimpleCaseOnly( word );
-  if ( ignoreDiacritics )
-    wordCaseFolded = Folding::applyDiacriticsOnly( wordCaseFolded );
-
-  for ( const auto & x : chain ) {
-    if ( Utils::AtomicInt::loadAcquire( isCancelled ) ) {
-      finish();
-      return;
-    }
-
-    if ( articlesIncluded.find( x.articleOffset ) != articlesIncluded.end() )
-      continue; // We already have this article in the body.
-
-    // Now grab that article
-
-    string headword, articleText;
-
-    headword = x.word;
-
-    try {
-      dict.loadArticle( x.articleOffset, articleText );
-
-      // Ok. Now, does it go to main articles, or to alternate ones? We list
-      // main ones first, and alternates after.
-
-      // We do the case-folded comparison here.
-
-      wstring headwordStripped = Folding::applySimpleCaseOnly( headword );
-      if ( ignoreDiacritics )
-        headwordStripped = Folding::applyDiacriticsOnly( headwordStripped );
-
-      multimap< wstring, pair< string, string > > & mapToUse =
-        ( wordCaseFolded == headwordStripped ) ? mainArticles : alternateArticles;
+  string result;
 
-      mapToUse.insert( pair( Folding::applySimpleCaseOnly( headword ), pair( headword, articleText ) ) );
+  if ( assemble( dict, word, alts, ignoreDiacritics, isCancelled, result ) ) {
+    appendString( std::move( result ) );
 
-      articlesIncluded.insert( x.articleOffset );
-    }
-    catch ( std::exception & ex ) {
-      gdWarning( "XDXF: Failed loading article from \"%s\", reason: %s\n", dict.getName().c_str(), ex.what() );
-    }
-  }
-
-  if ( mainArticles.empty() && alternateArticles.empty() ) {
-    // No such word
-    finish();
-    return;
+    hasAnyData = true;
   }
 
-  string result;
-
-  multimap< wstring, pair< string, string > >::const_iterator i;
-
-  string cleaner = Utils::Html::getHtmlCleaner();
+  finish();
+}
 
-  for ( i = mainArticles.begin(); i != mainArticles.end(); ++i ) {
-    //      result += "<h3>";
-    //      result += i->second.first;
-    //      result += "</h3>";
-    result += i->second.second;
-    result += cleaner;
+bool XdxfArticleRequest::loadArticle( WordArticleLink const & link, ArticleAssembler::Article & article )
+{
+  try {
+    dict.loadArticle( link.articleOffset, article.text );
+    return true;
   }
-
-  for ( i = alternateArticles.begin(); i != alternateArticles.end(); ++i ) {
-    //      result += "<h3>";
-    //      result += i->second.first;
-    //      result += "</h3>";
-    result += i->second.second;
-    result += cleaner;
+  catch ( std::exception & ex ) {
+    gdWarning( "XDXF: Failed loading article from \"%s\", reason: %s\n", dict.getName().c_str(), ex.what() );
+    return false;
   }
+}
 
-  appendString( result );
-
-  hasAnyData = true;
-
-  finish();
+void XdxfArticleRequest::appendArticle( string & out, ArticleAssembler::Article const & article )
+{
+  out += article.text;
+  out += cleaner;
 }
 
 sptr< Dictionary::DataRequest > XdxfDictionary::getArticle( wstring const & word,
@@ -627,6 +570,24 @@ class GzippedFile: public QIODevice
 {
   gzFile gz;
 
+  // Calling gzread() for every byte costs much more than the inflating
+  // itself, so the data is inflated in big blocks and handed out from here
+  enum {
+    BufferSize = 256 * 1024
+  };
+  std::vector< char > buffer;
+  size_t bufferPos = 0;
+  size_t bufferEnd = 0;
+
+  size_t buffered() const
+  {
+    return bufferEnd - bufferPos;
+  }
+
+  /// Inflates the next block into the empty buffer. Returns the number of
+  /// bytes read, 0 at the end of the file or -1 on error.
+  int fillBuffer();
+
 public:
 
   GzippedFile( char const * fileName );
@@ -648,12 +609,12 @@ protected:
 
   bool waitForReadyRead( int ) override
   {
-    return !gzeof( gz );
+    return !atEnd();
   }
 
   qint64 bytesAvailable() const override
   {
-    return ( gzeof( gz ) ? 0 : 1 ) + QIODevice::bytesAvailable();
+    return ( atEnd() ? 0 : 1 ) + QIODevice::bytesAvailable();
   }
 
   qint64 readData( char * data, qint64 maxSize ) override;
@@ -666,7 +627,8 @@ protected:
   }
 };
 
-GzippedFile::GzippedFile( char const * fileName )
+GzippedFile::GzippedFile( char const * fileName ):
+  buffer( BufferSize )
 {
   gz = gd_gzopen( fileName );
   if ( !gz )
@@ -685,7 +647,17 @@ GzippedFile::~GzippedFile()
 
 bool GzippedFile::atEnd() const
 {
-  return gzeof( gz );
+  return !buffered() && gzeof( gz );
+}
+
+int GzippedFile::fillBuffer()
+{
+  int n = gzread( gz, buffer.data(), buffer.size() );
+
+  bufferPos = 0;
+  bufferEnd = n > 0 ? n : 0;
+
+  return n;
 }
 
 /*
@@ -697,29 +669,41 @@ size_t GzippedFile::gzTell()
 
 qint64 GzippedFile::readData( char * data, qint64 maxSize )
 {
-  if ( maxSize > 1 )
-    maxSize = 1;
+  if ( maxSize < 1 )
+    return 0;
 
-  // The returning value translates directly to QIODevice semantics
-  int n = gzread( gz, data, maxSize );
+  if ( !buffered() ) {
+    // The returning value translates directly to QIODevice semantics
+    if ( int n = fillBuffer(); n <= 0 )
+      return n;
+  }
 
   // With QT 5.x QXmlStreamReader ask one byte instead of one UTF-8 char.
-  // We read and return all bytes for char.
-
-  if ( n == 1 ) {
-    char ch      = *data;
-    int addBytes = 0;
-    if ( ch & 0x80 ) {
-      if ( ( ch & 0xF8 ) == 0xF0 )
-        addBytes = 3;
-      else if ( ( ch & 0xF0 ) == 0xE0 )
-        addBytes = 2;
-      else if ( ( ch & 0xE0 ) == 0xC0 )
-        addBytes = 1;
-    }
+  // We read and return all bytes for char. Returning more than that would
+  // throw off pos(), which gives the articles' offsets.
+
+  char ch      = buffer[ bufferPos++ ];
+  int addBytes = 0;
+
+  *data = ch;
+
+  if ( ch & 0x80 ) {
+    if ( ( ch & 0xF8 ) == 0xF0 )
+      addBytes = 3;
+    else if ( ( ch & 0xF0 ) == 0xE0 )
+      addBytes = 2;
+    else if ( ( ch & 0xE0 ) == 0xC0 )
+      addBytes = 1;
+  }
+
+  qint64 n = 1;
+
+  // The rest of the char might be in the next block
+  for ( ; addBytes; --addBytes ) {
+    if ( !buffered() && fillBuffer() <= 0 )
+      break;
 
-    if ( addBytes )
-      n += gzread( gz, data + 1, addBytes );
+    data[ n++ ] = buffer[ bufferPos++ ];
   }
 
   return n;
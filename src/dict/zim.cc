@@ -5,6 +5,7 @@
 
   #include "zim.hh"
   #include "btreeidx.hh"
+  #include "articleassembler.hh"
 
   #include "folding.hh"
   #include "gddebug.hh"
@@ -16,6 +17,8 @@
   #include "tiff.hh"
   #include "ftshelpers.hh"
   #include "htmlescape.hh"
+  #include "htmlrewriter.hh"
+  #include "iconcache.hh"
 
   #ifdef _MSC_VER
     #include <stub_msvc.h>
@@ -27,6 +30,7 @@
   #include <QAtomicInt>
   #include <QImage>
   #include <QDir>
+  #include <QFileInfo>
 
   #include <QRegularExpression>
 
@@ -280,15 +284,26 @@ void ZimDictionary::loadIcon() noexcept
   }
 
   // Try to load zim's illustration, which is usually 48x48 png
+  QFileInfo const info( QString::fromStdString( getDictionaryFilenames()[ 0 ] ) );
+  QString const source = "zim@" + QString::number( info.lastModified().toMSecsSinceEpoch() );
+
+  QImage img;
+  if ( IconCache::find( getId(), source, img ) ) {
+    dictionaryIcon       = QIcon( QPixmap::fromImage( img ) );
+    dictionaryIconLoaded = true;
+    return;
+  }
+
   try {
     auto illustration = df.getIllustrationItem( 48 ).getData();
-    QImage img = QImage::fromData( reinterpret_cast< const uchar * >( illustration.data() ), illustration.size() );
+    img = QImage::fromData( reinterpret_cast< const uchar * >( illustration.data() ), illustration.size() );
 
     if ( img.isNull() ) {
       // Fallback to default icon
       dictionaryIcon = QIcon( ":/icons/icon32_zim.png" );
     }
     else {
+      IconCache::store( getId(), source, img );
       dictionaryIcon = QIcon( QPixmap::fromImage( img ) );
     }
 
@@ -313,152 +328,144 @@ quint32 ZimDictionary::loadArticle( quint32 address, string & articleText, bool
   return ret;
 }
 
-string ZimDictionary::convert( const string & in )
+namespace {
+
+/// Links which are not to be turned into lookups
+bool hasKnownProtocol( std::string_view url )
 {
-  QString text = QString::fromUtf8( in.c_str() );
+  if ( url.empty() || url[ 0 ] == '#' || url.rfind( "mailto:", 0 ) == 0 || url.rfind( "tel:", 0 ) == 0 )
+    return true;
 
-  // replace background
-  text.replace( QRegularExpression( R"(<\s*body\s+([^>]*)(background(|-color)):([^;"]*(;|)))" ),
-                QString( "<body \\1" ) );
+  // \w+://
+  size_t n = 0;
+  while ( n < url.size() && ( isalnum( (unsigned char)url[ n ] ) || url[ n ] == '_' ) )
+    ++n;
 
-  // pattern of img and script
-  // text.replace( QRegularExpression( "<\\s*(img|script)\\s+([^>]*)src=(\")([^\"]*)\\3" ),
-  //               QString( "<\\1 \\2src=\\3bres://%1/").arg( getId().c_str() ) );
+  return n && url.compare( n, 3, "://" ) == 0;
+}
 
-  QRegularExpression rxImgScript( R"(<\s*(img|script|source)\s+([^>]*)src=(")([^"]*)\3)" );
-  QRegularExpressionMatchIterator it = rxImgScript.globalMatch( text );
-  int pos                            = 0;
-  QString newText;
-  while ( it.hasNext() ) {
-    QRegularExpressionMatch match = it.next();
+std::string_view withoutLeadingDotSlash( std::string_view url )
+{
+  if ( url.rfind( "../", 0 ) == 0 )
+    return url.substr( 3 );
+  if ( url.rfind( "./", 0 ) == 0 )
+    return url.substr( 2 );
+  if ( url.rfind( "/", 0 ) == 0 )
+    return url.substr( 1 );
+  return url;
+}
 
-    newText += text.mid( pos, match.capturedStart() - pos );
-    pos = match.capturedEnd();
+/// Returns the lookup word for links to http(s)://en.wikipedia.org/wiki/<word>
+/// and the like, if the word has no ':' in it
+std::optional< std::string_view > localWikiWord( std::string_view url )
+{
+  static QRegularExpression const rxWiki(
+    R"(^https?://en\.(?:wiki(?:pedia|books|news|quote|source|voyage|versity)|wiktionary)\.(?:org|com)/wiki/([^:]*)$)" );
 
-    QStringList list = match.capturedTexts();
+  if ( url.find( "/wiki/" ) == std::string_view::npos )
+    return {};
 
-    QString url = list[ 4 ]; // a url
+  auto match = rxWiki.match( QString::fromUtf8( url.data(), url.size() ) );
+  if ( !match.hasMatch() )
+    return {};
 
-    QString urlLink = match.captured();
+  return url.substr( url.size() - match.captured( 1 ).toUtf8().size() );
+}
 
-    QString replacedLink = urlLink;
-    if ( !url.isEmpty() && !url.startsWith( "//" ) && !url.startsWith( "http://" ) && !url.startsWith( "https://" ) ) {
-      //the pattern like : <\\1 \\2src=\\3bres://%1/
+} // namespace
 
-      //remove leading dot and slash
-      url.remove( RX::Zim::leadingDotSlash );
-      replacedLink =
-        QString( "<%1 %2 src=\"bres://%3/%4\"" ).arg( list[ 1 ], list[ 2 ], QString::fromStdString( getId() ), url );
+string ZimDictionary::convert( const string & in )
+{
+  string const resourcePrefix = "bres://" + getId() + "/";
+
+  // All the links are fixed in a single pass over the article
+  string text = Html::rewriteTags( in, [ &resourcePrefix ]( Html::Tag & tag ) {
+    if ( tag.is( "img" ) || tag.is( "script" ) || tag.is( "source" ) ) {
+      auto src = tag.attribute( "src" );
+      if ( src && !src->empty() && src->rfind( "//", 0 ) != 0 && src->rfind( "http://", 0 ) != 0
+           && src->rfind( "https://", 0 ) != 0 )
+        tag.setAttribute( "src", resourcePrefix + string( withoutLeadingDotSlash( *src ) ) );
     }
+    else if ( tag.is( "a" ) ) {
+      auto href = tag.attribute( "href" );
+      if ( !href )
+        return;
+
+      // localize the http://en.wiki***.com|org/wiki/<key> series links
+      if ( auto word = localWikiWord( *href ) ) {
+        tag.setAttribute( "href", "gdlookup://localhost/" + string( *word ) );
+        return;
+      }
+
+      // Links without any known protocol are translated into local definitions
+      if ( hasKnownProtocol( *href ) || href->rfind( "//", 0 ) == 0 )
+        return;
 
-    newText += replacedLink;
-  }
-  if ( pos ) {
-    newText += text.mid( pos );
-    text = newText;
-  }
-  newText.clear();
-
-
-  // Fix links without '"'
-  text.replace( QRegularExpression( R"(href=(\.\.|)/([^\s>]+))" ), QString( R"(href="\1/\2")" ) );
-
-  // pattern <link... href="..." ...>
-  text.replace( QRegularExpression( R"(<\s*link\s+([^>]*)href="(\.\.|)/)" ),
-                QString( "<link \\1href=\"bres://%1/" ).arg( getId().c_str() ) );
-
-  // localize the http://en.wiki***.com|org/wiki/<key> series links
-  // excluding those keywords that have ":" in it
-  QString urlWiki =
-    "\"http(s|)://en\\.(wiki(pedia|books|news|quote|source|voyage|versity)|wiktionary)\\.(org|com)/wiki/([^:\"]*)\"";
-  text.replace( QRegularExpression( R"(<\s*a\s+(class="external"\s+|)href=)" + urlWiki ),
-                QString( R"(<a href="gdlookup://localhost/\6")" ) );
-
-  // pattern <a href="..." ...>, excluding any known protocols such as http://, mailto:, #(comment)
-  // these links will be translated into local definitions
-  // <meta http-equiv="Refresh" content="0;url=../dsalsrv02.uchicago.edu/cgi-bin/0994.html">
-  QRegularExpression rxLink(
-    R"lit(<\s*(?:a|meta)\s+([^>]*)(?:href|url)="?(?!(?:\w+://|#|mailto:|tel:))()([^"]*)"\s*(title="[^"]*")?[^>]*>)lit" );
-  it  = rxLink.globalMatch( text );
-  pos = 0;
-  while ( it.hasNext() ) {
-    QRegularExpressionMatch match = it.next();
-
-    newText += text.mid( pos, match.capturedStart() - pos );
-    pos = match.capturedEnd();
-
-    QStringList list = match.capturedTexts();
-    // Add empty strings for compatibility with QRegExp behaviour
-    for ( int i = list.size(); i < 5; i++ )
-      list.append( QString() );
-
-    QString formatTag;
-    QString tag = list[ 3 ]; // a url, ex: Precambrian_Chaotian.html
-    QString url = tag;
-    if ( !list[ 4 ].isEmpty() ) // a title, ex: title="Precambrian/Chaotian"
-    {
-      tag       = list[ 4 ];
-      formatTag = tag.split( "\"" )[ 1 ];
+      auto title = tag.attribute( "title" );
+      tag.setAttribute( "href",
+                        "gdlookup://localhost/" + string( title ? *title : withoutLeadingDotSlash( *href ) ) );
     }
-    else {
-      //tag from list[3]
-      formatTag = tag;
-      formatTag.remove( RX::Zim::leadingDotSlash );
+    else if ( tag.is( "link" ) ) {
+      auto href = tag.attribute( "href" );
+      if ( href && ( href->rfind( "/", 0 ) == 0 || href->rfind( "../", 0 ) == 0 ) )
+        tag.setAttribute( "href", resourcePrefix + string( href->substr( href->find( '/' ) + 1 ) ) );
     }
-
-    QString urlLink = match.captured();
-
-    QString replacedLink = urlLink;
-    if ( !url.isEmpty() && !url.startsWith( "//" ) ) {
-      replacedLink = urlLink.replace( url, "gdlookup://localhost/" + formatTag );
+    else if ( tag.is( "meta" ) ) {
+      // <meta http-equiv="Refresh" content="0;url=../dsalsrv02.uchicago.edu/cgi-bin/0994.html">
+      auto content = tag.attribute( "content" );
+      if ( !content )
+        return;
+      size_t n = content->find( "url=" );
+      if ( n == std::string_view::npos )
+        return;
+      auto url = content->substr( n + 4 );
+      if ( !url.empty() && !hasKnownProtocol( url ) && url.rfind( "//", 0 ) != 0 )
+        tag.setAttribute( "content",
+                          string( content->substr( 0, n + 4 ) ) + "gdlookup://localhost/"
+                            + string( withoutLeadingDotSlash( url ) ) );
     }
-
-    newText += replacedLink;
-  }
-  if ( pos != 0 ) {
-    newText += text.mid( pos );
-    text = newText;
-  }
-  newText.clear();
+    else if ( tag.is( "body" ) ) {
+      // Drop the background, it doesn't play well with the article styles
+      static QRegularExpression const rxBackground( R"(background(-color|):[^;]*;?)" );
+      auto style = tag.attribute( "style" );
+      if ( style && style->find( "background" ) != std::string_view::npos )
+        tag.setAttribute( "style",
+                          QString::fromUtf8( style->data(), style->size() ).remove( rxBackground ).toStdString() );
+    }
+  } );
 
   // Occasionally words needs to be displayed in vertical, but <br/> were changed to <br\> somewhere
   // proper style: <a href="gdlookup://localhost/Neoptera" ... >N<br/>e<br/>o<br/>p<br/>t<br/>e<br/>r<br/>a</a>
-  QRegularExpression rxBR(
-    R"((<a href="gdlookup://localhost/[^"]*"\s*[^>]*>)\s*((\w\s*&lt;br(\\|/|)&gt;\s*)+\w)\s*</a>)",
-    QRegularExpression::UseUnicodePropertiesOption );
-  pos                                 = 0;
-  QRegularExpressionMatchIterator it2 = rxBR.globalMatch( text );
-  while ( it2.hasNext() ) {
-    QRegularExpressionMatch match = it2.next();
-
-    newText += text.mid( pos, match.capturedStart() - pos );
-    pos = match.capturedEnd();
-
-    QStringList list = match.capturedTexts();
-    // Add empty strings for compatibility with QRegExp behaviour
-    for ( int i = match.lastCapturedIndex() + 1; i < 3; i++ )
-      list.append( QString() );
-
-    QString tag = list[ 2 ];
-    tag
-      .replace(
-        QRegularExpression( "&lt;br( |)(\\\\|/|)&gt;", QRegularExpression::PatternOption::CaseInsensitiveOption ),
-        "<br/>" )
-      .prepend( list[ 1 ] )
-      .append( "</a>" );
-
-    newText += tag;
-  }
-  if ( pos ) {
-    newText += text.mid( pos );
-    text = newText;
-  }
-  newText.clear();
+  if ( text.find( "&lt;br" ) != string::npos ) {
+    static QRegularExpression const rxBR(
+      R"((<a href="gdlookup://localhost/[^"]*"\s*[^>]*>)\s*((\w\s*&lt;br(\\|/|)&gt;\s*)+\w)\s*</a>)",
+      QRegularExpression::UseUnicodePropertiesOption );
+    static QRegularExpression const rxEscapedBR( "&lt;br( |)(\\\\|/|)&gt;",
+                                                 QRegularExpression::PatternOption::CaseInsensitiveOption );
+
+    QString qtext = QString::fromUtf8( text.data(), text.size() );
+    QString newText;
+    int pos = 0;
+
+    QRegularExpressionMatchIterator it = rxBR.globalMatch( qtext );
+    while ( it.hasNext() ) {
+      QRegularExpressionMatch match = it.next();
+
+      newText += qtext.mid( pos, match.capturedStart() - pos );
+      pos = match.capturedEnd();
+
+      newText += match.captured( 2 ).replace( rxEscapedBR, "<br/>" ).prepend( match.captured( 1 ) ).append( "</a>" );
+    }
+    if ( pos ) {
+      newText += qtext.mid( pos );
+      text = newText.toStdString();
+    }
+  }
 
   // Fix outstanding elements
   text += "<br style=\"clear:both;\" />";
 
-  return text.toUtf8().data();
+  return text;
 }
 
 void ZimDictionary::loadResource( std::string & resourceName, string & data )
@@ -549,13 +556,18 @@ ZimDictionary::getSearchResults( QString const & searchString, int searchMode, b
 
 /// ZimDictionary::getArticle()
 
-class ZimArticleRequest: public Dictionary::DataRequest
+class ZimArticleRequest:
+  public Dictionary::DataRequest,
+  public ArticleAssembler::Assembler< ZimArticleRequest >
 {
   wstring word;
   vector< wstring > alts;
   ZimDictionary & dict;
   bool ignoreDiacritics;
 
+  // See Issue #271: A mechanism to clean-up invalid HTML cards.
+  string cleaner = Utils::Html::getHtmlCleaner();
+
   QAtomicInt isCancelled;
   QFuture< void > f;
 
@@ -574,6 +586,10 @@ public:
 
   void run();
 
+  bool loadArticle( WordArticleLink const &, ArticleAssembler::Article & );
+
+  void appendArticle( string & out, ArticleAssembler::Article const & );
+
   void cancel() override
   {
     isCancelled.ref();
@@ -593,105 +609,44 @@ void ZimArticleRequest::run()
     return;
   }
 
-  vector< WordArticleLink > chain = dict.findArticles( word, ignoreDiacritics );
-
-  for ( const auto & alt : alts ) {
-    /// Make an additional query for each alt
+  string result;
 
-    vector< WordArticleLink > altChain = dict.findArticles( alt, ignoreDiacritics );
+  if ( assemble( dict, word, alts, ignoreDiacritics, isCancelled, result ) ) {
+    appendString( std::move( result ) );
 
-    chain.insert( chain.end(), altChain.begin(), altChain.end() );
+    hasAnyData = true;
   }
 
-  multimap< wstring, pair< string, string > > mainArticles, alternateArticles;
-
-  set< quint32 > articlesIncluded; // Some synonyms make it that the articles
-                                   // appear several times. We combat this
-                                   // by only allowing them to appear once.
-
-  wstring wordCaseFolded = Folding::applySimpleCaseOnly( word );
-  if ( ignoreDiacritics )
-    wordCaseFolded = Folding::applyDiacriticsOnly( wordCaseFolded );
-
-  for ( auto & x : chain ) {
-    if ( Utils::AtomicInt::loadAcquire( isCancelled ) ) {
-      finish();
-      return;
-    }
-
-    // Now grab that article
-
-    string headword, articleText;
-
-    headword = x.word;
-
-    quint32 articleNumber = 0xFFFFFFFF;
-    try {
-      articleNumber = dict.loadArticle( x.articleOffset, articleText );
-    }
-    catch ( ... ) {
-    }
-
-    if ( articleNumber == 0xFFFFFFFF )
-      continue; // No article loaded
-
-    if ( articlesIncluded.find( articleNumber ) != articlesIncluded.end() )
-      continue; // We already have this article in the body.
-
-    // Ok. Now, does it go to main articles, or to alternate ones? We list
-    // main ones first, and alternates after.
-
-    // We do the case-folded comparison here.
-
-    wstring headwordStripped = Folding::applySimpleCaseOnly( headword );
-    if ( ignoreDiacritics )
-      headwordStripped = Folding::applyDiacriticsOnly( headwordStripped );
-
-    multimap< wstring, pair< string, string > > & mapToUse =
-      ( wordCaseFolded == headwordStripped ) ? mainArticles : alternateArticles;
-
-    mapToUse.insert( pair( Folding::applySimpleCaseOnly( headword ), pair( headword, articleText ) ) );
-
-    articlesIncluded.insert( articleNumber );
-  }
+  finish();
+}
 
-  if ( mainArticles.empty() && alternateArticles.empty() ) {
-    // No such word
-    finish();
-    return;
+bool ZimArticleRequest::loadArticle( WordArticleLink const & link, ArticleAssembler::Article & article )
+{
+  quint32 articleNumber = 0xFFFFFFFF;
+  try {
+    articleNumber = dict.loadArticle( link.articleOffset, article.text );
   }
-
-  string result;
-
-  // See Issue #271: A mechanism to clean-up invalid HTML cards.
-  string cleaner = Utils::Html::getHtmlCleaner();
-
-  multimap< wstring, pair< string, string > >::const_iterator i;
-
-
-  for ( i = mainArticles.begin(); i != mainArticles.end(); ++i ) {
-    result += "<div class=\"zimdict\">";
-    result += "<h2 class=\"zimdict_headword\">";
-    result += i->second.first;
-    result += "</h2>";
-    result += i->second.second;
-    result += cleaner + "</div>";
+  catch ( ... ) {
   }
 
-  for ( i = alternateArticles.begin(); i != alternateArticles.end(); ++i ) {
-    result += "<div class=\"zimdict\">";
-    result += "<h2 class=\"zimdict_headword\">";
-    result += i->second.first;
-    result += "</h2>";
-    result += i->second.second;
-    result += cleaner + "</div>";
-  }
+  if ( articleNumber == 0xFFFFFFFF )
+    return false; // No article loaded
 
-  appendString( result );
+  // Redirects lead different links to the same article
+  article.key = articleNumber;
 
-  hasAnyData = true;
+  return true;
+}
 
-  finish();
+void ZimArticleRequest::appendArticle( string & out, ArticleAssembler::Article const & article )
+{
+  out += "<div class=\"zimdict\">";
+  out += "<h2 class=\"zimdict_headword\">";
+  out += article.headword;
+  out += "</h2>";
+  out += article.text;
+  out += cleaner;
+  out += "</div>";
 }
 
 sptr< Dictionary::DataRequest > ZimDictionary::getArticle( wstring const & word,
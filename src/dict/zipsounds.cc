@@ -309,7 +309,7 @@ sptr< Dictionary::DataRequest > ZipSoundsDictionary::getArticle( wstring const &
   result += "</table>";
 
   auto ret = std::make_shared< Dictionary::DataRequestInstant >( true );
-  ret->appendString( result );
+  ret->appendString( std::move( result ) );
   return ret;
 }
 
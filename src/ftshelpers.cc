@@ -10,7 +10,15 @@
 #include "gddebug.hh"
 #include "folding.hh"
 #include "utils.hh"
+#include "langcoder.hh"
 
+#include <QDeadlineTimer>
+#include <QStringMatcher>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <atomic>
 #include <vector>
 #include <string>
 
@@ -23,6 +31,136 @@ namespace FtsHelpers {
 // finished  reversed   dehsinif
 const static std::string finish_mark = std::string( "dehsinif" );
 
+namespace {
+
+// The index's metadata key holding the language its terms were stemmed for,
+// or noStemmer. Xapian can't tell an empty value from a missing one, and the
+// indexes made before stemming have none.
+std::string const stemmerKey = "stemmer";
+std::string const noStemmer  = "none";
+
+/// Returns the language code Xapian has a stemmer for, judging by the
+/// dictionary's source language, or an empty string.
+std::string stemmerLanguage( BtreeIndexing::BtreeDictionary * dict )
+{
+  std::string const code = LangCoder::intToCode2( dict->getLangFrom() ).toStdString();
+
+  if ( code.empty() )
+    return {};
+
+  try {
+    Xapian::Stem const stem( code );
+    return code;
+  }
+  catch ( Xapian::InvalidArgumentError & ) {
+    return {}; // No stemmer for that language
+  }
+}
+
+// Without an index, the articles are scanned for at most that long
+int const scanTimeLimit = 10000; // ms
+
+// The number of articles a scanning thread takes at once
+int const scanBlockSize = 64;
+
+// The same as for the searches in the index
+int const maxScanResults = 100;
+
+/// Matches the article texts against the search string, for the searches
+/// without an index. In all the modes but RegExp, every word of the search
+/// string has to occur in the text, and the ones prefixed with '-' must not.
+/// Words in quotes are matched as a whole.
+class TextMatcher
+{
+public:
+  TextMatcher( QString const & searchString, int searchMode, bool matchCase );
+
+  bool isEmpty() const
+  {
+    return words.empty() && expressions.empty();
+  }
+
+  bool matches( QString const & text ) const
+  {
+    for ( auto const & word : words )
+      if ( word.indexIn( text ) < 0 )
+        return false;
+
+    for ( auto const & expression : expressions )
+      if ( !expression.match( text ).hasMatch() )
+        return false;
+
+    for ( auto const & word : excludedWords )
+      if ( word.indexIn( text ) >= 0 )
+        return false;
+
+    return true;
+  }
+
+private:
+  std::vector< QStringMatcher > words;
+  std::vector< QStringMatcher > excludedWords;
+  std::vector< QRegularExpression > expressions;
+};
+
+TextMatcher::TextMatcher( QString const & searchString, int searchMode, bool matchCase )
+{
+  Qt::CaseSensitivity const cs = matchCase ? Qt::CaseSensitive : Qt::CaseInsensitive;
+  QRegularExpression::PatternOptions const options =
+    QRegularExpression::UseUnicodePropertiesOption
+    | ( matchCase ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption );
+
+  if ( searchMode == FTS::RegExp ) {
+    QRegularExpression expression( searchString, options );
+    if ( expression.isValid() )
+      expressions.push_back( expression );
+    return;
+  }
+
+  static QRegularExpression const tokens( R"("([^"]*)"|(\S+))" );
+
+  for ( auto it = tokens.globalMatch( searchString ); it.hasNext(); ) {
+    auto const match = it.next();
+
+    QString word = match.captured( 1 );
+    bool excluded = false;
+
+    if ( match.capturedLength( 2 ) ) {
+      word = match.captured( 2 );
+
+      // The operators of the query syntax
+      if ( word.compare( "AND", Qt::CaseInsensitive ) == 0 || word.compare( "OR", Qt::CaseInsensitive ) == 0 )
+        continue;
+
+      excluded = word.size() > 1 && word.startsWith( '-' );
+      if ( excluded || word.startsWith( '+' ) )
+        word.remove( 0, 1 );
+    }
+
+    if ( word.isEmpty() )
+      continue;
+
+    if ( searchMode == FTS::Wildcards && ( word.contains( '*' ) || word.contains( '?' ) ) ) {
+      QString pattern = QRegularExpression::escape( word );
+      pattern.replace( "\\*", "\\w*" ).replace( "\\?", "\\w" );
+      expressions.emplace_back( pattern, options );
+      continue;
+    }
+
+    ( excluded ? excludedWords : words ).emplace_back( word, cs );
+  }
+}
+
+/// The scans get their own threads, since the searches waiting for them
+/// already run in the global pool.
+QThreadPool & scanThreadPool()
+{
+  static QThreadPool pool;
+  return pool;
+}
+
+} // namespace
+
 bool ftsIndexIsOldOrBad( BtreeIndexing::BtreeDictionary * dict )
 {
   try {
@@ -30,9 +168,13 @@ bool ftsIndexIsOldOrBad( BtreeIndexing::BtreeDictionary * dict )
     auto docid    = db.get_lastdocid();
     auto document = db.get_document( docid );
 
-    string const lastDoc   = document.get_data();
-    return lastDoc != finish_mark;
     //use a special document to mark the end of the index.
+    string const lastDoc   = document.get_data();
+    if ( lastDoc != finish_mark )
+      return true;
+
+    // Made before stemming was introduced, so the stems aren't there
+    return db.get_metadata( stemmerKey ).empty();
   }
   catch ( Xapian::Error & e ) {
     qWarning() << e.get_description().c_str();
@@ -60,12 +202,31 @@ void makeFTSIndex( BtreeIndexing::BtreeDictionary * dict, QAtomicInt & isCancell
     // Open the database for update, creating a new database if necessary.
     Xapian::WritableDatabase db( dict->ftsIndexName() + "_temp", Xapian::DB_CREATE_OR_OPEN );
 
+    // An interrupted index started before stemming was introduced is started over
+    if ( db.get_lastdocid() != 0 && db.get_metadata( stemmerKey ).empty() ) {
+      db.close();
+      db = Xapian::WritableDatabase( dict->ftsIndexName() + "_temp", Xapian::DB_CREATE_OR_OVERWRITE );
+    }
+
     Xapian::TermGenerator indexer;
-    //  Xapian::Stem stemmer("english");
-    //  indexer.set_stemmer(stemmer);
-    //  indexer.set_stemming_strategy(indexer.STEM_SOME_FULL_POS);
     indexer.set_flags( Xapian::TermGenerator::FLAG_CJK_NGRAM );
 
+    // Index the stems of the words as well, so e.g. "running" is found by
+    // "run". The language is recorded for the queries to be stemmed the same
+    // way; an interrupted index goes on with the language it was started with.
+    std::string language = db.get_metadata( stemmerKey );
+    if ( db.get_lastdocid() == 0 ) {
+      language = stemmerLanguage( dict );
+      if ( language.empty() )
+        language = noStemmer;
+      db.set_metadata( stemmerKey, language );
+    }
+
+    if ( language != noStemmer ) {
+      indexer.set_stemmer( Xapian::Stem( language ) );
+      indexer.set_stemming_strategy( Xapian::TermGenerator::STEM_SOME );
+    }
+
     BtreeIndexing::IndexedWords indexedWords;
 
     QSet< uint32_t > setOfOffsets;
@@ -195,6 +356,12 @@ void FTSResultsRequest::run()
       Xapian::QueryParser qp;
       qp.set_database( db );
       qp.set_default_op( Xapian::Query::op::OP_AND );
+
+      if ( std::string const language = db.get_metadata( stemmerKey );
+           !language.empty() && language != noStemmer ) {
+        qp.set_stemmer( Xapian::Stem( language ) );
+        qp.set_stemming_strategy( Xapian::QueryParser::STEM_SOME );
+      }
       int flag =
         Xapian::QueryParser::FLAG_DEFAULT | Xapian::QueryParser::FLAG_PURE_NOT | Xapian::QueryParser::FLAG_CJK_NGRAM;
       if ( searchMode == FTS::Wildcards ) {
@@ -232,18 +399,13 @@ void FTSResultsRequest::run()
       }
     }
     else {
-      //if no fulltext index,just returned.
-      qWarning() << "There is no fulltext index right now.";
-      finish();
-      return;
+      // No index yet, look through the articles themselves
+      runScan();
     }
 
     if ( foundHeadwords && !foundHeadwords->empty() ) {
-      QMutexLocker _( &dataMutex );
-      data.resize( sizeof( foundHeadwords ) );
-      memcpy( &data.front(), &foundHeadwords, sizeof( foundHeadwords ) );
+      publish( foundHeadwords );
       foundHeadwords = nullptr;
-      hasAnyData     = true;
     }
   }
   catch ( const Xapian::Error & e ) {
@@ -257,4 +419,125 @@ void FTSResultsRequest::run()
   finish();
 }
 
+void FTSResultsRequest::runScan()
+{
+  TextMatcher const matcher( searchString, searchMode, matchCase );
+
+  if ( matcher.isEmpty() )
+    return;
+
+  // Collecting the articles of a large dictionary takes a while too, so the
+  // time limit covers it as well
+  QDeadlineTimer const deadline( scanTimeLimit );
+
+  QSet< uint32_t > setOfOffsets;
+  dict.findArticleLinks( nullptr, &setOfOffsets, nullptr, &isCancelled, deadline );
+
+  // In the order of storage, so the reads go forward
+  std::vector< uint32_t > offsets( setOfOffsets.begin(), setOfOffsets.end() );
+  setOfOffsets.clear();
+  std::sort( offsets.begin(), offsets.end() );
+
+  std::atomic< size_t > nextOffset{ 0 };
+  std::atomic< int > foundCount{ 0 };
+
+  QMutex foundMutex;
+  QWaitCondition foundCondition;
+  QList< uint32_t > found;
+
+  auto scan = [ & ]() {
+    while ( !Utils::AtomicInt::loadAcquire( isCancelled ) && !deadline.hasExpired()
+            && foundCount.load() < maxScanResults ) {
+      size_t const begin = nextOffset.fetch_add( scanBlockSize );
+      if ( begin >= offsets.size() )
+        return;
+
+      size_t const end = qMin( begin + scanBlockSize, offsets.size() );
+
+      QList< uint32_t > matched;
+      QString headword, text;
+
+      for ( size_t x = begin; x < end; ++x ) {
+        try {
+          dict.getArticleText( offsets[ x ], headword, text );
+        }
+        catch ( std::exception & ) {
+          continue;
+        }
+
+        if ( matcher.matches( text ) )
+          matched.append( offsets[ x ] );
+      }
+
+      if ( !matched.isEmpty() ) {
+        QMutexLocker _( &foundMutex );
+        found += matched;
+        foundCount += matched.size();
+        foundCondition.wakeOne();
+      }
+    }
+  };
+
+  auto & pool           = scanThreadPool();
+  int const threadCount = qMax( 1, pool.maxThreadCount() );
+
+  QList< QFuture< void > > scans;
+  for ( int x = 0; x < threadCount; ++x )
+    scans.append( QtConcurrent::run( &pool, scan ) );
+
+  // The results are passed on as they are found
+  int published = 0;
+
+  for ( bool done = false; !done; ) {
+    done = std::all_of( scans.begin(), scans.end(), []( QFuture< void > const & f ) {
+      return f.isFinished();
+    } );
+
+    QList< uint32_t > batch;
+    {
+      QMutexLocker _( &foundMutex );
+      if ( !done && found.isEmpty() )
+        foundCondition.wait( &foundMutex, 100 );
+      batch.swap( found );
+    }
+
+    if ( batch.size() > maxScanResults - published )
+      batch = batch.mid( 0, maxScanResults - published );
+
+    if ( batch.isEmpty() || Utils::AtomicInt::loadAcquire( isCancelled ) )
+      continue;
+
+    QVector< QString > headwords;
+    dict.getHeadwordsFromOffsets( batch, headwords, &isCancelled );
+
+    auto * list      = new QList< FTS::FtsHeadword >;
+    QString const id = QString::fromUtf8( dict.getId().c_str() );
+    for ( auto const & headword : headwords )
+      list->append( FTS::FtsHeadword( headword, id, QStringList(), matchCase ) );
+
+    published += batch.size();
+    publish( list );
+  }
+
+  if ( deadline.hasExpired() )
+    qDebug() << "FTS: scanning" << dict.getName().c_str() << "without an index was stopped after"
+             << scanTimeLimit << "ms";
+
+  emit matchCount( published );
+}
+
+void FTSResultsRequest::publish( QList< FTS::FtsHeadword > * headwords )
+{
+  {
+    QMutexLocker _( &dataMutex );
+    size_t const offset = data.size();
+    data.resize( offset + sizeof( headwords ) );
+    memcpy( &data[ offset ], &headwords, sizeof( headwords ) );
+    batches.emplace_back( headwords );
+    hasAnyData = true;
+  }
+
+  update();
+}
+
 } // namespace FtsHelpers
@@ -9,6 +9,8 @@
 #endif
 #include <QList>
 #include <QtConcurrent>
+#include <memory>
+#include <vector>
 
 #include "dict/dictionary.hh"
 #include "btreeidx.hh"
@@ -37,6 +39,18 @@ class FTSResultsRequest: public Dictionary::DataRequest
 
   QList< FTS::FtsHeadword > * foundHeadwords;
 
+  // The published batches, freed along with the request whether they were
+  // taken or not
+  std::vector< std::unique_ptr< QList< FTS::FtsHeadword > > > batches;
+
+  /// Scans the article texts when there's no index to search in yet.
+  void runScan();
+
+  /// Hands the headwords over to the requester. The data is an array of
+  /// pointers to such lists, one per batch. The requester takes the headwords
+  /// out of them, but the lists stay owned by the request.
+  void publish( QList< FTS::FtsHeadword > * headwords );
+
 public:
 
   FTSResultsRequest( BtreeIndexing::BtreeDictionary & dict_,
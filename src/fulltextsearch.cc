@@ -2,6 +2,7 @@
  * Part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
 
 #include "fulltextsearch.hh"
+#include "articleprefetch.hh"
 #include "ftshelpers.hh"
 #include "gddebug.hh"
 #include "help.hh"
@@ -241,6 +242,10 @@ FullTextSearchDialog::FullTextSearchDialog( QWidget * parent,
   ui.articlesFoundLabel->setText( tr( "Articles found: " ) + "0" );
 
   connect( ui.headwordsView, &QAbstractItemView::clicked, this, &FullTextSearchDialog::itemClicked );
+  connect( ui.headwordsView->selectionModel(),
+           &QItemSelectionModel::currentChanged,
+           this,
+           &FullTextSearchDialog::prefetchAround );
 
   connect( this, &QDialog::finished, this, &FullTextSearchDialog::saveData );
 
@@ -274,6 +279,8 @@ void FullTextSearchDialog::setSearchText( const QString & text )
 
 FullTextSearchDialog::~FullTextSearchDialog()
 {
+  ArticlePrefetch::cancel();
+
   if ( delegate )
     delegate->deleteLater();
 }
@@ -350,11 +357,9 @@ void FullTextSearchDialog::accept()
   ui.OKButton->setEnabled( false );
   ui.searchProgressBar->show();
 
-  // Make search requests
+  // Make search requests. The dictionaries not indexed yet are searched
+  // through without an index, which is slower and limited in time.
   for ( unsigned x = 0; x < activeDicts.size(); ++x ) {
-    if ( !activeDicts[ x ]->haveFTSIndex() ) {
-      continue;
-    }
     //max results=100
     sptr< Dictionary::DataRequest > req =
       activeDicts[ x ]->getSearchResults( ui.searchLine->text(), mode, false, false );
@@ -364,6 +369,12 @@ void FullTextSearchDialog::accept()
              &FullTextSearchDialog::searchReqFinished,
              Qt::QueuedConnection );
 
+    connect( req.get(),
+             &Dictionary::Request::updated,
+             this,
+             &FullTextSearchDialog::searchReqFinished,
+             Qt::QueuedConnection );
+
     connect( req.get(),
              &Dictionary::Request::matchCount,
              this,
@@ -376,44 +387,46 @@ void FullTextSearchDialog::accept()
   searchReqFinished(); // Handle any ones which have already finished
 }
 
+void FullTextSearchDialog::takeResults( Dictionary::DataRequest & req, QList< FtsHeadword > & allHeadwords )
+{
+  size_t & taken = takenBatches[ &req ];
+  QList< FtsHeadword > * headwords;
+
+  while ( req.dataSize() >= (long)( ( taken + 1 ) * sizeof( headwords ) ) ) {
+    QList< FtsHeadword > hws;
+    try {
+      req.getDataSlice( taken * sizeof( headwords ), sizeof( headwords ), &headwords );
+      ++taken;
+      hws.swap( *headwords ); // The list itself is freed by the request
+      std::sort( hws.begin(), hws.end() );
+      addSortedHeadwords( allHeadwords, hws );
+    }
+    catch ( std::exception & e ) {
+      gdWarning( "getDataSlice error: %s\n", e.what() );
+      break;
+    }
+  }
+}
+
 void FullTextSearchDialog::searchReqFinished()
 {
   QList< FtsHeadword > allHeadwords;
-  while ( searchReqs.size() ) {
-    std::list< sptr< Dictionary::DataRequest > >::iterator it;
-    for ( it = searchReqs.begin(); it != searchReqs.end(); ++it ) {
-      if ( ( *it )->isFinished() ) {
-        GD_DPRINTF( "one finished.\n" );
-
-        QString errorString = ( *it )->getErrorString();
-
-        if ( ( *it )->dataSize() >= 0 || errorString.size() ) {
-          QList< FtsHeadword > * headwords;
-          if ( (unsigned)( *it )->dataSize() >= sizeof( headwords ) ) {
-            QList< FtsHeadword > hws;
-            try {
-              ( *it )->getDataSlice( 0, sizeof( headwords ), &headwords );
-              hws.swap( *headwords );
-              std::sort( hws.begin(), hws.end() );
-              delete headwords;
-              addSortedHeadwords( allHeadwords, hws );
-            }
-            catch ( std::exception & e ) {
-              gdWarning( "getDataSlice error: %s\n", e.what() );
-            }
-          }
-        }
-        break;
-      }
-    }
-    if ( it != searchReqs.end() ) {
-      GD_DPRINTF( "erasing..\n" );
-      searchReqs.erase( it );
-      GD_DPRINTF( "erase done..\n" );
-      continue;
+
+  // The searches without an index pass their results on in several batches,
+  // so the unfinished requests are looked into as well
+  for ( auto it = searchReqs.begin(); it != searchReqs.end(); ) {
+    // Checked first, so nothing added before it finished could be missed
+    bool const finished = ( *it )->isFinished();
+
+    takeResults( **it, allHeadwords );
+
+    if ( finished ) {
+      GD_DPRINTF( "one finished.\n" );
+      takenBatches.erase( it->get() );
+      it = searchReqs.erase( it );
     }
     else
-      break;
+      ++it;
   }
 
   if ( !allHeadwords.isEmpty() ) {
@@ -480,6 +493,32 @@ void FullTextSearchDialog::itemClicked( const QModelIndex & idx )
   }
 }
 
+void FullTextSearchDialog::prefetchAround( QModelIndex const & idx )
+{
+  if ( !idx.isValid() )
+    return;
+
+  QList< ArticlePrefetch::Item > items;
+
+  // The result itself first, then the following ones and the preceding one
+  for ( int row : { idx.row(), idx.row() + 1, idx.row() + 2, idx.row() + 3, idx.row() - 1 } ) {
+    if ( row < 0 || row >= results.size() )
+      continue;
+
+    for ( auto const & dictId : results[ row ].dictIDs ) {
+      for ( auto const & dict : activeDicts ) {
+        if ( dictId == QString::fromStdString( dict->getId() ) ) {
+          items.append( ArticlePrefetch::Item{ dict.get(), results[ row ].headword } );
+          break;
+        }
+      }
+    }
+  }
+
+  // The results are shown without diacritics ignored
+  ArticlePrefetch::prefetch( items, false );
+}
+
 void FullTextSearchDialog::updateDictionaries()
 {
   activeDicts.clear();
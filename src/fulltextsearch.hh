@@ -9,6 +9,7 @@
 #include <QRunnable>
 #include <QSemaphore>
 #include <QStringList>
+#include <map>
 
 #if ( QT_VERSION >= QT_VERSION_CHECK( 6, 0, 0 ) )
   #include <QtCore5Compat/QRegExp>
@@ -210,6 +211,9 @@ class FullTextSearchDialog: public QDialog
 
   std::list< sptr< Dictionary::DataRequest > > searchReqs;
 
+  // How many batches of results were taken from each of the requests
+  std::map< Dictionary::DataRequest *, size_t > takenBatches;
+
   FtsIndexing & ftsIdx;
 
   QRegExp searchRegExp;
@@ -245,6 +249,9 @@ private:
 
   void showDictNumbers();
 
+  /// Adds the batches of results the request has got since the last call.
+  void takeResults( Dictionary::DataRequest & req, QList< FtsHeadword > & headwords );
+
 private slots:
   void setNewIndexingName( QString );
   void saveData();
@@ -253,6 +260,9 @@ private slots:
   void matchCount( int );
   void reject();
   void itemClicked( QModelIndex const & idx );
+  /// Prefetches the articles of the result and the ones around it, which are
+  /// likely to be looked at next.
+  void prefetchAround( QModelIndex const & idx );
   void updateDictionaries();
 
 signals:
@@ -1,4 +1,5 @@
 #include "headwordsmodel.hh"
+#include "langcoder.hh"
 #include "wstring_qt.hh"
 
 HeadwordListModel::HeadwordListModel( QObject * parent ):
@@ -193,3 +194,61 @@ void HeadwordListModel::setDict( Dictionary::Class * dict )
   _dict     = dict;
   totalSize = _dict->getWordCount();
 }
+
+HeadwordSortProxy::HeadwordSortProxy( QObject * parent ):
+  QSortFilterProxyModel( parent ),
+  collator( LangCoder::collator( 0 ) )
+{
+}
+
+void HeadwordSortProxy::setLanguage( quint32 language )
+{
+  collator = LangCoder::collator( language );
+  dropKeys();
+}
+
+void HeadwordSortProxy::setSourceModel( QAbstractItemModel * model )
+{
+  if ( sourceModel() )
+    disconnect( sourceModel(), nullptr, this, nullptr );
+
+  dropKeys();
+
+  // The rows are only ever appended, which leaves the keys made so far valid
+  if ( model ) {
+    connect( model, &QAbstractItemModel::modelReset, this, &HeadwordSortProxy::dropKeys );
+    connect( model, &QAbstractItemModel::layoutChanged, this, &HeadwordSortProxy::dropKeys );
+    connect( model, &QAbstractItemModel::dataChanged, this, &HeadwordSortProxy::dropKeys );
+    connect( model, &QAbstractItemModel::rowsRemoved, this, &HeadwordSortProxy::dropKeys );
+    connect( model, &QAbstractItemModel::rowsInserted, this, [ this ]( QModelIndex const &, int first, int ) {
+      if ( (size_t)first < keys.size() )
+        dropKeys();
+    } );
+  }
+
+  QSortFilterProxyModel::setSourceModel( model );
+}
+
+bool HeadwordSortProxy::lessThan( const QModelIndex & left, const QModelIndex & right ) const
+{
+  // Made room for all the keys first, so the references stay valid
+  if ( keys.size() < (size_t)sourceModel()->rowCount() )
+    keys.resize( sourceModel()->rowCount() );
+
+  return sortKey( left ).compare( sortKey( right ) ) < 0;
+}
+
+QCollatorSortKey const & HeadwordSortProxy::sortKey( const QModelIndex & index ) const
+{
+  size_t const row = index.row();
+
+  if ( !keys[ row ] )
+    keys[ row ] = collator.sortKey( index.data( sortRole() ).toString() );
+
+  return *keys[ row ];
+}
+
+void HeadwordSortProxy::dropKeys()
+{
+  keys.clear();
+}
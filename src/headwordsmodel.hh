@@ -4,7 +4,11 @@
 #include "dict/dictionary.hh"
 
 #include <QAbstractListModel>
+#include <QCollator>
+#include <QSortFilterProxyModel>
 #include <QStringList>
+#include <optional>
+#include <vector>
 
 class HeadwordListModel: public QAbstractListModel
 {
@@ -51,4 +55,34 @@ private:
   std::list< sptr< Dictionary::WordSearchRequest > > queuedRequests;
 };
 
+/// Sorts the headwords the way the dictionary's language does. The collation
+/// key of each headword is made at runtime, on the first sort, and cached, so
+/// sorting only compares the keys rather than running the collator for every
+/// comparison. The keys aren't stored in the index, as they depend on the
+/// collator's version and are only valid for the locale they were made for.
+class HeadwordSortProxy: public QSortFilterProxyModel
+{
+  Q_OBJECT
+
+public:
+  explicit HeadwordSortProxy( QObject * parent = nullptr );
+
+  /// Sets the language to sort for, as given by LangCoder.
+  void setLanguage( quint32 language );
+
+  void setSourceModel( QAbstractItemModel * model ) override;
+
+protected:
+  bool lessThan( const QModelIndex & left, const QModelIndex & right ) const override;
+
+private:
+  QCollatorSortKey const & sortKey( const QModelIndex & index ) const;
+
+  /// Drops the keys, once the rows they were made for might have changed.
+  void dropKeys();
+
+  QCollator collator;
+  mutable std::vector< std::optional< QCollatorSortKey > > keys; // By the source rows
+};
+
 #endif // HEADWORDSMODEL_H
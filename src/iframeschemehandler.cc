@@ -1,11 +1,240 @@
 #include "iframeschemehandler.hh"
+#include "config.hh"
 
 #include <QTextCodec>
+#include <QDir>
+#include <QNetworkDiskCache>
+
+namespace {
+
+/// Hands the page over to the web engine piece by piece, as it arrives.
+class IframeStream: public QIODevice
+{
+public:
+  explicit IframeStream( QObject * parent ):
+    QIODevice( parent )
+  {
+    open( QIODevice::ReadOnly );
+  }
+
+  bool isSequential() const override
+  {
+    return true;
+  }
+
+  qint64 bytesAvailable() const override
+  {
+    return buffer.size() - readPos + QIODevice::bytesAvailable();
+  }
+
+  bool atEnd() const override
+  {
+    return finished && bytesAvailable() == 0;
+  }
+
+  void append( QByteArray const & data )
+  {
+    if ( data.isEmpty() )
+      return;
+
+    buffer.append( data );
+    emit readyRead();
+  }
+
+  void finish()
+  {
+    finished = true;
+    emit readChannelFinished();
+  }
+
+protected:
+  qint64 readData( char * data, qint64 maxSize ) override
+  {
+    qint64 const size = qMin( maxSize, (qint64)buffer.size() - readPos );
+
+    if ( size <= 0 )
+      return finished ? -1 : 0;
+
+    memcpy( data, buffer.constData() + readPos, size );
+    readPos += size;
+
+    // Drop what was read once it's most of the buffer
+    if ( readPos * 2 > buffer.size() ) {
+      buffer.remove( 0, readPos );
+      readPos = 0;
+    }
+
+    return size;
+  }
+
+  qint64 writeData( char const *, qint64 ) override
+  {
+    return -1;
+  }
+
+private:
+  QByteArray buffer;
+  qint64 readPos = 0;
+  bool finished  = false;
+};
+
+// The head is normally small; if its end doesn't show up by then, the page is
+// passed on with whatever was found up to there.
+int const maxHeadSize = 256 * 1024;
+
+QString const locationText        = "window.location";
+QString const locationReplacement = "window.location;_window_location";
+
+} // namespace
+
+IframeHeadRewriter::IframeHeadRewriter( QUrl const & url_ ):
+  url( url_ )
+{
+}
+
+QString IframeHeadRewriter::feed( QString const & text )
+{
+  if ( headDone )
+    return replaceLocation( text, false );
+
+  static QRegularExpression const headEnd( R"(</head\s*>|<body\b)", QRegularExpression::CaseInsensitiveOption );
+
+  // The end of the head could have been split between the pieces
+  int const from = qMax( 0, (int)head.size() - 16 );
+
+  head += text;
+
+  if ( head.size() < maxHeadSize && !headEnd.match( head, from ).hasMatch() )
+    return {};
+
+  headDone = true;
+
+  QString result = replaceLocation( rewriteHead( head ), false );
+  head.clear();
+
+  return result;
+}
+
+QString IframeHeadRewriter::finish()
+{
+  if ( !headDone ) {
+    headDone = true;
+    carry    = rewriteHead( head );
+    head.clear();
+  }
+
+  return replaceLocation( QString(), true );
+}
+
+QString IframeHeadRewriter::rewriteHead( QString html ) const
+{
+  static QRegularExpression const baseTag( R"EOF(<base\s+href=["'](.*?)["'].*?>)EOF",
+                                           QRegularExpression::CaseInsensitiveOption
+                                             | QRegularExpression::DotMatchesEverythingOption );
+
+  static QRegularExpression const headTag( R"(<head\b.*?>)",
+                                           QRegularExpression::CaseInsensitiveOption
+                                             | QRegularExpression::DotMatchesEverythingOption );
+
+  // Change links from relative to absolute
+
+  QString root = url.scheme() + "://" + url.host();
+
+  if ( url.port() != 80 && url.port() != 443 && url.port() != -1 ) {
+    root = root + ":" + QString::number( url.port() );
+  }
+  QString base = root + url.path();
+
+  if ( const auto match = baseTag.match( html ); match.hasMatch() ) {
+    base = url.resolved( match.captured( 1 ) ).url();
+  }
+
+  QString baseTagHtml = QString( R"(<base href="%1">)" ).arg( base );
+
+  QString depressionFocus =
+    R"(<script type="application/javascript"> HTMLElement.prototype.focus=function(){console.log("focus() has been disabled.");}</script>
+<script type="text/javascript" src="qrc:///scripts/iframeResizer.contentWindow.min.js">
+</script><script type="text/javascript" src="qrc:///scripts/iframe-defer.js"></script>)";
+
+  html.remove( baseTag );
+
+  auto match = headTag.match( html );
+  if ( match.hasMatch() ) {
+    html.insert( match.capturedEnd(), baseTagHtml );
+    html.insert( match.capturedEnd(), depressionFocus );
+  }
+  else {
+    // the html contain no head element
+    // just insert at the beginning of the html ,and leave it at the mercy of browser(chrome webengine)
+    html.insert( 0, baseTagHtml );
+    html.insert( 0, depressionFocus );
+  }
+
+  return html;
+}
+
+QString IframeHeadRewriter::replaceLocation( QString const & text, bool last )
+{
+  QString const input = carry + text;
+  QString result;
+  int from = 0;
+
+  for ( int pos; ( pos = input.indexOf( locationText, from ) ) != -1; from = pos + locationText.size() ) {
+    result += QStringView( input ).mid( from, pos - from );
+    result += locationReplacement;
+  }
+
+  // Only a tail shorter than the text searched for could be the start of it
+  int keep = last ? 0 : qMin( (int)locationText.size() - 1, (int)input.size() - from );
+
+  // Don't split a surrogate pair either
+  if ( !last && keep < input.size() - from && input[ input.size() - keep - 1 ].isHighSurrogate() )
+    ++keep;
+
+  result += QStringView( input ).mid( from, input.size() - from - keep );
+  carry = input.right( keep );
+
+  return result;
+}
 
 IframeSchemeHandler::IframeSchemeHandler( QObject * parent ):
   QWebEngineUrlSchemeHandler( parent )
 {
 }
+
+namespace {
+
+QString cacheDir()
+{
+  // A directory of its own, since a disk cache can't share one
+  return Config::getCacheDir() + "/iframes";
+}
+
+} // namespace
+
+void IframeSchemeHandler::setupCache( qint64 maxSizeInBytes )
+{
+  if ( auto * diskCache = qobject_cast< QNetworkDiskCache * >( mgr.cache() ) ) {
+    diskCache->setMaximumCacheSize( maxSizeInBytes );
+    return;
+  }
+  if ( maxSizeInBytes == 0 )
+    return;
+
+  auto * diskCache = new QNetworkDiskCache( this );
+  diskCache->setMaximumCacheSize( maxSizeInBytes );
+  diskCache->setCacheDirectory( cacheDir() );
+  mgr.setCache( diskCache );
+}
+
+void IframeSchemeHandler::clearCache()
+{
+  if ( QAbstractNetworkCache * cache = mgr.cache() )
+    cache->clear();
+  else
+    QDir( cacheDir() ).removeRecursively();
+}
+
 void IframeSchemeHandler::requestStarted( QWebEngineUrlRequestJob * requestJob )
 {
   QUrl url = requestJob->requestUrl();
@@ -16,103 +245,91 @@ void IframeSchemeHandler::requestStarted( QWebEngineUrlRequestJob * requestJob )
   request.setUrl( url );
   request.setAttribute( QNetworkRequest::RedirectPolicyAttribute,
                         QNetworkRequest::RedirectPolicy::NoLessSafeRedirectPolicy );
+  // Fresh cached pages are used as they are, stale ones are revalidated with
+  // their ETag or Last-Modified
+  request.setAttribute( QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferNetwork );
 
   QNetworkReply * reply = mgr.get( request );
 
-  auto finishAction = [ = ]() {
-    QByteArray contentType = "text/html";
-    QString codecName;
-    const auto ctHeader = reply->header( QNetworkRequest::ContentTypeHeader );
-    if ( ctHeader.isValid() ) {
-      contentType      = ctHeader.toByteArray();
-      const auto ct    = ctHeader.toString();
-      const auto index = ct.indexOf( "charset=" );
-      if ( index > -1 ) {
-        codecName = ct.mid( index + 8 );
-      }
-    }
-    auto buffer = new QBuffer( requestJob );
-
-    QByteArray replyData = reply->readAll();
-    QString articleString;
-
-    QTextCodec * codec = QTextCodec::codecForUtfText( replyData, QTextCodec::codecForName( codecName.toUtf8() ) );
-    if ( codec )
-      articleString = codec->toUnicode( replyData );
-    else
-      articleString = QString::fromUtf8( replyData );
-    // Handle reply data
-    // 404 response may have response body.
-    if ( reply->error() != QNetworkReply::NoError && articleString.isEmpty() ) {
-      if ( reply->error() == QNetworkReply::ContentNotFoundError ) {
-        buffer->deleteLater();
-        //work around to fix QTBUG-106573
-        requestJob->redirect( url );
-        return;
-      }
-      QString emptyHtml = QString( "<html><body>%1</body></html>" ).arg( reply->errorString() );
-      buffer->setData( emptyHtml.toUtf8() );
-      requestJob->reply( contentType, buffer );
-      return;
-    }
+  // What the reply's handlers share
+  struct State
+  {
+    IframeStream * stream = nullptr;
+    std::unique_ptr< QTextDecoder > decoder;
+    std::unique_ptr< IframeHeadRewriter > rewriter;
+  };
 
-    // Change links from relative to absolute
+  auto state = std::make_shared< State >();
 
-    QString root = reply->url().scheme() + "://" + reply->url().host();
+  auto replyHeaders = []( QByteArray const & contentType ) {
+#if QT_VERSION >= QT_VERSION_CHECK( 6, 0, 0 )
+    Q_UNUSED( contentType )
+    return QByteArray( "text/html; charset=utf-8" );
+#else
+  #if defined( Q_OS_WIN32 ) || defined( Q_OS_MAC )
+    return contentType;
+  #else
+    return QByteArray( "text/html" );
+  #endif
+#endif
+  };
 
-    if ( reply->url().port() != 80 && reply->url().port() != 443 && reply->url().port() != -1 ) {
-      root = root + ":" + QString::number( reply->url().port() );
-    }
-    QString base = root + reply->url().path();
+  // The reply to the web engine starts as soon as the first data arrives
+  auto readAction = [ = ]() {
+    QByteArray const data = reply->readAll();
+    if ( data.isEmpty() )
+      return;
 
+    if ( !state->stream ) {
+      QByteArray contentType = "text/html";
+      QString codecName;
+      const auto ctHeader = reply->header( QNetworkRequest::ContentTypeHeader );
+      if ( ctHeader.isValid() ) {
+        contentType      = ctHeader.toByteArray();
+        const auto ct    = ctHeader.toString();
+        const auto index = ct.indexOf( "charset=" );
+        if ( index > -1 ) {
+          codecName = ct.mid( index + 8 );
+        }
+      }
 
-    QRegularExpression baseTag( R"EOF(<base\s+href=["'](.*?)["'].*?>)EOF",
-                                QRegularExpression::CaseInsensitiveOption
-                                  | QRegularExpression::DotMatchesEverythingOption );
+      QTextCodec * codec = QTextCodec::codecForUtfText( data, QTextCodec::codecForName( codecName.toUtf8() ) );
+      if ( !codec )
+        codec = QTextCodec::codecForName( "UTF-8" );
 
+      state->decoder.reset( codec->makeDecoder() );
+      state->rewriter = std::make_unique< IframeHeadRewriter >( reply->url() );
+      state->stream   = new IframeStream( requestJob );
 
-    if ( const auto match = baseTag.match( articleString ); match.hasMatch() ) {
-      base = reply->url().resolved( match.captured( 1 ) ).url();
+      requestJob->reply( replyHeaders( contentType ), state->stream );
     }
 
-    QString baseTagHtml = QString( R"(<base href="%1">)" ).arg( base );
-
-    QString depressionFocus =
-      R"(<script type="application/javascript"> HTMLElement.prototype.focus=function(){console.log("focus() has been disabled.");}</script>
-<script type="text/javascript" src="qrc:///scripts/iframeResizer.contentWindow.min.js">
-</script><script type="text/javascript" src="qrc:///scripts/iframe-defer.js"></script>)";
-
-    articleString.remove( baseTag );
+    state->stream->append( state->rewriter->feed( state->decoder->toUnicode( data ) ).toUtf8() );
+  };
 
-    articleString.replace( "window.location", "window.location;_window_location" );
+  auto finishAction = [ = ]() {
+    readAction();
 
-    QRegularExpression headTag( R"(<head\b.*?>)",
-                                QRegularExpression::CaseInsensitiveOption
-                                  | QRegularExpression::DotMatchesEverythingOption );
-    auto match = headTag.match( articleString );
-    if ( match.hasMatch() ) {
-      articleString.insert( match.capturedEnd(), baseTagHtml );
-      articleString.insert( match.capturedEnd(), depressionFocus );
-    }
-    else {
-      // the html contain no head element
-      // just insert at the beginning of the html ,and leave it at the mercy of browser(chrome webengine)
-      articleString.insert( 0, baseTagHtml );
-      articleString.insert( 0, depressionFocus );
+    if ( state->stream ) {
+      state->stream->append( state->rewriter->finish().toUtf8() );
+      state->stream->finish();
+      return;
     }
 
-    buffer->setData( articleString.toUtf8() );
+    // No body at all
+    if ( reply->error() == QNetworkReply::ContentNotFoundError ) {
+      //work around to fix QTBUG-106573
+      requestJob->redirect( url );
+      return;
+    }
 
-#if QT_VERSION >= QT_VERSION_CHECK( 6, 0, 0 )
-    requestJob->reply( "text/html; charset=utf-8", buffer );
-#else
-  #if defined( Q_OS_WIN32 ) || defined( Q_OS_MAC )
-    requestJob->reply( contentType, buffer );
-  #else
-    requestJob->reply( "text/html", buffer );
-  #endif
-#endif
+    auto buffer = new QBuffer( requestJob );
+    if ( reply->error() != QNetworkReply::NoError )
+      buffer->setData( QString( "<html><body>%1</body></html>" ).arg( reply->errorString() ).toUtf8() );
+    requestJob->reply( replyHeaders( "text/html" ), buffer );
   };
+
+  connect( reply, &QNetworkReply::readyRead, requestJob, readAction );
   connect( reply, &QNetworkReply::finished, requestJob, finishAction );
 
   connect( requestJob, &QObject::destroyed, reply, &QObject::deleteLater );
@@ -3,6 +3,33 @@
 
 #include "article_netmgr.hh"
 
+/// Rewrites a website page on the fly, as it's being downloaded: the text is
+/// held back only until the end of the head shows up, then the <base> tag and
+/// the helper scripts are put into the head, and the rest passes through.
+class IframeHeadRewriter
+{
+public:
+  explicit IframeHeadRewriter( QUrl const & url );
+
+  /// Takes the next piece of the page, returns the text which is ready to go.
+  QString feed( QString const & text );
+
+  /// Returns whatever was still held back.
+  QString finish();
+
+private:
+  QString rewriteHead( QString html ) const;
+
+  /// Disables window.location, keeping back the tail which could be the
+  /// beginning of it.
+  QString replaceLocation( QString const & text, bool last );
+
+  QUrl url;
+  bool headDone = false;
+  QString head;
+  QString carry;
+};
+
 class IframeSchemeHandler: public QWebEngineUrlSchemeHandler
 {
   Q_OBJECT
@@ -11,6 +38,14 @@ public:
   IframeSchemeHandler( QObject * parent = nullptr );
   void requestStarted( QWebEngineUrlRequestJob * requestJob );
 
+  /// Keeps the pages in a disk cache of the given size, revalidating them
+  /// with the server when they get stale. 0 disables the cache.
+  void setupCache( qint64 maxSizeInBytes );
+
+  /// Removes all the cached pages, including the ones left on disk while the
+  /// cache was disabled.
+  void clearCache();
+
 protected:
 
 private:
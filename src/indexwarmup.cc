@@ -0,0 +1,56 @@
+/* This file is part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
+
+#include "indexwarmup.hh"
+#include "utils.hh"
+
+#include <QDebug>
+
+IndexWarmUp::IndexWarmUp( QObject * parent ):
+  QThread( parent ),
+  ioBudget( 0 )
+{
+}
+
+IndexWarmUp::~IndexWarmUp()
+{
+  cancel();
+}
+
+void IndexWarmUp::warmUp( std::vector< sptr< Dictionary::Class > > const & dicts, qint64 ioBudget_ )
+{
+  cancel();
+
+  if ( ioBudget_ <= 0 || dicts.empty() )
+    return;
+
+  dictionaries = dicts;
+  ioBudget     = ioBudget_;
+
+  isCancelled.storeRelease( 0 );
+
+  start( QThread::IdlePriority );
+}
+
+void IndexWarmUp::cancel()
+{
+  if ( !isRunning() )
+    return;
+
+  isCancelled.storeRelease( 1 );
+  wait();
+}
+
+void IndexWarmUp::run()
+{
+  for ( auto const & dictionary : dictionaries ) {
+    if ( Utils::AtomicInt::loadAcquire( isCancelled ) || ioBudget <= 0 )
+      break;
+
+    dictionary->warmUp( ioBudget, isCancelled );
+  }
+
+  qDebug() << "Index warm-up finished, budget left:" << ioBudget;
+
+  // Don't keep the dictionaries alive longer than necessary
+  dictionaries.clear();
+}
@@ -0,0 +1,40 @@
+#ifndef __INDEXWARMUP_HH_INCLUDED__
+#define __INDEXWARMUP_HH_INCLUDED__
+
+#include <QAtomicInt>
+#include <QThread>
+#include <vector>
+
+#include "dict/dictionary.hh"
+
+/// Prefetches the upper levels of the dictionaries' indexes in a low-priority
+/// background thread, so the first lookups in each dictionary wouldn't pay
+/// for cold index reads. Any user activity should cancel it.
+class IndexWarmUp: public QThread
+{
+  Q_OBJECT
+
+  std::vector< sptr< Dictionary::Class > > dictionaries;
+  qint64 ioBudget;
+  QAtomicInt isCancelled;
+
+public:
+
+  explicit IndexWarmUp( QObject * parent = nullptr );
+
+  ~IndexWarmUp();
+
+  /// Starts warming up the given dictionaries in their order, spending not
+  /// more than ioBudget bytes of I/O in total. Any warm-up in progress is
+  /// cancelled first. A zero budget does nothing.
+  void warmUp( std::vector< sptr< Dictionary::Class > > const & dicts, qint64 ioBudget );
+
+  /// Cancels the warm-up in progress, if any, and waits for it to stop.
+  void cancel();
+
+protected:
+
+  void run() override;
+};
+
+#endif
@@ -321,3 +321,18 @@ bool LangCoder::isLanguageRTL( quint32 _code )
 
   return false;
 }
+
+QCollator LangCoder::collator( quint32 code )
+{
+  QString const code2 = intToCode2( code );
+  QLocale locale( code2 );
+
+  // Unknown languages get the C locale, which sorts by code points
+  if ( code2.isEmpty() || locale.language() == QLocale::C )
+    locale = QLocale();
+
+  QCollator result( locale );
+  result.setCaseSensitivity( Qt::CaseInsensitive );
+
+  return result;
+}
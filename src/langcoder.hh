@@ -1,6 +1,7 @@
 #ifndef LANGCODER_H
 #define LANGCODER_H
 
+#include <QCollator>
 #include <QString>
 #include <QIcon>
 #include "wstring.hh"
@@ -52,6 +53,11 @@ public:
   /// Return true for RTL languages
   static bool isLanguageRTL( quint32 code );
 
+  /// Returns the collator sorting the words of the language the way it's
+  /// done in it, or the way the user's locale does for the unknown ones.
+  /// The case is ignored.
+  static QCollator collator( quint32 code );
+
 private:
   static QMap< QString, GDLangCode > LANG_CODE_MAP;
   static bool exists( const QString & _code );
@@ -27,10 +27,12 @@
 #include <QMessageBox>
 #include <QString>
 #include <QStringBuilder>
+#include <QThreadPool>
 #include <QtWebEngineCore/QWebEngineUrlScheme>
 
 #include "gddebug.hh"
-#include <QMutex>
+#include "asynclog.hh"
+#include "startupprofile.hh"
 
 #if defined( USE_BREAKPAD )
   #if defined( Q_OS_MAC )
@@ -86,40 +88,22 @@ bool callback( const char * dump_dir, const char * minidump_id, void * context,
   #endif
 #endif
 
-QMutex logMutex;
-
 void gdMessageHandler( QtMsgType type, const QMessageLogContext & context, const QString & mess )
 {
-  QString strTime = QDateTime::currentDateTime().toString( "MM-dd hh:mm:ss" );
-  QString message = QString( "%1 %2\r\n" ).arg( strTime, mess );
-
-  if ( ( logFilePtr != nullptr ) && logFilePtr->isOpen() ) {
-    //without the lock ,on multithread,there would be assert error.
-    QMutexLocker _( &logMutex );
-    switch ( type ) {
-      case QtDebugMsg:
-        message.insert( 0, "Debug: " );
-        break;
-      case QtWarningMsg:
-        message.insert( 0, "Warning: " );
-        break;
-      case QtCriticalMsg:
-        message.insert( 0, "Critical: " );
-        break;
-      case QtFatalMsg:
-        message.insert( 0, "Fatal: " );
-        logFilePtr->write( message.toUtf8() );
-        logFilePtr->flush();
-        abort();
-      case QtInfoMsg:
-        message.insert( 0, "Info: " );
-        break;
+  if ( AsyncLog::isRunning() ) {
+    if ( type != QtFatalMsg ) {
+      // The writer thread does the formatting and the writing
+      AsyncLog::post( type, mess );
+      return;
     }
 
-    logFilePtr->write( message.toUtf8() );
-    logFilePtr->flush();
+    // Get everything logged so far to the file before aborting
+    AsyncLog::stop();
 
-    return;
+    QString strTime = QDateTime::currentDateTime().toString( "MM-dd hh:mm:ss" );
+    logFilePtr->write( QString( "Fatal: %1 %2\r\n" ).arg( strTime, mess ).toUtf8() );
+    logFilePtr->flush();
+    abort();
   }
 
   //the following code lines actually will have no chance to run, schedule to remove in the future.
@@ -149,6 +133,7 @@ struct GDOptions
   bool togglePopup = false;
   QString word, groupName, popupGroupName;
   QString window;
+  QString logLevels;
 
   inline bool needSetGroup() const
   {
@@ -190,7 +175,8 @@ struct GDOptions
     return togglePopup;
   }
   bool notts;
-  bool resetState = false;
+  bool resetState     = false;
+  bool startupProfile = false;
 };
 
 void processCommandLine( QCoreApplication * app, GDOptions * result )
@@ -206,6 +192,11 @@ void processCommandLine( QCoreApplication * app, GDOptions * result )
                                                   << "log-to-file",
                                     QObject::tr( "Save debug messages to gd_log.txt in the config folder." ) );
 
+  QCommandLineOption logLevelsOption(
+    "log-levels",
+    QObject::tr( "Set the minimum level of logged messages per category, e.g. \"default=warning;qt.network=critical\"." ),
+    "levels" );
+
   QCommandLineOption resetState( QStringList() << "r"
                                                << "reset-window-state",
                                  QObject::tr( "Reset window state." ) );
@@ -237,7 +228,12 @@ void processCommandLine( QCoreApplication * app, GDOptions * result )
                                                  << "version",
                                    QObject::tr( "Print version and diagnosis info." ) );
 
+  QCommandLineOption startupProfile(
+    "startup-profile",
+    QObject::tr( "Print the timings of the startup phases as JSON and exit once the startup is over." ) );
+
   qcmd.addOption( logFileOption );
+  qcmd.addOption( logLevelsOption );
   qcmd.addOption( groupNameOption );
   qcmd.addOption( popupGroupNameOption );
   qcmd.addOption( window_popupOption );
@@ -246,6 +242,7 @@ void processCommandLine( QCoreApplication * app, GDOptions * result )
   qcmd.addOption( notts );
   qcmd.addOption( resetState );
   qcmd.addOption( printVersion );
+  qcmd.addOption( startupProfile );
 
   QCommandLineOption doNothingOption( "disable-web-security" ); // ignore the --disable-web-security
   doNothingOption.setFlags( QCommandLineOption::HiddenFromHelp );
@@ -257,6 +254,10 @@ void processCommandLine( QCoreApplication * app, GDOptions * result )
     result->logFile = true;
   }
 
+  if ( qcmd.isSet( logLevelsOption ) ) {
+    result->logLevels = qcmd.value( logLevelsOption );
+  }
+
   if ( qcmd.isSet( groupNameOption ) ) {
     result->groupName = qcmd.value( groupNameOption );
   }
@@ -282,6 +283,10 @@ void processCommandLine( QCoreApplication * app, GDOptions * result )
     result->resetState = true;
   }
 
+  if ( qcmd.isSet( startupProfile ) ) {
+    result->startupProfile = true;
+  }
+
   if ( qcmd.isSet( printVersion ) ) {
     qInfo() << qPrintable( Version::everything() );
     std::exit( 0 );
@@ -325,6 +330,8 @@ void processCommandLine( QCoreApplication * app, GDOptions * result )
 
 int main( int argc, char ** argv )
 {
+  StartupProfile::start();
+
 #if defined( Q_OS_UNIX ) && !defined( Q_OS_MACOS )
   // GoldenDict use lots of X11 functions and it currently cannot work
   // natively on Wayland. This workaround will force GoldenDict to use
@@ -429,6 +436,7 @@ int main( int argc, char ** argv )
   QFile file;
   logFilePtr = &file;
   auto guard = qScopeGuard( [ &file ]() {
+    AsyncLog::stop();
     logFilePtr = nullptr;
     file.close();
   } );
@@ -482,6 +490,8 @@ int main( int argc, char ** argv )
   // Load translations for system locale
   QString localeName = QLocale::system().name();
 
+  StartupProfile::Phase configPhase( "Configuration" );
+
   Config::Class cfg;
   for ( ;; ) {
     try {
@@ -497,16 +507,20 @@ int main( int argc, char ** argv )
       if ( mb.result() != QMessageBox::Yes )
         return -1;
 
-      QString configFile = Config::getConfigFileName();
-      QFile::rename( configFile,
-                     configFile % QStringLiteral( "." )
-                       % QDateTime::currentDateTime().toString( QStringLiteral( "yyyyMMdd_HHmmss" ) )
-                       % QStringLiteral( ".bad" ) );
+      QString const suffix = QStringLiteral( "." )
+        % QDateTime::currentDateTime().toString( QStringLiteral( "yyyyMMdd_HHmmss" ) ) % QStringLiteral( ".bad" );
+
+      for ( QString const & configFile : { Config::getConfigFileName(), Config::getConfigStoreFileName() } ) {
+        if ( QFile::exists( configFile ) )
+          QFile::rename( configFile, configFile + suffix );
+      }
       continue;
     }
     break;
   }
 
+  configPhase.end();
+
   if ( gdcl.notts ) {
     cfg.notts = true;
 #ifndef NO_TTS_SUPPORT
@@ -528,9 +542,14 @@ int main( int argc, char ** argv )
     logFilePtr->write( line );
 
     // Install message handler
+    if ( logFilePtr->isOpen() )
+      AsyncLog::start( logFilePtr );
     qInstallMessageHandler( gdMessageHandler );
   }
 
+  if ( !gdcl.logLevels.isEmpty() )
+    AsyncLog::setLevels( gdcl.logLevels );
+
   // Reload translations for user selected locale is nesessary
   QTranslator qtTranslator;
   QTranslator translator;
@@ -564,7 +583,30 @@ int main( int argc, char ** argv )
   // and with the main window closed.
   app.setQuitOnLastWindowClosed( false );
 
+  StartupProfile::Phase mainWindowPhase( "Main window" );
   MainWindow m( cfg );
+  mainWindowPhase.end();
+
+  // The deferred init of the dictionaries goes on in the background, on the
+  // global pool. It is part of what the startup costs, so when profiling,
+  // it's let to finish first. Waiting also keeps its jobs, which use the
+  // dictionaries by plain pointers, from outliving them on the early exit.
+  // The full-text indexing shares the pool but may take ages, so it's stopped.
+  if ( gdcl.startupProfile ) {
+    StartupProfile::Phase waitPhase( "Waiting for the background jobs" );
+    m.stopFtsIndexing();
+    QThreadPool::globalInstance()->waitForDone();
+  }
+
+  StartupProfile::finish();
+
+  if ( !StartupProfile::save( Config::getConfigDir() + "startup_profile.json" ) )
+    gdWarning( "Can't write the startup profile" );
+
+  if ( gdcl.startupProfile ) {
+    fputs( StartupProfile::toJson().constData(), stdout );
+    return 0;
+  }
 
   app.addDataCommiter( m );
 
@@ -35,12 +35,23 @@ void ResourceSchemeHandler::replyJob( sptr< Dictionary::DataRequest > reply,
     requestJob->fail( QWebEngineUrlRequestJob::UrlNotFound );
     return;
   }
-  const auto & data = reply->getFullData();
-  if ( data.empty() ) {
+  // Copied right from the segments, rather than joined together first
+  auto const segments = reply->getSegments();
+
+  qsizetype size = 0;
+  for ( auto const & segment : segments )
+    size += segment.size;
+
+  if ( !size ) {
     requestJob->fail( QWebEngineUrlRequestJob::UrlNotFound );
     return;
   }
-  QByteArray * ba  = new QByteArray( data.data(), data.size() );
+
+  QByteArray * ba = new QByteArray;
+  ba->reserve( size );
+  for ( auto const & segment : segments )
+    ba->append( segment.data, segment.size );
+
   QBuffer * buffer = new QBuffer( ba );
   buffer->open( QBuffer::ReadOnly );
   buffer->seek( 0 );
@@ -0,0 +1,287 @@
+/* This file is part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
+
+#include "startupprofile.hh"
+#include "version.hh"
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSaveFile>
+#include <cmath>
+#include <vector>
+
+#ifdef Q_OS_WIN32
+  #include <windows.h>
+#else
+  #include <time.h>
+#endif
+
+namespace StartupProfile {
+
+namespace {
+
+struct Record
+{
+  Entry entry; // Its wall and CPU times are the starting ones while open
+  bool open;
+};
+
+QMutex mutex;
+QElapsedTimer timer;
+qint64 startCpuNs = 0;
+bool finished     = false;
+int openCount     = 0; // The depth of the next phase
+std::vector< Record > records;
+qint64 wallNs = 0, cpuNs = 0;
+
+/// The CPU time the process has used so far, all of its threads together
+qint64 processCpuNs()
+{
+#ifdef Q_OS_WIN32
+  FILETIME creation, exitTime, kernel, user;
+  if ( !GetProcessTimes( GetCurrentProcess(), &creation, &exitTime, &kernel, &user ) )
+    return 0;
+
+  auto const ticks = []( FILETIME const & time ) {
+    return ( (qint64)time.dwHighDateTime << 32 ) | time.dwLowDateTime;
+  };
+
+  return ( ticks( kernel ) + ticks( user ) ) * 100; // Counted in 100 ns
+#else
+  timespec time;
+  if ( clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &time ) != 0 )
+    return 0;
+
+  return (qint64)time.tv_sec * 1000000000 + time.tv_nsec;
+#endif
+}
+
+/// Must be called with the mutex locked
+void closeRecord( Record & record, qint64 nowNs, qint64 nowCpuNs )
+{
+  record.entry.wallNs = nowNs - record.entry.startNs;
+  record.entry.cpuNs  = nowCpuNs - record.entry.cpuNs;
+  record.open         = false;
+}
+
+double milliseconds( qint64 ns )
+{
+  return std::round( ns / 1000.0 ) / 1000.0;
+}
+
+QJsonObject toJsonObject( Record const & record )
+{
+  Entry const & entry = record.entry;
+
+  QJsonObject phase;
+  phase[ "name" ]    = entry.name;
+  phase[ "startMs" ] = milliseconds( entry.startNs );
+
+  // The ones still going have no times yet
+  if ( !record.open ) {
+    phase[ "wallMs" ] = milliseconds( entry.wallNs );
+    phase[ "cpuMs" ]  = milliseconds( entry.cpuNs );
+  }
+
+  return phase;
+}
+
+/// Turns the records from pos on which are nested deeper than the parent into
+/// the JSON array, leaving pos at the first one which isn't. The background
+/// ones are skipped.
+QJsonArray toJsonArray( size_t & pos, int parentDepth )
+{
+  QJsonArray result;
+
+  while ( pos < records.size() ) {
+    Record const & record = records[ pos ];
+
+    if ( record.entry.background ) {
+      ++pos;
+      continue;
+    }
+
+    if ( record.entry.depth <= parentDepth )
+      break;
+
+    ++pos;
+
+    QJsonObject phase = toJsonObject( record );
+    QJsonArray phases = toJsonArray( pos, record.entry.depth );
+    if ( !phases.isEmpty() )
+      phase[ "phases" ] = phases;
+
+    result.append( phase );
+  }
+
+  return result;
+}
+
+} // namespace
+
+void start()
+{
+  QMutexLocker _( &mutex );
+
+  timer.start();
+  startCpuNs = processCpuNs();
+}
+
+void finish()
+{
+  QMutexLocker _( &mutex );
+
+  if ( !timer.isValid() || finished )
+    return;
+
+  wallNs = timer.nsecsElapsed();
+  cpuNs  = processCpuNs();
+
+  // The phases still going are cut short here
+  for ( auto & record : records )
+    if ( record.open )
+      closeRecord( record, wallNs, cpuNs );
+
+  cpuNs -= startCpuNs;
+  finished = true;
+}
+
+bool isFinished()
+{
+  QMutexLocker _( &mutex );
+  return finished;
+}
+
+Phase::Phase( QString const & name ):
+  index( -1 )
+{
+  QMutexLocker _( &mutex );
+
+  if ( !timer.isValid() || finished )
+    return;
+
+  index = (int)records.size();
+  records.push_back( { { name, openCount++, timer.nsecsElapsed(), 0, processCpuNs(), false }, true } );
+}
+
+Phase::Phase( QString const & name, Background ):
+  index( -1 )
+{
+  QMutexLocker _( &mutex );
+
+  if ( !timer.isValid() || finished )
+    return;
+
+  index = (int)records.size();
+  records.push_back( { { name, 0, timer.nsecsElapsed(), 0, processCpuNs(), true }, true } );
+}
+
+Phase::~Phase()
+{
+  end();
+}
+
+void Phase::end()
+{
+  if ( index < 0 )
+    return;
+
+  QMutexLocker _( &mutex );
+
+  Record & record = records[ index ];
+
+  if ( record.open ) {
+    closeRecord( record, timer.nsecsElapsed(), processCpuNs() );
+
+    if ( !record.entry.background )
+      --openCount;
+  }
+
+  index = -1;
+}
+
+void Phase::drop()
+{
+  if ( index < 0 )
+    return;
+
+  {
+    QMutexLocker _( &mutex );
+
+    if ( records[ index ].open && (size_t)index + 1 == records.size() ) {
+      if ( !records[ index ].entry.background )
+        --openCount;
+      records.pop_back();
+      index = -1;
+      return;
+    }
+  }
+
+  end();
+}
+
+QList< Entry > entries()
+{
+  QMutexLocker _( &mutex );
+
+  QList< Entry > result;
+  result.reserve( records.size() );
+
+  for ( auto const & record : records )
+    if ( !record.open )
+      result.append( record.entry );
+
+  return result;
+}
+
+qint64 totalWallNs()
+{
+  QMutexLocker _( &mutex );
+  return wallNs;
+}
+
+qint64 totalCpuNs()
+{
+  QMutexLocker _( &mutex );
+  return cpuNs;
+}
+
+QByteArray toJson()
+{
+  QMutexLocker _( &mutex );
+
+  QJsonObject profile;
+  profile[ "version" ]  = Version::version();
+  profile[ "finished" ] = finished;
+  profile[ "wallMs" ]   = milliseconds( wallNs );
+  profile[ "cpuMs" ]    = milliseconds( cpuNs );
+
+  size_t pos          = 0;
+  profile[ "phases" ] = toJsonArray( pos, -1 );
+
+  QJsonArray background;
+  for ( auto const & record : records )
+    if ( record.entry.background )
+      background.append( toJsonObject( record ) );
+
+  if ( !background.isEmpty() )
+    profile[ "background" ] = background;
+
+  return QJsonDocument( profile ).toJson();
+}
+
+bool save( QString const & fileName )
+{
+  QSaveFile file( fileName );
+
+  if ( !file.open( QFile::WriteOnly ) )
+    return false;
+
+  file.write( toJson() );
+
+  return file.commit();
+}
+
+} // namespace StartupProfile
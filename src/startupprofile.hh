@@ -0,0 +1,86 @@
+/* This file is part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
+
+#ifndef __STARTUPPROFILE_HH_INCLUDED__
+#define __STARTUPPROFILE_HH_INCLUDED__
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QtGlobal>
+
+/// Records how long each phase of the startup takes, in wall and CPU time,
+/// down to the single dictionaries, so a startup which got slow can be traced
+/// to what grew. The recording stops with finish(): the phases begun after
+/// that, such as the ones of the dictionaries being reloaded, are ignored.
+///
+/// The phases are expected to nest, those of the different threads included,
+/// which holds during the startup, where the threads wait for each other. The
+/// background ones, which run alongside the rest on the thread pool, are the
+/// exception: they are kept apart and never nest.
+namespace StartupProfile {
+
+struct Entry
+{
+  QString name;
+  int depth;        // 0 for the outermost phases
+  qint64 startNs;   // Since start()
+  qint64 wallNs;
+  qint64 cpuNs;     // Of the whole process, so the helper threads' work counts
+  bool background;  // Ran alongside the others, its depth is always 0
+};
+
+/// Starts the clock. To be called first thing in main().
+void start();
+
+/// Ends the recording, taking the total time up to now.
+void finish();
+
+bool isFinished();
+
+/// Times a phase for as long as it lives, unless the recording isn't going on.
+class Phase
+{
+public:
+
+  enum Background {
+    InBackground
+  };
+
+  explicit Phase( QString const & name );
+
+  /// Times a background phase, which may run on any thread at any time.
+  Phase( QString const & name, Background );
+  ~Phase();
+
+  Phase( Phase const & )             = delete;
+  Phase & operator=( Phase const & ) = delete;
+
+  /// Ends the phase before the object is destroyed.
+  void end();
+
+  /// Leaves the phase out of the profile, provided nothing was recorded
+  /// within it. Otherwise just ends it.
+  void drop();
+
+private:
+
+  int index; // In the entries, -1 if not being recorded
+};
+
+/// The phases recorded, in the order they began, the background ones mixed in.
+QList< Entry > entries();
+
+qint64 totalWallNs();
+qint64 totalCpuNs();
+
+/// The profile as a JSON document, the phases nested in their parents'
+/// "phases" and the background ones listed in "background". The times are in
+/// milliseconds.
+QByteArray toJson();
+
+/// Writes toJson() to the file. Returns false on failure.
+bool save( QString const & fileName );
+
+} // namespace StartupProfile
+
+#endif
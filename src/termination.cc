@@ -3,6 +3,7 @@
  * Part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
 
 #include "termination.hh"
+#include "asynclog.hh"
 #include <exception>
 #include <QtCore>
 
@@ -11,6 +12,8 @@ static void termHandler()
 {
   qDebug() << "GoldenDict has crashed unexpectedly.\n\n";
 
+  AsyncLog::stop();
+
   if ( logFilePtr && logFilePtr->isOpen() )
     logFilePtr->close();
 
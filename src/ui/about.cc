@@ -2,6 +2,7 @@
  * Part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
 
 #include "about.hh"
+#include "memorybudget.hh"
 #include "utils.hh"
 #include "version.hh"
 
@@ -22,7 +23,7 @@ About::About( QWidget * parent, std::vector< sptr< Dictionary::Class > > * dicto
                          + " (Xapian inside)" );
 
   connect( ui.copyInfoBtn, &QPushButton::clicked, [] {
-    QGuiApplication::clipboard()->setText( Version::everything() );
+    QGuiApplication::clipboard()->setText( Version::everything() + "\n" + MemoryBudget::report() );
   } );
 
   connect( ui.copyDictListBtn, &QPushButton::clicked, [ = ] {
@@ -2,8 +2,10 @@
  * Part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
 
 #include "dictheadwords.hh"
+#include "articleprefetch.hh"
 #include "gddebug.hh"
 #include "headwordsmodel.hh"
+#include "langcoder.hh"
 
 #include <QRegExp>
 #if ( QT_VERSION >= QT_VERSION_CHECK( 6, 0, 0 ) )
@@ -19,7 +21,10 @@
 #include "help.hh"
 #include <QMessageBox>
 #include <QMutexLocker>
+#include <algorithm>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #define AUTO_APPLY_LIMIT 150000
 
@@ -54,12 +59,10 @@ DictHeadwords::DictHeadwords( QWidget * parent, Config::Class & cfg_, Dictionary
   ui.matchCase->setChecked( cfg.headwordsDialog.matchCase );
 
   model = std::make_shared< HeadwordListModel >();
-  proxy = new QSortFilterProxyModel( this );
+  proxy = new HeadwordSortProxy( this );
 
   proxy->setSourceModel( model.get() );
 
-  proxy->setSortCaseSensitivity( Qt::CaseInsensitive );
-  proxy->setSortLocaleAware( true );
   proxy->setDynamicSortFilter( false );
 
   ui.headersListView->setModel( proxy );
@@ -104,6 +107,10 @@ DictHeadwords::DictHeadwords( QWidget * parent, Config::Class & cfg_, Dictionary
   connect( ui.matchCase, &QCheckBox::stateChanged, this, &DictHeadwords::filterChangedInternal );
 
   connect( ui.headersListView, &QAbstractItemView::clicked, this, &DictHeadwords::itemClicked );
+  connect( ui.headersListView->selectionModel(),
+           &QItemSelectionModel::currentChanged,
+           this,
+           &DictHeadwords::prefetchAround );
 
   connect( proxy, &QAbstractItemModel::dataChanged, this, &DictHeadwords::showHeadwordsNumber );
 
@@ -114,6 +121,8 @@ DictHeadwords::DictHeadwords( QWidget * parent, Config::Class & cfg_, Dictionary
 
 DictHeadwords::~DictHeadwords()
 {
+  ArticlePrefetch::cancel();
+
   if ( delegate )
     delegate->deleteLater();
 }
@@ -132,6 +141,7 @@ void DictHeadwords::setup( Dictionary::Class * dict_ )
   model.swap( other );
   model->setDict( dict );
   proxy->setSourceModel( model.get() );
+  proxy->setLanguage( dict->getLangFrom() );
   proxy->sort( 0 );
   filterChanged();
 
@@ -284,6 +294,26 @@ void DictHeadwords::itemClicked( const QModelIndex & index )
   }
 }
 
+void DictHeadwords::prefetchAround( const QModelIndex & index )
+{
+  if ( !index.isValid() )
+    return;
+
+  QList< ArticlePrefetch::Item > items;
+
+  // The headword itself first, then the following ones and the preceding one
+  for ( int row : { index.row(), index.row() + 1, index.row() + 2, index.row() + 3, index.row() - 1 } ) {
+    if ( row < 0 || row >= proxy->rowCount() )
+      continue;
+
+    QString const headword = proxy->data( proxy->index( row, 0 ), Qt::DisplayRole ).toString();
+    if ( !headword.isEmpty() )
+      items.append( ArticlePrefetch::Item{ dict, headword } );
+  }
+
+  ArticlePrefetch::prefetch( items, cfg.preferences.ignoreDiacritics );
+}
+
 void DictHeadwords::autoApplyStateChanged( int state )
 {
   ui.applyButton->setEnabled( state == Qt::Unchecked );
@@ -330,8 +360,25 @@ void DictHeadwords::loadAllSortedWords( QProgressDialog & progress )
       headwords = model->getRemainRows( nodeIndex );
     }
 
-    sortedWords = allHeadwords.values();
-    sortedWords.sort();
+    // Sorted the same way as the list is, through the keys made once per
+    // headword
+    QCollator const collator = LangCoder::collator( dict->getLangFrom() );
+
+    std::vector< std::pair< QCollatorSortKey, QString > > keyed;
+    keyed.reserve( allHeadwords.size() );
+
+    for ( auto const & headword : std::as_const( allHeadwords ) )
+      keyed.emplace_back( collator.sortKey( headword ), headword );
+
+    std::stable_sort( keyed.begin(), keyed.end(), []( auto const & a, auto const & b ) {
+      return a.first.compare( b.first ) < 0;
+    } );
+
+    sortedWords.clear();
+    sortedWords.reserve( keyed.size() );
+
+    for ( auto & entry : keyed )
+      sortedWords.append( std::move( entry.second ) );
   }
 }
 
@@ -31,7 +31,7 @@ protected:
   Dictionary::Class * dict;
 
   std::shared_ptr< HeadwordListModel > model;
-  QSortFilterProxyModel * proxy;
+  HeadwordSortProxy * proxy;
   WordListItemDelegate * delegate;
   QString dictId;
 
@@ -52,6 +52,9 @@ private slots:
   void exportButtonClicked();
   void okButtonClicked();
   void itemClicked( const QModelIndex & index );
+  /// Prefetches the articles of the headword and the ones around it, which
+  /// are likely to be looked at next.
+  void prefetchAround( const QModelIndex & index );
   void autoApplyStateChanged( int state );
   void showHeadwordsNumber();
   void loadAllSortedWords( QProgressDialog & progress );
@@ -270,6 +270,17 @@ void FavoritesPaneWidget::getDataInPlainText( QString & dataStr )
   m_favoritesModel->getDataInPlainText( dataStr );
 }
 
+QStringList FavoritesPaneWidget::getHeadwords() const
+{
+  QModelIndexList idxs = m_favoritesTree->selectionModel()->selectedIndexes();
+  if ( idxs.isEmpty() )
+    idxs.append( QModelIndex() ); // The root item
+
+  QStringList headwords = m_favoritesModel->getTextForIndexes( idxs );
+  headwords.removeDuplicates();
+  return headwords;
+}
+
 bool FavoritesPaneWidget::setDataFromXml( QString const & dataStr )
 {
   return m_favoritesModel->setDataFromXml( dataStr );
@@ -54,6 +54,9 @@ public:
   bool setDataFromXml( QString const & dataStr );
   bool setDataFromTxt( QString const & dataStr );
 
+  // Headwords of the selected items, or all the headwords if nothing is selected
+  QStringList getHeadwords() const;
+
   void setFocusOnTree()
   {
     m_favoritesTree->setFocus();
@@ -8,11 +8,17 @@
 #endif
 
 #include "mainwindow.hh"
+#include "articleprefetch.hh"
 #include <QWebEngineProfile>
 #include "editdictionaries.hh"
 #include "dict/loaddictionaries.hh"
+#include "dict/iconcache.hh"
+#include "indexpack.hh"
+#include "memorybudget.hh"
 #include "preferences.hh"
 #include "about.hh"
+#include "startupprofiledialog.hh"
+#include "startupprofile.hh"
 #include "mruqmenu.hh"
 #include "gestures.hh"
 #include "dictheadwords.hh"
@@ -28,6 +34,7 @@
 #include <QProcess>
 #include <QCryptographicHash>
 #include <QFileDialog>
+#include <QInputDialog>
 #include <QPrinter>
 #include <QPageSetupDialog>
 #include <QPrintPreviewDialog>
@@ -168,6 +175,7 @@ MainWindow::MainWindow( Config::Class & cfg_ ):
   wasMaximized( false ),
   headwordsDlg( nullptr ),
   ftsIndexing( dictionaries ),
+  bulkExporter( articleMaker, cfg ),
   ftsDlg( nullptr ),
   starIcon( ":/icons/star.svg" ),
   blueStarIcon( ":/icons/star_blue.svg" )
@@ -181,6 +189,8 @@ MainWindow::MainWindow( Config::Class & cfg_ ):
 
   GlobalBroadcaster::instance()->setPreference( &cfg.preferences );
 
+  StartupProfile::Phase webEnginePhase( "Web engine profile" );
+
   localSchemeHandler = new LocalSchemeHandler( articleNetMgr, this );
   QStringList htmlScheme = { "gdlookup", "bword", "entry" };
   for ( const auto & localScheme : htmlScheme ) {
@@ -203,6 +213,8 @@ MainWindow::MainWindow( Config::Class & cfg_ ):
                                                            + " GoldenDict/WebEngine" );
   }
 
+  webEnginePhase.end();
+
 #ifndef NO_EPWING_SUPPORT
   Epwing::initialize();
 #endif
@@ -659,6 +671,7 @@ MainWindow::MainWindow( Config::Class & cfg_ ):
   connect( ui.visitHomepage, &QAction::triggered, this, &MainWindow::visitHomepage );
   connect( ui.visitForum, &QAction::triggered, this, &MainWindow::visitForum );
   connect( ui.openConfigFolder, &QAction::triggered, this, &MainWindow::openConfigFolder );
+  connect( ui.showStartupProfile, &QAction::triggered, this, &MainWindow::showStartupProfile );
   connect( ui.about, &QAction::triggered, this, &MainWindow::showAbout );
   connect( ui.showReference, &QAction::triggered, []() {
     Help::openHelpWebpage();
@@ -711,6 +724,11 @@ MainWindow::MainWindow( Config::Class & cfg_ ):
   groupListInToolbar->installEventFilter( this );
 
   connect( &ftsIndexing, &FTS::FtsIndexing::newIndexingName, this, &MainWindow::showFTSIndexingName );
+
+  connect( &bulkExporter, &BulkExporter::progress, this, [ this ]( int done, int total ) {
+    mainStatusBar->showMessage( tr( "Exporting definitions: %1 of %2" ).arg( done ).arg( total ) );
+  } );
+  connect( &bulkExporter, &BulkExporter::finished, this, &MainWindow::bulkExportFinished );
   connect( GlobalBroadcaster::instance(),
            &GlobalBroadcaster::indexingDictionary,
            this,
@@ -748,6 +766,9 @@ MainWindow::MainWindow( Config::Class & cfg_ ):
 
   setupNetworkCache( cfg.preferences.maxNetworkCacheSize );
 
+  MemoryBudget::setBudget( (qint64)cfg.preferences.cacheMemoryBudget * 1024 * 1024 );
+  MemoryBudget::startMonitoring();
+
   makeDictionaries();
 
   // After we have dictionaries and groups, we can populate history
@@ -895,6 +916,8 @@ MainWindow::MainWindow( Config::Class & cfg_ ):
   // makeDictionaries() didn't do deferred init - we do it here, at the end.
   doDeferredInit( dictionaries );
 
+  startIndexWarmUp();
+
   updateStatusLine();
 
 #ifdef Q_OS_MAC
@@ -1158,7 +1181,13 @@ MainWindow::~MainWindow()
 {
   closeHeadwordsDialog();
 
+  bulkExporter.cancel();
+  indexWarmUp.cancel();
+  ArticlePrefetch::clear();
   ftsIndexing.stopIndexing();
+  IndexPack::stop();
+
+  IconCache::save();
 #ifndef Q_OS_MACOS
   ui.centralWidget->ungrabGesture( Gestures::GDPinchGestureType );
   ui.centralWidget->ungrabGesture( Gestures::GDSwipeGestureType );
@@ -1229,6 +1258,8 @@ void MainWindow::commitData()
   if ( cfg.preferences.clearNetworkCacheOnExit ) {
     if ( QAbstractNetworkCache * cache = articleNetMgr.cache() )
       cache->clear();
+
+    iframeSchemeHandler->clearCache();
   }
 
   //if the dictionaries is empty ,large chance that the config has corrupt.
@@ -1242,16 +1273,40 @@ void MainWindow::commitData()
 
       if ( dictMap.contains( fileName.toStdString() ) )
         continue;
-      //remove both normal index and fts index.
+
+      // The index pack, and the compacted one being written or waiting to
+      // replace it, hold the indexes of many dictionaries
+      if ( fileName.startsWith( "indexes.pack" ) )
+        continue;
+
+      // The directory manifest of a sound dir, kept next to its index
+      if ( fileName.endsWith( "_dirs" ) && dictMap.contains( fileName.chopped( 5 ).toStdString() ) )
+        continue;
+
       auto filePath = file.absoluteFilePath();
-      qDebug() << "remove invalid index files & fts dirs";
+      qDebug() << "remove invalid index files";
 
       QFile::remove( filePath );
-      QDir d( filePath + "_FTS_x" );
-      if ( d.exists() ) {
-        d.removeRecursively();
-      }
     }
+
+    // The fts indexes are looked at on their own, since the index they
+    // belong to might be in the pack rather than standalone
+    QString const ftsSuffix = QString::fromStdString( Dictionary::getFtsSuffix() );
+
+    for ( auto & ftsDir : dir.entryInfoList( QDir::Dirs | QDir::NoDotAndDotDot ) ) {
+      QString const dirName = ftsDir.fileName();
+      qsizetype const pos   = dirName.indexOf( ftsSuffix );
+
+      if ( pos <= 0 || dictMap.contains( dirName.left( pos ).toStdString() ) )
+        continue;
+
+      qDebug() << "remove invalid fts dir" << dirName;
+      QDir( ftsDir.absoluteFilePath() ).removeRecursively();
+    }
+
+    IndexPack::dropSegments( [ this ]( std::string const & id ) {
+      return dictMap.contains( id );
+    } );
   }
 
 
@@ -1264,9 +1319,10 @@ void MainWindow::commitData()
     if ( scanPopup )
       scanPopup->saveConfigData();
 
-    // Save any changes in last chosen groups etc
+    // Save any changes in last chosen groups etc, and have the XML config
+    // brought up to date for the older versions and hand editing
     try {
-      Config::save( cfg );
+      Config::save( cfg, true );
     }
     catch ( std::exception & e ) {
       gdWarning( "Configuration saving failed, error: %s\n", e.what() );
@@ -1532,6 +1588,8 @@ void MainWindow::setupNetworkCache( int maxSize )
   // x << 20 == x * 2^20 converts mebibytes to bytes.
   qint64 const maxCacheSizeInBytes = maxSize <= 0 ? qint64( 0 ) : static_cast< qint64 >( maxSize ) << 20;
 
+  iframeSchemeHandler->setupCache( maxCacheSizeInBytes );
+
   if ( QAbstractNetworkCache * abstractCache = articleNetMgr.cache() ) {
     QNetworkDiskCache * const diskCache = qobject_cast< QNetworkDiskCache * >( abstractCache );
     Q_ASSERT_X( diskCache, Q_FUNC_INFO, "Unexpected network cache type." );
@@ -1560,10 +1618,17 @@ void MainWindow::makeDictionaries()
 
   dictionariesUnmuted.clear();
 
+  bulkExporter.cancel();
+  indexWarmUp.cancel();
+  ArticlePrefetch::clear();
   ftsIndexing.stopIndexing();
+
+  IconCache::save();
   ftsIndexing.clearDictionaries();
 
+  StartupProfile::Phase loadPhase( "Loading dictionaries" );
   loadDictionaries( this, isVisible(), cfg, dictionaries, dictNetMgr, false );
+  loadPhase.end();
 
   //create map
   dictMap = Dictionary::dictToMap( dictionaries );
@@ -1573,8 +1638,10 @@ void MainWindow::makeDictionaries()
     dictionaries[ x ]->setSynonymSearchEnabled( cfg.preferences.synonymSearchEnabled );
   }
 
+  StartupProfile::Phase ftsPhase( "Full-text search indexing" );
   ftsIndexing.setDictionaries( dictionaries );
   ftsIndexing.doIndexing();
+  ftsPhase.end();
 
   updateStatusLine();
   updateGroupList();
@@ -1596,6 +1663,8 @@ void MainWindow::updateStatusLine()
 
 void MainWindow::updateGroupList()
 {
+  StartupProfile::Phase phase( "Groups" );
+
   bool haveGroups = cfg.groups.size();
 
   groupList->setVisible( haveGroups );
@@ -1679,6 +1748,16 @@ void MainWindow::updateDictionaryBar()
   }
 }
 
+void MainWindow::stopFtsIndexing()
+{
+  ftsIndexing.stopIndexing();
+}
+
+void MainWindow::startIndexWarmUp()
+{
+  indexWarmUp.warmUp( getActiveDicts(), (qint64)cfg.preferences.indexWarmUpBudget * 1024 * 1024 );
+}
+
 vector< sptr< Dictionary::Class > > const & MainWindow::getActiveDicts()
 {
   if ( groupInstances.empty() )
@@ -2141,6 +2220,7 @@ void MainWindow::editDictionaries( unsigned editDictionaryGroup )
   hotkeyWrapper.reset(); // No hotkeys while we're editing dictionaries
   closeHeadwordsDialog();
   closeFullTextSearchDialog();
+  ArticlePrefetch::clear(); // The dictionaries might get rescanned
 
   wordFinder.clear();
   dictionariesUnmuted.clear();
@@ -2354,6 +2434,8 @@ void MainWindow::currentGroupChanged( int )
 
   if ( ftsDlg )
     ftsDlg->setCurrentGroup( grg_id );
+
+  startIndexWarmUp();
 }
 
 void MainWindow::updateCurrentGroupProperty()
@@ -2376,6 +2458,9 @@ void MainWindow::updateCurrentGroupProperty()
 
 void MainWindow::translateInputChanged( QString const & newValue )
 {
+  // The user is active, leave the disk to the lookups
+  indexWarmUp.cancel();
+
   updateSuggestionList( newValue );
   // Save translate line text. Later it can be passed to external applications.
   GlobalBroadcaster::instance()->translateLineText = newValue;
@@ -2874,6 +2959,8 @@ void MainWindow::toggleMainWindow( bool onlyShow )
 
 void MainWindow::installHotKeys()
 {
+  StartupProfile::Phase phase( "Hotkeys" );
+
 #if defined( Q_OS_UNIX ) && !defined( Q_OS_MACOS )
   if ( !qEnvironmentVariableIsEmpty( "GOLDENDICT_FORCE_WAYLAND" ) ) {
     return;
@@ -3029,6 +3116,13 @@ void MainWindow::visitForum()
   QDesktopServices::openUrl( QUrl( "https://github.com/xiaoyifang/goldendict/discussions" ) );
 }
 
+void MainWindow::showStartupProfile()
+{
+  StartupProfileDialog dialog( this );
+
+  dialog.exec();
+}
+
 void MainWindow::showAbout()
 {
   About about( this, &dictionaries );
@@ -3361,6 +3455,8 @@ void MainWindow::on_rescanFiles_triggered()
   closeHeadwordsDialog();
   closeFullTextSearchDialog();
 
+  indexWarmUp.cancel();
+  ArticlePrefetch::clear();
   ftsIndexing.stopIndexing();
   ftsIndexing.clearDictionaries();
 
@@ -3377,8 +3473,10 @@ void MainWindow::on_rescanFiles_triggered()
     dictionaries[ x ]->setSynonymSearchEnabled( cfg.preferences.synonymSearchEnabled );
   }
 
+  StartupProfile::Phase ftsPhase( "Full-text search indexing" );
   ftsIndexing.setDictionaries( dictionaries );
   ftsIndexing.doIndexing();
+  ftsPhase.end();
 
   updateGroupList();
 
@@ -3734,6 +3832,16 @@ void MainWindow::on_exportHistory_triggered()
   mainStatusBar->showMessage( tr( "History export complete" ), 5000 );
 }
 
+void MainWindow::on_exportHistoryDefinitions_triggered()
+{
+  QStringList words;
+  for ( auto const & item : history.getItems() )
+    words.append( item.word );
+  words.removeDuplicates();
+
+  exportDefinitions( words );
+}
+
 void MainWindow::on_importHistory_triggered()
 {
   QString importPath;
@@ -3896,6 +4004,72 @@ void MainWindow::on_ExportFavoritesToList_triggered()
   mainStatusBar->showMessage( tr( "Favorites export complete" ), 5000 );
 }
 
+void MainWindow::on_exportFavoritesDefinitions_triggered()
+{
+  exportDefinitions( ui.favoritesPaneWidget->getHeadwords() );
+}
+
+void MainWindow::exportDefinitions( QStringList const & words )
+{
+  if ( words.isEmpty() )
+    return;
+
+  if ( bulkExporter.isRunning() ) {
+    errorMessageOnStatusBar( tr( "Export error: " ) + tr( "Another export is in progress" ) );
+    return;
+  }
+
+  QStringList formats = { tr( "HTML page" ), tr( "Tab-separated text" ) };
+  if ( cfg.preferences.ankiConnectServer.enabled )
+    formats.append( tr( "Anki notes" ) );
+
+  bool ok;
+  QString const chosen = QInputDialog::getItem( this,
+                                                tr( "Export definitions" ),
+                                                tr( "Export %n definition(s) as:", "", words.size() ),
+                                                formats,
+                                                0,
+                                                false,
+                                                &ok );
+  if ( !ok )
+    return;
+
+  auto const format = static_cast< BulkExporter::Format >( formats.indexOf( chosen ) );
+
+  QString fileName;
+  if ( format != BulkExporter::Format::Anki ) {
+    QString exportPath;
+    if ( cfg.historyExportPath.isEmpty() )
+      exportPath = QDir::homePath();
+    else {
+      exportPath = QDir::fromNativeSeparators( cfg.historyExportPath );
+      if ( !QDir( exportPath ).exists() )
+        exportPath = QDir::homePath();
+    }
+
+    QString const filter = format == BulkExporter::Format::Html ?
+      tr( "HTML files (*.html);;All files (*.*)" ) :
+      tr( "TSV files (*.tsv);;Text files (*.txt);;All files (*.*)" );
+
+    fileName = QFileDialog::getSaveFileName( this, tr( "Export definitions to file" ), exportPath, filter );
+    if ( fileName.isEmpty() )
+      return;
+
+    cfg.historyExportPath = QDir::toNativeSeparators( QFileInfo( fileName ).absoluteDir().absolutePath() );
+  }
+
+  if ( !bulkExporter.start( words, groupList->getCurrentGroup(), format, fileName ) )
+    errorMessageOnStatusBar( tr( "Export error: " ) + bulkExporter.errorString() );
+}
+
+void MainWindow::bulkExportFinished( QString const & errorString )
+{
+  if ( errorString.isEmpty() )
+    mainStatusBar->showMessage( tr( "Definitions export complete" ), 5000 );
+  else
+    errorMessageOnStatusBar( tr( "Export error: " ) + errorString );
+}
+
 void MainWindow::on_importFavorites_triggered()
 {
   QString importPath;
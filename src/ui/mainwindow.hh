@@ -28,6 +28,8 @@
 #include "translatebox.hh"
 #include "dictheadwords.hh"
 #include "fulltextsearch.hh"
+#include "indexwarmup.hh"
+#include "bulkexporter.hh"
 #include "base_type.hh"
 
 #include "hotkeywrapper.hh"
@@ -58,6 +60,9 @@ public:
   /// Set group for main/popup window
   void setGroupByName( QString const & name, bool main_window );
 
+  /// Stops the full-text indexing, which runs on the global thread pool.
+  void stopFtsIndexing();
+
   enum class WildcardPolicy {
     EscapeWildcards,
     WildcardsAreAlreadyEscaped
@@ -166,6 +171,17 @@ private:
 
   FTS::FtsIndexing ftsIndexing;
 
+  IndexWarmUp indexWarmUp;
+
+  /// Starts prefetching the indexes of the current group's dictionaries
+  void startIndexWarmUp();
+
+  BulkExporter bulkExporter;
+
+  /// Asks for the format and the destination, then exports the definitions of
+  /// the given words looked up in the current group.
+  void exportDefinitions( QStringList const & words );
+
   FTS::FullTextSearchDialog * ftsDlg;
 
   QIcon starIcon, blueStarIcon;
@@ -406,6 +422,7 @@ private slots:
   void visitHomepage();
   void visitForum();
   void openConfigFolder();
+  void showStartupProfile();
   void showAbout();
 
   void showDictBarNamesTriggered();
@@ -430,6 +447,7 @@ private slots:
   void toggle_favoritesPane();
   void toggle_historyPane(); // Toggling visibility
   void on_exportHistory_triggered();
+  void on_exportHistoryDefinitions_triggered();
   void on_importHistory_triggered();
   void on_alwaysOnTop_triggered( bool checked );
   void focusWordList();
@@ -437,6 +455,9 @@ private slots:
   void on_exportFavorites_triggered();
   void on_importFavorites_triggered();
   void on_ExportFavoritesToList_triggered();
+  void on_exportFavoritesDefinitions_triggered();
+
+  void bulkExportFinished( QString const & errorString );
 
   void updateSearchPaneAndBar( bool searchInDock );
 
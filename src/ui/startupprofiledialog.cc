@@ -0,0 +1,99 @@
+/* This file is part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
+
+#include "startupprofiledialog.hh"
+#include "startupprofile.hh"
+
+#include <QClipboard>
+#include <QDialogButtonBox>
+#include <QGuiApplication>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+namespace {
+
+QString milliseconds( qint64 ns )
+{
+  return QString::number( ns / 1000000.0, 'f', 1 );
+}
+
+} // namespace
+
+StartupProfileDialog::StartupProfileDialog( QWidget * parent ):
+  QDialog( parent )
+{
+  setWindowTitle( tr( "Startup Profile" ) );
+  resize( 640, 480 );
+
+  auto * layout = new QVBoxLayout( this );
+
+  auto * summary = new QLabel( this );
+  if ( StartupProfile::isFinished() )
+    summary->setText( tr( "The startup took %1 ms, using %2 ms of CPU time." )
+                        .arg( milliseconds( StartupProfile::totalWallNs() ),
+                              milliseconds( StartupProfile::totalCpuNs() ) ) );
+  else
+    summary->setText( tr( "The startup is not over yet." ) );
+  layout->addWidget( summary );
+
+  auto * tree = new QTreeWidget( this );
+  tree->setHeaderLabels( { tr( "Phase" ), tr( "Time, ms" ), tr( "CPU time, ms" ), tr( "Started at, ms" ) } );
+  tree->setUniformRowHeights( true );
+  layout->addWidget( tree );
+
+  auto const fill = []( QTreeWidgetItem * item, StartupProfile::Entry const & entry ) {
+    item->setText( 0, entry.name );
+    item->setText( 1, milliseconds( entry.wallNs ) );
+    item->setText( 2, milliseconds( entry.cpuNs ) );
+    item->setText( 3, milliseconds( entry.startNs ) );
+
+    for ( int column = 1; column < 4; ++column )
+      item->setTextAlignment( column, Qt::AlignRight | Qt::AlignVCenter );
+  };
+
+  // The items of the phases the next one might be nested in, by depth
+  QList< QTreeWidgetItem * > parents;
+
+  QList< StartupProfile::Entry > background;
+
+  for ( auto const & entry : StartupProfile::entries() ) {
+    if ( entry.background ) {
+      background.append( entry );
+      continue;
+    }
+
+    while ( parents.size() > entry.depth )
+      parents.removeLast();
+
+    auto * item = parents.isEmpty() ? new QTreeWidgetItem( tree ) : new QTreeWidgetItem( parents.last() );
+
+    fill( item, entry );
+
+    parents.append( item );
+  }
+
+  // The background phases overlap the others, so they're listed apart
+  if ( !background.isEmpty() ) {
+    auto * backgroundItem = new QTreeWidgetItem( tree );
+    backgroundItem->setText( 0, tr( "In the background" ) );
+
+    for ( auto const & entry : background )
+      fill( new QTreeWidgetItem( backgroundItem ), entry );
+  }
+
+  tree->expandToDepth( 0 );
+  tree->header()->setSectionResizeMode( 0, QHeaderView::Stretch );
+  tree->header()->setStretchLastSection( false );
+
+  auto * buttons = new QDialogButtonBox( QDialogButtonBox::Close, this );
+  auto * copy    = buttons->addButton( tr( "Copy as JSON" ), QDialogButtonBox::ActionRole );
+
+  connect( copy, &QPushButton::clicked, this, [] {
+    QGuiApplication::clipboard()->setText( QString::fromUtf8( StartupProfile::toJson() ) );
+  } );
+  connect( buttons, &QDialogButtonBox::rejected, this, &QDialog::reject );
+
+  layout->addWidget( buttons );
+}
@@ -0,0 +1,18 @@
+/* This file is part of GoldenDict. Licensed under GPLv3 or later, see the LICENSE file */
+
+#ifndef __STARTUPPROFILEDIALOG_HH_INCLUDED__
+#define __STARTUPPROFILEDIALOG_HH_INCLUDED__
+
+#include <QDialog>
+
+/// Shows the phases of the startup StartupProfile recorded, with their times.
+class StartupProfileDialog: public QDialog
+{
+  Q_OBJECT
+
+public:
+
+  explicit StartupProfileDialog( QWidget * parent );
+};
+
+#endif
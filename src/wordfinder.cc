@@ -23,6 +23,8 @@ WordFinder::WordFinder( QObject * parent ):
   updateResultsTimer.setInterval( 1000 ); // We use a one second update timer
   updateResultsTimer.setSingleShot( true );
 
+  collator.setCaseSensitivity( Qt::CaseInsensitive );
+
   connect( &updateResultsTimer, &QTimer::timeout, this, &WordFinder::updateResults, Qt::QueuedConnection );
 }
 
@@ -312,6 +314,7 @@ void WordFinder::updateResults()
         if ( insertResult.first->second->word != match ) {
           // The case is different -- agree on a lowercase version
           insertResult.first->second->word = lowerCased;
+          insertResult.first->second->sortKey.reset();
         }
         if ( !weight && insertResult.first->second->wasSuggested )
           insertResult.first->second->wasSuggested = false;
@@ -401,6 +404,7 @@ void WordFinder::updateResults()
         }
       }
 
+      makeSortKeys();
       resultsArray.sort( SortByRank() );
     }
     else if ( searchType == StemmedMatch ) {
@@ -430,6 +434,7 @@ void WordFinder::updateResults()
         }
       }
 
+      makeSortKeys();
       resultsArray.sort( SortByRankAndLength() );
 
       maxSearchResults = 15;
@@ -462,3 +467,12 @@ void WordFinder::cancelSearches()
   for ( auto & queuedRequest : queuedRequests )
     queuedRequest->cancel();
 }
+
+void WordFinder::makeSortKeys()
+{
+  // Each key is made once per result, rather than the words being collated
+  // again on every comparison the sort does
+  for ( auto & result : resultsArray )
+    if ( !result.sortKey )
+      result.sortKey = collator.sortKey( QString::fromStdU32String( result.word ) );
+}
@@ -11,6 +11,8 @@
 #include <QMutex>
 #include <QWaitCondition>
 #include <QRunnable>
+#include <QCollator>
+#include <optional>
 #include "dict/dictionary.hh"
 
 /// This component takes care of finding words. The search is asynchronous.
@@ -56,6 +58,10 @@ private:
     gd::wstring word;
     int rank;
     bool wasSuggested;
+
+    /// The word's collation key, cached from the first sort on rather than
+    /// taken from the index. Reset whenever the word changes.
+    std::optional< QCollatorSortKey > sortKey;
   };
 
   // Maps lowercased string to the original one. This catches all duplicates
@@ -65,6 +71,9 @@ private:
   ResultsArray resultsArray;
   ResultsIndex resultsIndex;
 
+  /// Orders the results of the same rank, the way the user's locale does
+  QCollator collator;
+
 public:
 
   WordFinder( QObject * parent );
@@ -156,6 +165,17 @@ private:
   // would cancel in parallel.
   void cancelSearches();
 
+  /// Makes the sort keys the results don't have yet.
+  void makeSortKeys();
+
+  /// The order of the words of the same rank. The keys are compared, and
+  /// the words themselves only if the keys are the same.
+  static bool collatesBefore( OneResult const & first, OneResult const & second )
+  {
+    int const result = first.sortKey->compare( *second.sortKey );
+    return result ? result < 0 : first.word < second.word;
+  }
+
   /// Compares results based on their ranks
   struct SortByRank
   {
@@ -167,9 +187,7 @@ private:
       if ( first.rank > second.rank )
         return false;
 
-      // Do any sort of collation here in the future. For now we just put the
-      // strings sorted lexicographically.
-      return first.word < second.word;
+      return collatesBefore( first, second );
     }
   };
 
@@ -190,9 +208,7 @@ private:
       if ( first.word.size() > second.word.size() )
         return false;
 
-      // Do any sort of collation here in the future. For now we just put the
-      // strings sorted lexicographically.
-      return first.word < second.word;
+      return collatesBefore( first, second );
     }
   };
 };